@@ -0,0 +1,151 @@
+#pragma once
+#include "TensorWrapper/Shape.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <sys/mman.h>
+
+namespace TWrapper {
+
+///The alignment (in bytes) that requests huge-page backed buffers
+constexpr size_t huge_page_alignment=2*1024*1024;
+
+namespace detail_ {
+
+///How buffers allocated by TensorWrapper itself are laid out
+struct BufferOptions{
+    ///The alignment of the first element, in bytes.  Must be a power of 2.
+    size_t alignment=64;
+
+    ///Should the fastest-running dimension be padded?
+    bool pad=false;
+};
+
+///Returns the process-wide buffer options (set via RunTime)
+inline BufferOptions& buffer_options()noexcept
+{
+    static BufferOptions options;
+    return options;
+}
+
+/** \brief Allocates memory for \p n elements aligned to \p alignment bytes.
+ *
+ *  If \p alignment is at least huge_page_alignment the kernel is also asked to
+ *  back the buffer with transparent huge pages.  The memory must be released
+ *  with std::free.
+ *
+ *  \throws std::bad_alloc if the allocation fails.
+ */
+template<typename T>
+T* aligned_allocate(size_t n, size_t alignment)
+{
+    static_assert(std::is_trivially_default_constructible<T>::value,
+                  "Aligned buffers hold uninitialized elements");
+    alignment=std::max(alignment,sizeof(void*));
+    //Round up so whole huge pages are requested
+    const size_t nbytes=(n*sizeof(T)+alignment-1)/alignment*alignment;
+    void* ptr=nullptr;
+    if(posix_memalign(&ptr,alignment,std::max(nbytes,alignment)))
+        throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if(alignment>=huge_page_alignment)
+        madvise(ptr,nbytes,MADV_HUGEPAGE);
+#endif
+    return static_cast<T*>(ptr);
+}
+
+///Deleter for buffers made either by new[] or by aligned_allocate
+template<typename T>
+struct BufferDeleter{
+    ///Was the buffer made by aligned_allocate?
+    bool aligned=false;
+
+    void operator()(T* ptr)const noexcept
+    {
+        if(aligned)std::free(ptr);
+        else delete[] ptr;
+    }
+};
+
+/** \brief Allocator for containers of elements, such as the local arrays of
+ *  TensorWrapper's own backends, aligned according to the RunTime's buffer
+ *  options.
+ *
+ *  The alignment is read when memory is allocated; every buffer is released
+ *  with std::free, so all instances are interchangeable.
+ */
+template<typename T>
+struct AlignedAllocator{
+    using value_type=T;
+
+    AlignedAllocator()=default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U>&)noexcept{}
+
+    T* allocate(size_t n)
+    {
+        return aligned_allocate<T>(n,buffer_options().alignment);
+    }
+
+    void deallocate(T* ptr, size_t)noexcept
+    {
+        std::free(ptr);
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&)noexcept
+{
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&)noexcept
+{
+    return false;
+}
+
+/** \brief Returns the stride of the fastest-running dimension after padding.
+ *
+ *  The length is rounded up to a whole number of 64 byte cache lines.  If the
+ *  result is a multiple of 512 bytes (*e.g.* the length is a large power of
+ *  two) the rows would only map to every eighth cache set, or worse, so one
+ *  more cache line is added.
+ */
+template<typename T>
+size_t padded_length(size_t n)noexcept
+{
+    const size_t line=std::max<size_t>(1,64/sizeof(T));
+    size_t rv=(n+line-1)/line*line;
+    if((rv*sizeof(T))%512==0)rv+=line;
+    return rv;
+}
+
+/** \brief Makes the shape of a block whose fastest-running dimension is
+ *  padded.
+ *
+ *  Vectors (and scalars) are never padded.
+ */
+template<typename T, size_t rank>
+Shape<rank> padded_shape(const std::array<size_t,rank>& end, bool row_major,
+                         const std::array<size_t,rank>& start)
+{
+    const Shape<rank> packed(end,row_major,start);
+    if(rank<2)return packed;
+    std::array<size_t,rank> strides{};
+    size_t stride=1;
+    for(size_t i=0;i<rank;++i)
+    {
+        const size_t ii=(row_major ? rank-1-i : i);
+        strides[ii]=stride;
+        stride*=(i==0 ? padded_length<T>(packed.dims()[ii]) :
+                        packed.dims()[ii]);
+    }
+    return Shape<rank>(end,row_major,start,strides);
+}
+
+}}//End namespaces
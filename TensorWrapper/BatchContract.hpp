@@ -0,0 +1,306 @@
+#pragma once
+#include "TensorWrapper/TensorWrapper.hpp"
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace TWrapper {
+namespace detail_ {
+
+///Is \p T a contraction of two tensors?
+template<typename T>
+struct IsContraction: std::false_type{};
+
+template<typename LHS_t, typename RHS_t>
+struct IsContraction<Contraction<LHS_t,RHS_t>>: std::true_type{};
+
+/** \brief A matrix in someone else's memory.
+ *
+ *  Element (i,j) is at ptr[i*row_stride+j*col_stride].  One of the strides
+ *  must be one for the matrix to be used in a GEMM.
+ */
+template<typename T>
+struct MatrixView{
+    T* ptr;
+    size_t rows;
+    size_t cols;
+    size_t row_stride;
+    size_t col_stride;
+
+    bool is_row_major()const noexcept{return col_stride==1;}
+    bool is_gemm_ready()const noexcept{return row_stride==1||col_stride==1;}
+
+    ///Wraps the view in an Eigen matrix stored in the order \p Major
+    template<int Major>
+    auto as_eigen()const
+    {
+        using matrix_t=Eigen::Matrix<std::remove_const_t<T>,Eigen::Dynamic,
+                                     Eigen::Dynamic,Major>;
+        using map_t=Eigen::Map<std::conditional_t<std::is_const<T>::value,
+                               const matrix_t,matrix_t>,0,Eigen::OuterStride<>>;
+        const bool row_major=(Major==Eigen::RowMajor);
+        return map_t(ptr,rows,cols,Eigen::OuterStride<>(
+                         row_major ? row_stride : col_stride));
+    }
+};
+
+/** \brief Views the modes \p row_modes and \p col_modes of a strided buffer
+ *  as a matrix.
+ *
+ *  Each set of modes is flattened row-major.  If a set does not flatten to a
+ *  single stride the view's strides are both zero.
+ */
+template<typename T, size_t R, typename Rows_t, typename Cols_t>
+MatrixView<T> make_view(T* ptr, const Shape<R>& shape,
+                        const Rows_t& row_modes, const Cols_t& col_modes)
+{
+    auto flatten=[&](const auto& modes, size_t& extent, size_t& stride){
+        extent=1;
+        stride=1;
+        bool first=true;
+        for(size_t i=modes.size();i-->0;)
+        {
+            const size_t m=modes[i];
+            if(shape.dims()[m]==1)continue;
+            if(!first && shape.strides()[m]!=stride*extent)return false;
+            if(first)stride=shape.strides()[m];
+            first=false;
+            extent*=shape.dims()[m];
+        }
+        return true;
+    };
+    MatrixView<T> rv{ptr,1,1,0,0};
+    size_t rs,cs;
+    const bool good=flatten(row_modes,rv.rows,rs) &
+                    flatten(col_modes,rv.cols,cs);
+    if(!good)return rv;
+    rv.row_stride=(rv.rows==1 ? 1 : rs);
+    rv.col_stride=(rv.cols==1 ? 1 : cs);
+    if(!rv.is_gemm_ready())rv.row_stride=rv.col_stride=0;
+    return rv;
+}
+
+/** \brief The offsets of each row-major flattened index of \p modes in a
+ *  buffer with the layout \p shape.
+ */
+template<size_t R, typename Modes_t>
+std::vector<size_t> mode_offsets(const Shape<R>& shape, const Modes_t& modes)
+{
+    std::vector<size_t> rv(1,0);
+    for(size_t m : modes)
+    {
+        std::vector<size_t> next;
+        next.reserve(rv.size()*shape.dims()[m]);
+        for(size_t x : rv)
+            for(size_t i=0;i<shape.dims()[m];++i)
+                next.push_back(x+i*shape.strides()[m]);
+        rv.swap(next);
+    }
+    return rv;
+}
+
+///C=A*B for each combination of storage orders
+template<typename T, typename A_t, typename B_t>
+void gemm_c(const A_t& A, const B_t& B, const MatrixView<T>& C)
+{
+    if(C.is_row_major())
+        C.template as_eigen<Eigen::RowMajor>().noalias()=A*B;
+    else
+        C.template as_eigen<Eigen::ColMajor>().noalias()=A*B;
+}
+
+template<typename T, typename A_t>
+void gemm_b(const A_t& A, const MatrixView<const T>& B, const MatrixView<T>& C)
+{
+    if(B.is_row_major())
+        gemm_c(A,B.template as_eigen<Eigen::RowMajor>(),C);
+    else
+        gemm_c(A,B.template as_eigen<Eigen::ColMajor>(),C);
+}
+
+template<typename T>
+void gemm(const MatrixView<const T>& A, const MatrixView<const T>& B,
+          const MatrixView<T>& C)
+{
+    if(A.is_row_major())
+        gemm_b(A.template as_eigen<Eigen::RowMajor>(),B,C);
+    else
+        gemm_b(A.template as_eigen<Eigen::ColMajor>(),B,C);
+}
+
+/** \brief Copies the elements of a view that can't be used in a GEMM into
+ *  \p buffer, row-major.
+ */
+template<typename T>
+MatrixView<const T> pack(const T* ptr, const std::vector<size_t>& rows,
+                         const std::vector<size_t>& cols,
+                         std::vector<T>& buffer)
+{
+    buffer.resize(rows.size()*cols.size());
+    size_t counter=0;
+    for(size_t r : rows)
+        for(size_t c : cols)
+            buffer[counter++]=ptr[r+c];
+    return {buffer.data(),rows.size(),cols.size(),cols.size(),1};
+}
+
+///Runs the batch as a series of GEMMs, one per thread at a time
+template<bool local_dense>
+struct BatchContract{
+    template<typename LHS_Idx, typename RHS_Idx, typename Result_t,
+             size_t LR, size_t RR, typename T, TensorTypes TT, typename Expr_t>
+    static std::vector<Result_t> eval(
+            const std::vector<TensorWrapper<LR,T,TT>>& lhs,
+            const std::vector<TensorWrapper<RR,T,TT>>& rhs,
+            Expr_t&&)
+    {
+        using lhs_t=TensorWrapper<LR,T,TT>;
+        using rhs_t=TensorWrapper<RR,T,TT>;
+        constexpr size_t nfree=Result_t::rank();
+        constexpr size_t lnfree=LHS_Idx::nunique(RHS_Idx());
+        const auto free=get_free(LHS_Idx(),RHS_Idx());
+        const auto dummy=get_dummy(LHS_Idx(),RHS_Idx());
+        std::array<size_t,lnfree> lfree_modes{};
+        std::array<size_t,nfree-lnfree> rfree_modes{};
+        for(size_t i=0;i<lnfree;++i)lfree_modes[i]=i;
+        for(size_t i=lnfree;i<nfree;++i)rfree_modes[i-lnfree]=i;
+
+        //Everything touching the tensors' pointers happens before the loop
+        const size_t nbatch=lhs.size();
+        std::vector<Result_t> rv;
+        rv.reserve(nbatch);
+        std::vector<MemoryBlock<LR,T>> lmem(nbatch);
+        std::vector<MemoryBlock<RR,T>> rmem(nbatch);
+        std::vector<MemoryBlock<nfree,T>> cmem(nbatch);
+        for(size_t p=0;p<nbatch;++p)
+        {
+            lmem[p]=const_cast<lhs_t&>(lhs[p]).get_memory();
+            rmem[p]=const_cast<rhs_t&>(rhs[p]).get_memory();
+            const auto& ldims=lmem[p].shape(0).dims();
+            const auto& rdims=rmem[p].shape(0).dims();
+            for(size_t i=0;i<dummy.first.size();++i)
+                if(ldims[dummy.first[i]]!=rdims[dummy.second[i]])
+                    throw std::invalid_argument(
+                        "Contracted dimensions differ in pair "+
+                        std::to_string(p));
+            std::array<size_t,nfree> dims{};
+            size_t counter=0;
+            for(size_t i : free.first)dims[counter++]=ldims[i];
+            for(size_t i : free.second)dims[counter++]=rdims[i];
+            rv.emplace_back(dims);
+            cmem[p]=rv.back().get_memory();
+        }
+
+        //Small products are parallelized over the batch, not within a GEMM
+        #pragma omp parallel num_threads(num_threads())
+        {
+            std::vector<T> abuffer,bbuffer,cbuffer;
+            #pragma omp for schedule(dynamic)
+            for(size_t p=0;p<nbatch;++p)
+            {
+                const auto& lshape=lmem[p].shape(0);
+                const auto& rshape=rmem[p].shape(0);
+                const auto& cshape=cmem[p].shape(0);
+                const T* lptr=lmem[p].block(0);
+                const T* rptr=rmem[p].block(0);
+                T* cptr=cmem[p].block(0);
+                auto A=make_view(lptr,lshape,free.first,dummy.first);
+                if(!A.row_stride)
+                    A=pack(lptr,mode_offsets(lshape,free.first),
+                           mode_offsets(lshape,dummy.first),abuffer);
+                auto B=make_view(rptr,rshape,dummy.second,free.second);
+                if(!B.row_stride)
+                    B=pack(rptr,mode_offsets(rshape,dummy.second),
+                           mode_offsets(rshape,free.second),bbuffer);
+                auto C=make_view(cptr,cshape,lfree_modes,rfree_modes);
+                if(C.row_stride)
+                {
+                    gemm(A,B,C);
+                    continue;
+                }
+                cbuffer.resize(A.rows*B.cols);
+                gemm(A,B,MatrixView<T>{cbuffer.data(),A.rows,B.cols,B.cols,1});
+                const auto rows=mode_offsets(cshape,lfree_modes);
+                const auto cols=mode_offsets(cshape,rfree_modes);
+                size_t counter=0;
+                for(size_t r : rows)
+                    for(size_t c : cols)
+                        cptr[r+c]=cbuffer[counter++];
+            }
+        }
+        for(size_t p=0;p<nbatch;++p)rv[p].set_memory(cmem[p]);
+        return rv;
+    }
+};
+
+///Backends without a single local buffer go through the expression
+template<>
+struct BatchContract<false>{
+    template<typename LHS_Idx, typename RHS_Idx,
+             typename Result_t, typename LHS_t, typename RHS_t, typename Expr_t>
+    static std::vector<Result_t> eval(const std::vector<LHS_t>& lhs,
+                                      const std::vector<RHS_t>& rhs,
+                                      Expr_t&& expr)
+    {
+        std::vector<Result_t> rv;
+        rv.reserve(lhs.size());
+        for(size_t p=0;p<lhs.size();++p)rv.emplace_back(expr(lhs[p],rhs[p]));
+        return rv;
+    }
+};
+
+}//End namespace detail_
+
+/** \brief Contracts many pairs of (small) tensors that share an index
+ *  signature.
+ *
+ *  The signature is given by an expression for one pair:
+ *
+ *  \code
+ *  std::vector<EigenMatrix<double>> A,B;//Pairs may differ in size
+ *  auto C=batch_contract(A,B,[&](auto& a, auto& b){return a(i,k)*b(k,j);});
+ *  \endcode
+ *
+ *  For backends holding each tensor in one local buffer the index analysis is
+ *  done once for the batch and each pair becomes a single GEMM.  Pairs are
+ *  spread over the OpenMP threads, with each GEMM run by one thread, as the
+ *  products are usually too small to be worth splitting.  Tensors whose
+ *  modes can't be viewed as a matrix without a permutation are copied first.
+ *  Other backends evaluate the expression for each pair.
+ *
+ *  \param[in] lhs The tensors on the left of each product.
+ *  \param[in] rhs The tensors on the right of each product.
+ *  \param[in] expr Returns the contraction of a pair, each tensor appearing
+ *                  once with one index per mode.
+ *  \returns The result of each contraction, indexed by the free indices of
+ *           the left tensor followed by those of the right tensor.
+ *  \throws std::invalid_argument if \p lhs and \p rhs are different sizes or
+ *          the contracted dimensions of a pair differ.
+ */
+template<size_t LR, size_t RR, typename T, detail_::TensorTypes TT,
+         typename Expr_t>
+auto batch_contract(const std::vector<TensorWrapper<LR,T,TT>>& lhs,
+                    const std::vector<TensorWrapper<RR,T,TT>>& rhs,
+                    Expr_t&& expr)
+{
+    using lhs_t=TensorWrapper<LR,T,TT>;
+    using rhs_t=TensorWrapper<RR,T,TT>;
+    using op_t=decltype(expr(std::declval<const lhs_t&>(),
+                             std::declval<const rhs_t&>()));
+    static_assert(detail_::IsContraction<op_t>::value,
+                  "Expression must be the product of the two tensors");
+    using LHS_Idx=typename decltype(std::declval<op_t>().lhs_)::indices;
+    using RHS_Idx=typename decltype(std::declval<op_t>().rhs_)::indices;
+    static_assert(LHS_Idx::size()==LR && RHS_Idx::size()==RR,
+                  "Each tensor must appear once with one index per mode");
+    static_assert(op_t::rank>0,"Result of batch_contract can't be a scalar");
+    using result_t=TensorWrapper<op_t::rank,T,TT>;
+    if(lhs.size()!=rhs.size())
+        throw std::invalid_argument("Batches are different sizes");
+    using helper_t=detail_::BatchContract<detail_::is_local_dense(TT)>;
+    return helper_t::template eval<LHS_Idx,RHS_Idx,result_t>(
+                lhs,rhs,std::forward<Expr_t>(expr));
+}
+
+}//End namespace TWrapper
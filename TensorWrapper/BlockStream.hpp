@@ -0,0 +1,160 @@
+#pragma once
+#include "TensorWrapper/TensorWrapper.hpp"
+#include "TensorWrapper/TensorImpl/BlockFetcher.hpp"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace TWrapper {
+
+/** \brief Visits every block of a tensor, fetching the next few blocks while
+ *  the caller works on the current one.
+ *
+ *  The blocks are those of the backend's BlockFetcher (the tiles of TiledArray
+ *  and of the native distributed backend, the patches of Global Arrays and the
+ *  tiles the TilingPolicy gives CTF tensors).  They are streamed in the order
+ *  blocks() lists them.  While the caller holds block i, the fetches of
+ *  blocks i+1 to i+depth are in flight, so for backends with non-blocking
+ *  fetches communication overlaps the caller's work.  The stream keeps
+ *  depth+1 buffers, each as large as the largest block, and reuses them.
+ *
+ *  \code
+ *  BlockStream<2,double,TensorTypes::Distributed> stream(A,4);
+ *  for(auto block : stream)
+ *      work(block.shape,block.data);
+ *  \endcode
+ *
+ *  Making and destroying a stream is collective for the distributed backends
+ *  and, for CTF, so is every fetch: every process must then stream the whole
+ *  tensor with the same depth.  A stream may only be iterated once.
+ */
+template<size_t R, typename T, detail_::TensorTypes TT>
+class BlockStream{
+    using fetcher_t=detail_::BlockFetcher<R,T,TT>;
+    using impl_t=detail_::TensorWrapperImpl<R,T,TT>;
+public:
+    ///The block handed to the caller; valid until the stream moves on
+    struct Block{
+        const Shape<R>& shape;//!< The block's indices (packed and row-major)
+        const T* data;        //!< The block's elements
+    };
+
+    ///Walks the stream; incrementing hands over the next block
+    class iterator{
+    public:
+        using iterator_category=std::input_iterator_tag;
+        using value_type=Block;
+        using difference_type=std::ptrdiff_t;
+        using pointer=const Block*;
+        using reference=Block;
+
+        explicit iterator(BlockStream* stream=nullptr):stream_(stream){}
+
+        Block operator*()const{return stream_->current();}
+
+        iterator& operator++()
+        {
+            if(!stream_->advance())stream_=nullptr;
+            return *this;
+        }
+
+        bool operator==(const iterator& other)const noexcept
+        {
+            return stream_==other.stream_;
+        }
+
+        bool operator!=(const iterator& other)const noexcept
+        {
+            return stream_!=other.stream_;
+        }
+    private:
+        BlockStream* stream_;
+    };
+
+    /** \brief Starts streaming the blocks of \p t.
+     *
+     *  \param[in] t The tensor; it must outlive the stream and not be
+     *               modified while it is streamed.
+     *  \param[in] depth How many blocks to fetch ahead of the current one.
+     */
+    explicit BlockStream(TensorWrapper<R,T,TT>& t, size_t depth=2):
+        fetcher_(impl_t(),t.data()),
+        depth_(depth),
+        pool_(std::min(depth+1,std::max<size_t>(1,blocks().size())))
+    {
+        size_t largest=0;
+        for(const auto& block : blocks())
+            largest=std::max(largest,block.size());
+        for(auto& buffer : pool_)buffer.resize(largest);
+    }
+
+    BlockStream(const BlockStream&)=delete;
+    BlockStream& operator=(const BlockStream&)=delete;
+
+    ///Waits for the fetches still in flight
+    ~BlockStream()
+    {
+        for(size_t i=begun_ ? current_+1 : 0;i<issued_;++i)
+            fetcher_.wait(i,buffer(i));
+    }
+
+    ///Returns the blocks, in the order they are streamed
+    const std::vector<Shape<R>>& blocks()const noexcept
+    {
+        return fetcher_.blocks();
+    }
+
+    ///Returns an iterator to the first block
+    iterator begin(){return iterator(advance() ? this : nullptr);}
+
+    ///Returns the iterator past the last block
+    iterator end(){return iterator();}
+
+    /** \brief Moves on to the next block, starting fetches as buffers free up.
+     *
+     *  \returns false once every block has been visited.
+     */
+    bool advance()
+    {
+        const size_t nblocks=blocks().size();
+        current_=begun_ ? current_+1 : 0;
+        begun_=true;
+        if(current_>=nblocks)
+        {
+            current_=nblocks;
+            return false;
+        }
+        for(;issued_<nblocks && issued_<=current_+depth_;++issued_)
+            fetcher_.start(issued_,buffer(issued_));
+        fetcher_.wait(current_,buffer(current_));
+        return true;
+    }
+
+    ///Returns the current block
+    Block current()const
+    {
+        return Block{blocks()[current_],pool_[current_%pool_.size()].data()};
+    }
+
+private:
+    fetcher_t fetcher_;
+
+    ///How many blocks are fetched ahead of the current one
+    size_t depth_;
+
+    ///The buffers blocks are fetched into; block i uses i%pool_.size()
+    std::vector<std::vector<T>> pool_;
+
+    ///The number of blocks whose fetch has started
+    size_t issued_=0;
+
+    ///The block the caller has
+    size_t current_=0;
+
+    ///Has the caller been handed a block yet?
+    bool begun_=false;
+
+    T* buffer(size_t i){return pool_[i%pool_.size()].data();}
+};
+
+}//End namespace
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace TWrapper {
+
+///The ways a tensor can be compressed while it is not in use
+enum class Compression {Lossless, //!< Bit-for-bit identical on decompression
+                        Truncated //!< Mantissas are truncated to a tolerance
+};
+
+namespace detail_ {
+
+///Maps a scalar type to the unsigned integer type with the same width
+template<size_t N>
+struct UIntOfSize;
+
+template<>
+struct UIntOfSize<4>{using type=std::uint32_t;};
+
+template<>
+struct UIntOfSize<8>{using type=std::uint64_t;};
+
+/** \brief A buffer of elements that are stored in a compressed format.
+ *
+ *  The elements are split into blocks of block_size elements that are
+ *  compressed independently of one another.  Within a block each element is
+ *  XOR-ed with the element before it (neighboring tensor elements tend to
+ *  share signs, exponents, and leading mantissa bits so this zeros most of the
+ *  high bytes), the resulting words are transposed into byte planes, and runs
+ *  of zero bytes are run-length encoded.
+ *
+ *  For Compression::Truncated the mantissa of each floating point element is
+ *  truncated (towards zero) to the fewest bits such that the relative error of
+ *  each element is less than the requested tolerance.  The truncated bits are
+ *  zero and are thus removed by the run-length encoding.
+ *
+ *  \tparam T The type of the elements.  Must be trivially copyable and 4 or 8
+ *          bytes wide.
+ */
+template<typename T>
+class CompressedBuffer{
+public:
+    ///The number of elements in a block
+    static constexpr size_t block_size=4096;
+
+    /** \brief Compresses \p n elements starting at \p data.
+     *
+     *  \param[in] data The elements to compress.
+     *  \param[in] n The number of elements in \p data.
+     *  \param[in] mode Whether to compress losslessly or to truncate.
+     *  \param[in] tolerance The maximum relative error of each element when
+     *                       \p mode is Compression::Truncated.  Ignored
+     *                       otherwise.
+     *  \throws std::bad_alloc if memory allocation fails.
+     */
+    CompressedBuffer(const T* data, size_t n,
+                     Compression mode=Compression::Lossless,
+                     double tolerance=0.0):
+        size_(n),mask_(make_mask(mode,tolerance))
+    {
+        for(size_t start=0;start<n;start+=block_size)
+            blocks_.push_back(encode(data+start,std::min(block_size,n-start)));
+    }
+
+    ///Returns the number of elements in the buffer
+    size_t size()const noexcept{return size_;}
+
+    ///Returns the number of bytes used to hold the compressed elements
+    size_t nbytes()const noexcept
+    {
+        size_t rv=0;
+        for(const auto& x: blocks_)rv+=x.size();
+        return rv;
+    }
+
+    /** \brief Decompresses the elements into \p out.
+     *
+     *  \param[out] out Where to put the elements.  Must hold size() elements.
+     */
+    void decompress(T* out)const
+    {
+        for(size_t i=0;i<blocks_.size();++i)
+        {
+            const size_t start=i*block_size;
+            decode(blocks_[i],out+start,std::min(block_size,size_-start));
+        }
+    }
+
+private:
+    using word_t=typename UIntOfSize<sizeof(T)>::type;
+    using byte_t=unsigned char;
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be compressed");
+
+    ///The number of elements in the buffer
+    size_t size_;
+
+    ///The bits of each element that are kept
+    word_t mask_;
+
+    ///The compressed blocks
+    std::vector<std::vector<byte_t>> blocks_;
+
+    ///Determines which bits survive the requested compression
+    static word_t make_mask(Compression mode, double tolerance)
+    {
+        constexpr bool is_float=std::numeric_limits<T>::is_iec559;
+        if(!is_float || mode==Compression::Lossless || tolerance<=0.0)
+            return ~word_t{0};
+        const int mantissa=std::numeric_limits<T>::digits-1;
+        //Truncating to k bits gives a relative error less than 2^-k
+        const int keep=std::min(mantissa,std::max(0,
+                           static_cast<int>(std::ceil(-std::log2(tolerance)))));
+        return ~((word_t{1}<<(mantissa-keep))-1);
+    }
+
+    std::vector<byte_t> encode(const T* data, size_t n)const
+    {
+        std::vector<word_t> words(n);
+        word_t prev=0;
+        for(size_t i=0;i<n;++i)
+        {
+            word_t bits;
+            std::memcpy(&bits,data+i,sizeof(T));
+            bits&=mask_;
+            words[i]=bits^prev;
+            prev=bits;
+        }
+        std::vector<byte_t> rv;
+        rv.reserve(n);
+        //Writes out the current run of zeros (runs are at most 255 long)
+        size_t zeros=0;
+        auto flush=[&](){
+            if(!zeros)return;
+            rv.push_back(0);
+            rv.push_back(static_cast<byte_t>(zeros));
+            zeros=0;
+        };
+        for(size_t b=0;b<sizeof(T);++b)
+            for(size_t i=0;i<n;++i)
+            {
+                const byte_t byte=static_cast<byte_t>(words[i]>>(8*b));
+                if(byte!=0 || zeros==255)flush();
+                if(byte==0)++zeros;
+                else rv.push_back(byte);
+            }
+        flush();
+        rv.shrink_to_fit();
+        return rv;
+    }
+
+    static void decode(const std::vector<byte_t>& block, T* out, size_t n)
+    {
+        std::vector<word_t> words(n,0);
+        size_t counter=0;
+        for(size_t i=0;i<block.size();++i)
+        {
+            if(block[i]==0)
+            {
+                counter+=block[++i];
+                continue;
+            }
+            words[counter%n]|=static_cast<word_t>(block[i])<<(8*(counter/n));
+            ++counter;
+        }
+        word_t prev=0;
+        for(size_t i=0;i<n;++i)
+        {
+            prev^=words[i];
+            std::memcpy(out+i,&prev,sizeof(T));
+        }
+    }
+};
+
+template<typename T>
+constexpr size_t CompressedBuffer<T>::block_size;
+
+}}//End namespaces
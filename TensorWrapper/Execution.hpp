@@ -0,0 +1,118 @@
+#pragma once
+#include "TensorWrapper/Config.hpp"
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace TWrapper {
+
+///How the threads of a rank are pinned to the cores it may run on
+enum class Affinity {
+    None,   //!< Threads are left to the operating system (the default)
+    Compact,//!< Thread i of a rank is pinned to the i-th core after the
+            //!< cores of the ranks before it on the node
+    Spread  //!< Like Compact, but the threads are spaced evenly over the cores
+};
+
+/** \brief The resources a RunTime hands to the backends.
+ *
+ *  Every member has a default that reproduces how things worked before it
+ *  could be set, so only the members of interest need to be filled in.
+ */
+struct ExecutionConfig{
+    ///The processes tensors are spread over
+    MPI_Comm comm=MPI_COMM_WORLD;
+
+    ///The number of threads each rank uses; 0 means omp_get_max_threads()
+    size_t threads_per_rank=0;
+
+    ///How the OpenMP threads are pinned
+    Affinity affinity=Affinity::None;
+
+    /** \brief Should distributed tensors only span the ranks of a node?
+     *
+     *  If true \p comm is split into one communicator per shared-memory node
+     *  and the backends use the node's communicator.
+     */
+    bool node_local=false;
+};
+
+namespace detail_ {
+
+///The configuration the backends actually use (see RunTime)
+struct ExecutionState{
+    ///The number of threads of this rank
+    size_t nthreads=static_cast<size_t>(omp_get_max_threads());
+
+    ///The communicator new distributed tensors (and worlds) are made from
+    MPI_Comm comm=MPI_COMM_WORLD;
+
+    ///The ranks of comm's parent sharing this rank's node
+    MPI_Comm node_comm=MPI_COMM_WORLD;
+};
+
+///Returns the process-wide execution state (set via RunTime)
+inline ExecutionState& execution()noexcept
+{
+    static ExecutionState state;
+    return state;
+}
+
+///Returns the number of threads backends should use
+inline int num_threads()noexcept
+{
+    return static_cast<int>(execution().nthreads);
+}
+
+/** \brief Pins the OpenMP threads of this rank to cores.
+ *
+ *  The cores are those this process may run on, so pinning done by the MPI
+ *  launcher is respected.  If that set is shared by several ranks of a node
+ *  each rank takes its own share, starting after the \p first threads of the
+ *  ranks before it.  Threads are pinned from within an OpenMP parallel region,
+ *  which sticks for as long as the runtime keeps its threads (i.e., as long
+ *  as later regions use the same number of threads).  Does nothing on
+ *  platforms other than Linux.
+ *
+ *  \param[in] affinity How to place the threads.
+ *  \param[in] first The number of threads pinned by lower ranks of the node.
+ *  \param[in] total The number of threads of all ranks of the node.
+ */
+inline void pin_threads(Affinity affinity, size_t first, size_t total)
+{
+#ifdef __linux__
+    if(affinity==Affinity::None)return;
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    if(sched_getaffinity(0,sizeof(available),&available))return;
+    std::vector<int> cpus;
+    for(int i=0;i<CPU_SETSIZE;++i)
+        if(CPU_ISSET(i,&available))cpus.push_back(i);
+    if(cpus.empty())return;
+    const size_t ncpus=cpus.size();
+    //If launcher already gave this rank its own cores it has no offset
+    const bool shared=total>0 && ncpus>=total;
+    const size_t offset=shared ? first : 0;
+    const size_t nused=shared ? total : static_cast<size_t>(num_threads());
+    const size_t stride=(affinity==Affinity::Spread) ?
+                std::max<size_t>(1,ncpus/std::max<size_t>(1,nused)) : 1;
+    #pragma omp parallel num_threads(num_threads())
+    {
+        const size_t tid=static_cast<size_t>(omp_get_thread_num());
+        cpu_set_t mine;
+        CPU_ZERO(&mine);
+        CPU_SET(cpus[((offset+tid)*stride)%ncpus],&mine);
+        pthread_setaffinity_np(pthread_self(),sizeof(mine),&mine);
+    }
+#else
+    (void)affinity;
+    (void)first;
+    (void)total;
+#endif
+}
+
+}}//End namespaces
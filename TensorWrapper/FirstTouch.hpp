@@ -0,0 +1,77 @@
+#pragma once
+#include "TensorWrapper/Execution.hpp"
+#include <algorithm>
+#include <omp.h>
+#include <unistd.h>
+
+namespace TWrapper {
+
+/** \brief The ways the pages of a newly allocated tensor can be placed.
+ *
+ *  Operating systems place a page of memory on the NUMA node of the thread
+ *  that first writes to it.  By choosing which thread initializes which
+ *  elements we can thus control where the tensor ends up.
+ */
+enum class AllocationPolicy {
+    Local,      //!< The allocating thread touches everything (the default)
+    Interleave, //!< Pages are dealt round-robin to the OpenMP threads
+    Partitioned //!< Each OpenMP thread touches its static share of elements
+};
+
+namespace detail_ {
+
+///Returns the process-wide allocation policy (set via RunTime)
+inline AllocationPolicy& allocation_policy()noexcept
+{
+    static AllocationPolicy policy=AllocationPolicy::Local;
+    return policy;
+}
+
+/** \brief Initializes a newly allocated buffer, placing its pages according
+ *  to a policy.
+ *
+ *  AllocationPolicy::Partitioned uses the same static split of the elements as
+ *  a `#pragma omp parallel for schedule(static)` loop (and Eigen's parallel
+ *  evaluation) so that each thread later finds its elements on its own NUMA
+ *  node.  AllocationPolicy::Interleave instead spreads consecutive pages over
+ *  the threads, which evens out bandwidth for irregular access patterns.
+ *
+ *  \param[in] buffer The memory to initialize.
+ *  \param[in] n The number of elements in \p buffer.
+ *  \param[in] value The value every element is set to.
+ *  \param[in] policy Which threads touch which elements.
+ *
+ *  \tparam T The type of an element.
+ */
+template<typename T>
+void first_touch(T* buffer, size_t n, const T& value, AllocationPolicy policy)
+{
+    const long nelems=static_cast<long>(n);
+    switch(policy)
+    {
+        case AllocationPolicy::Local:
+        {
+            std::fill(buffer,buffer+n,value);
+            break;
+        }
+        case AllocationPolicy::Partitioned:
+        {
+            #pragma omp parallel for schedule(static) num_threads(num_threads())
+            for(long i=0;i<nelems;++i)buffer[i]=value;
+            break;
+        }
+        case AllocationPolicy::Interleave:
+        {
+            const long page=std::max<long>(1,sysconf(_SC_PAGESIZE)/sizeof(T));
+            const long npages=(nelems+page-1)/page;
+            #pragma omp parallel for schedule(static,1) \
+                                 num_threads(num_threads())
+            for(long p=0;p<npages;++p)
+                std::fill(buffer+p*page,buffer+std::min(nelems,(p+1)*page),
+                          value);
+            break;
+        }
+    }
+}
+
+}}//End namespaces
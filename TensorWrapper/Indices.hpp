@@ -1,7 +1,9 @@
 #pragma once
-#include <utility>
-#include <tuple>
+#include <array>
 #include <cstdlib>
+#include <string>
+#include <tuple>
+#include <utility>
 
 /** \file Contains the classes and free functions for performing compile-time
  *  parsing of string indices.
@@ -14,7 +16,7 @@
  *  indices occur on the smae tensor (like the trace of a matrix) or they occur
  *  on two different tensors in the term.  We leave it for the IndexedTensor
  *  class to take care of the dispatching of these two cases.
- * 
+ *
  *  It is perhaps also worth clarifying what assuming an index only occurs twice
  *  actually entails for this machinery.  Basically it boils down to the
  *  get_free/get_dummy functions which assume that if an index is unique/common
@@ -26,8 +28,14 @@
  *  here is quite general and should work even if an index does not appear only
  *  twice.
  *
- *  This whole file can really use some clean-up.  It should be possible to
- *  rewrite most (all?) of the routines in terms of get_map
+ *  The queries on a set of indices (counts, common and unique indices, maps
+ *  between sets) are constexpr loops over arrays of index ids rather than
+ *  template recursion over the indices' types.  The id of an index is the
+ *  position of the first index of the same type among the indices being
+ *  compared (see IndexIds), so two indices are the same exactly when their
+ *  C_String types are.  A term therefore instantiates one function per query
+ *  instead of one type per index visited, which is what dominates the compile
+ *  time and memory of codes with many terms (e.g. CCSD.cpp).
  *
  */
 
@@ -48,7 +56,8 @@ template <char c,char...Chars>
 struct HashedCString<c,Chars...>{
     constexpr static size_t old_hash=HashedCString<Chars...>::value;
     constexpr static size_t value=
-         old_hash^static_cast<size_t>(c)+0x9e3779b9+(old_hash<<6)+(old_hash>>2);
+         old_hash^(static_cast<size_t>(c)+0x9e3779b9+(old_hash<<6)+
+                   (old_hash>>2));
 };
 
 /** \brief Compile-time class to hold an index.
@@ -96,22 +105,90 @@ auto build_string(std::index_sequence<I...>) {
                 std::make_index_sequence<sizeof(str)>());\
 }()
 
+template<typename...Args>
+class Indices;
 
+///The position of the first type in \p Ts that is \p T
+template<typename T, typename...Ts>
+constexpr size_t first_same()noexcept
+{
+    const std::array<bool,sizeof...(Ts)> same{{std::is_same<T,Ts>::value...}};
+    for(size_t i=0;i<same.size();++i)
+        if(same[i])
+            return i;
+    return same.size();
+}
 
-
-/** \brief A class to hold the various indices associated with a tensor.
+/** \brief Assigns ids to indices so that they can be compared in constexpr
+ *  loops.
  *
- *  This class is designed to be used at compile-time.  Ultimately it is pure
- *  template meta-programming with a pretty face thanks to C++11's constexpr.
+ *  The id of an index is the position of the first index in \p All of the
+ *  same type.  Two indices drawn from \p All therefore have equal ids if and
+ *  only if they are the same index.
  *
- *  If this class gets too slow try writing in terms of hashes.  I started
- *  making a slimmed down version of this file in Indices2.hpp that uses
- *  hashes.
+ *  \tparam All Every index being compared (e.g. those of two sets).
+ */
+template<typename...All>
+struct IndexIds{
+    ///The ids of the indices in \p set
+    template<typename...Set>
+    constexpr static std::array<size_t,sizeof...(Set)>
+    of(const Indices<Set...>&)noexcept
+    {
+        return {{first_same<Set,All...>()...}};
+    }
+};
+
+///The number of times \p id appears in \p ids
+template<size_t N>
+constexpr size_t count_id(const std::array<size_t,N>& ids, size_t id)
+{
+    size_t rv=0;
+    for(size_t i=0;i<N;++i)
+        rv+=(ids[i]==id);
+    return rv;
+}
+
+///The position of the \p cnt -th occurrence of \p id in \p ids, or N
+template<size_t N>
+constexpr size_t find_id(const std::array<size_t,N>& ids, size_t cnt,
+                         size_t id)
+{
+    for(size_t i=0;i<N;++i)
+        if(ids[i]==id && cnt--==0)
+            return i;
+    return N;
+}
+
+///The number of ids in \p lhs that also appear in \p rhs
+template<size_t L, size_t R>
+constexpr size_t ncommon_id(const std::array<size_t,L>& lhs,
+                            const std::array<size_t,R>& rhs)
+{
+    size_t rv=0;
+    for(size_t i=0;i<L;++i)
+        rv+=(count_id(rhs,lhs[i])!=0);
+    return rv;
+}
+
+/** \brief The position in \p lhs of the \p i -th id that appears in \p rhs
+ *  (if \p common is true) or that does not (if \p common is false), or L.
+ */
+template<size_t L, size_t R>
+constexpr size_t ith_id(size_t i, const std::array<size_t,L>& lhs,
+                        const std::array<size_t,R>& rhs, bool common)
+{
+    for(size_t k=0;k<L;++k)
+        if((count_id(rhs,lhs[k])!=0)==common && i--==0)
+            return k;
+    return L;
+}
+
+/** \brief A class to hold the various indices associated with a tensor.
  *
- *  \TODO: there's alot of private recursion going on that is pretty similar.
- *  It should be possible to consolidate into the get_common/get_unique
- *  recursion trees, but at the moment those routines are written in terms of
- *  the other ones.
+ *  This class is designed to be used at compile-time.  The indices are kept as
+ *  a parameter pack so that the individual indices can be retrieved, but all
+ *  of the queries are answered from the ids of the indices (see IndexIds).
  *
  * \tparam Args The indices wrapped in this instance.
  */
@@ -123,120 +200,31 @@ private:
     template<size_t I>
     using TypeI=typename std::tuple_element<I,std::tuple<Args...>>::type;
 
-    ///The return type when recursion ends
-    template<size_t I,typename return_t>
-    using EndRecursion=
-        typename std::enable_if<I==sizeof...(Args),return_t>::type;
-
-    ///The return type while recursion is occurring
-    template<size_t I,typename return_t>
-    using Recursion=
-        typename std::enable_if<I!=sizeof...(Args),return_t>::type;
-
-    ///End point for counting an index
-    template<size_t I, char...Chars>
-    constexpr
-    static EndRecursion<I,size_t> count_impl(const C_String<Chars...>&)
-    {
-        return 0;
-    }
-
-    ///Recursion body for counting
-    template<size_t I, char...Chars>
-    constexpr
-    static Recursion<I,size_t> count_impl(const C_String<Chars...>& other)
-    {
-        return (get<I>()==other) + count_impl<I+1>(other);
-    }
-
-    template<size_t...I>
-    constexpr
-    static std::array<size_t,sizeof...(I)>
-    get_counts_impl(std::index_sequence<I...>)
-    {
-        return {count(get<I>())...};
-    }
-
-
-    template<size_t I,typename...Args2>
-    constexpr static bool is_common(const Indices<Args2...>& other)
-    {
-        return other.count(get<I>())!=0;
-    }
-
-
-    template<size_t I,typename...Args2>
-    constexpr
-    static EndRecursion<I,size_t> ncommon_impl(const Indices<Args2...>&)
-    {
-        return 0;
-    }
-
-    template<size_t I,typename...Args2>
-    constexpr
-    static Recursion<I,size_t> ncommon_impl(const Indices<Args2...>& other)
+    ///The ids of the indices in \p set among this set's followed by Args2
+    template<typename...Args2,typename Set_t>
+    constexpr static auto ids_with(const Set_t& set)noexcept
     {
-        return is_common<I>(other) + ncommon_impl<I+1>(other);
-    }
-
-
-    template<size_t, size_t depth,typename...Args2>
-    constexpr
-    static EndRecursion<depth,size_t>
-    ith_common_impl(size_t,const Indices<Args2...>&)
-    {
-        return depth;
-    }
-
-    template<size_t counter, size_t depth,typename...Args2>
-    constexpr static Recursion<depth,size_t>
-    ith_common_impl(size_t I,const Indices<Args2...>& other)
-    {
-        constexpr bool is_good = is_common<depth>(other);
-        return (is_good && counter==I)? depth :
-                      ith_common_impl<counter+is_good,depth+1>(I,other);
+        return IndexIds<Args...,Args2...>::of(set);
     }
 
     template<typename...Args2,size_t...I>
     constexpr static std::array<size_t,sizeof...(I)>
-    get_common_impl(const Indices<Args2...>& other,
-                    std::index_sequence<I...>)
+    get_common_impl(std::index_sequence<I...>)noexcept
     {
-        return {ith_common(I,other)...};
+        return {{ith_common(I,Indices<Args2...>())...}};
     }
 
     template<typename...Args2,size_t...I>
     constexpr static std::array<size_t,sizeof...(I)>
-    get_unique_impl(const Indices<Args2...>& other,
-                    std::index_sequence<I...>)
-    {
-        return {ith_unique(I,other)...};
-    }
-
-    template<size_t I, size_t, char...Chars>
-    constexpr static EndRecursion<I,size_t>
-    position_impl(size_t, const C_String<Chars...>&)
-    {
-        return I;
-    }
-
-    template<size_t I, size_t counter, char...Chars>
-    constexpr static Recursion<I,size_t>
-    position_impl(size_t cnt, const C_String<Chars...>& other)
-    {
-        constexpr bool is_good=(get<I>()==other);
-        return (is_good && counter==cnt) ? I :
-                              position_impl<I+1,counter+is_good>(cnt,other);
-    }
-
-    template<typename RHS_t,size_t...I>
-    constexpr static std::array<size_t,sizeof...(I)>
-    get_map_impl(const RHS_t& rhs,std::index_sequence<I...>)noexcept
+    get_unique_impl(std::index_sequence<I...>)noexcept
     {
-        return {rhs.position(0,get<I>())...};
+        return {{ith_unique(I,Indices<Args2...>())...}};
     }
 
 public:
+    ///The type of the array holding the ids of the indices
+    using id_array=std::array<size_t,sizeof...(Args)>;
+
     /** \brief Returns the number of indices contained within this index set.
      *
      *
@@ -248,6 +236,21 @@ public:
         return sizeof...(Args);
     }
 
+    /** \brief Returns the ids of the indices in this set.
+     *
+     *  Element i is the position of the first index in this set that is the
+     *  same as the i-th index, so two indices of this set are the same if and
+     *  only if their ids are equal.  The array is const so that indexing it is
+     *  a constant expression in C++14.
+     *
+     *  \returns A size() element array of the ids of the indices.
+     *  \throws None. No throw guarantee.
+     */
+    constexpr static const id_array ids() noexcept
+    {
+        return {{first_same<Args,Args...>()...}};
+    }
+
     /** \brief Returns the \p I -th index in the set.
      *
      * \note The index to return must be passed as a template non-type to avoid
@@ -267,7 +270,7 @@ public:
     template<size_t I>
     constexpr static TypeI<I> get() noexcept
     {
-        return std::get<I>(std::tuple<Args...>());
+        return TypeI<I>();
     }
 
 
@@ -280,9 +283,11 @@ public:
      * \throws None.  No throw guarantee.
      */
     template<char...Chars>
-    constexpr static size_t count(const C_String<Chars...>& idx)noexcept
+    constexpr static size_t count(const C_String<Chars...>&)noexcept
     {
-        return count_impl<0>(idx);
+        using idx_t=C_String<Chars...>;
+        return count_id(ids_with<idx_t>(Indices()),
+                        first_same<idx_t,Args...,idx_t>());
     }
 
     /** \brief Returns an array containing the number of times each index
@@ -299,7 +304,7 @@ public:
     constexpr static std::array<size_t,sizeof...(Args)>
     get_counts()noexcept
     {
-        return get_counts_impl(std::make_index_sequence<sizeof...(Args)>());
+        return {{count_id(ids(),first_same<Args,Args...>())...}};
     }
 
 
@@ -338,10 +343,10 @@ public:
      *  \throw None. No throw guarantee.
      */
     template<typename...Args2>
-    constexpr static size_t ncommon(const Indices<Args2...>& other)noexcept
+    constexpr static size_t ncommon(const Indices<Args2...>&)noexcept
     {
-        return ncommon_impl<0>(other);
-
+        return ncommon_id(ids_with<Args2...>(Indices()),
+                          ids_with<Args2...>(Indices<Args2...>()));
     }
 
     /** \brief Returns the position of the \p I -th index in this set that is
@@ -366,9 +371,10 @@ public:
      */
     template<typename...Args2>
     constexpr static size_t
-    ith_common(size_t i,const Indices<Args2...>& other)noexcept
+    ith_common(size_t i,const Indices<Args2...>&)noexcept
     {
-        return ith_common_impl<0,0>(i,other);
+        return ith_id(i,ids_with<Args2...>(Indices()),
+                      ids_with<Args2...>(Indices<Args2...>()),true);
     }
 
 
@@ -387,10 +393,10 @@ public:
      *  \throws None. No throw guarantee.
      */
     template<typename...Args2>
-    constexpr static auto get_common(const Indices<Args2...>& other)noexcept
+    constexpr static auto get_common(const Indices<Args2...>&)noexcept
     {
-        constexpr size_t ncomm=ncommon(other);
-        return get_common_impl(other,std::make_index_sequence<ncomm>());
+        constexpr size_t ncomm=ncommon(Indices<Args2...>());
+        return get_common_impl<Args2...>(std::make_index_sequence<ncomm>());
     }
 
 
@@ -427,24 +433,10 @@ public:
      */
     template<typename...Args2>
     constexpr static size_t
-    ith_unique(size_t i, const Indices<Args2...>& other)noexcept
+    ith_unique(size_t i, const Indices<Args2...>&)noexcept
     {
-
-        constexpr size_t com=ncommon(other);
-        constexpr std::array<size_t,com> common=get_common(other);
-        constexpr size_t N=size();
-        size_t counter=0;
-        for(size_t k=0;k<N;++k)
-        {
-            bool is_good=true;
-            for(size_t j=0;j<com && is_good; ++j)
-                is_good=(common[j]!=k);
-
-            if(is_good && counter==i)
-                return k;
-            counter+=is_good;
-        }
-        return N;
+        return ith_id(i,ids_with<Args2...>(Indices()),
+                      ids_with<Args2...>(Indices<Args2...>()),false);
     }
 
 
@@ -459,30 +451,37 @@ public:
      *  \throw None. No throw guarantee
      */
     template<typename...Args2>
-    constexpr static auto get_unique(const Indices<Args2...>& other)noexcept
+    constexpr static auto get_unique(const Indices<Args2...>&)noexcept
     {
-        constexpr size_t unq=nunique(other);
-        return get_unique_impl(other,std::make_index_sequence<unq>());
+        constexpr size_t unq=nunique(Indices<Args2...>());
+        return get_unique_impl<Args2...>(std::make_index_sequence<unq>());
     }
 
+    ///Returns true if the \p i -th index of this set does not appear in other
     template<size_t i,typename...Args2>
     constexpr static bool
-    is_unique(const Indices<Args2...>& other)noexcept
+    is_unique(const Indices<Args2...>&)noexcept
     {
-        constexpr auto unique=get_unique(Indices<Args2...>{});
-        constexpr size_t nunq=nunique(Indices<Args2...>{});
-        for(size_t j=0;j<nunq;++j)
-            if(unique[j]==i)
-                return true;
-        return false;
+        return count_id(ids_with<Args2...>(Indices<Args2...>()),
+                        first_same<TypeI<i>,Args...,Args2...>())==0;
     }
 
-
-    template<typename RHS_t>
-    constexpr auto static get_map(const RHS_t& rhs)noexcept
+    /** \brief Returns the position in \p rhs of each of the indices in this
+     *  set.
+     *
+     *  \param[in] rhs The set to map this set onto.
+     *  \returns A size() element array where element i is the position of the
+     *  first occurrence of the i-th index of this set in \p rhs, or
+     *  rhs.size() if it does not appear there.
+     *  \tparam Args2 The indices in the other set.
+     *  \throws None. No throw guarantee.
+     */
+    template<typename...Args2>
+    constexpr static std::array<size_t,sizeof...(Args)>
+    get_map(const Indices<Args2...>&)noexcept
     {
-        constexpr size_t rank=size();
-        return get_map_impl(rhs,std::make_index_sequence<rank>());
+        return {{find_id(ids_with<Args2...>(Indices<Args2...>()),0,
+                         first_same<Args,Args...,Args2...>())...}};
     }
 
     /** \brief Returns the position of the \p cnt -th occurence of index
@@ -498,9 +497,11 @@ public:
      * \throw None.  No thorw guarantee.
      */
     template<char...Chars>
-    constexpr static size_t position(size_t cnt, const C_String<Chars...>& other)
+    constexpr static size_t position(size_t cnt, const C_String<Chars...>&)
     {
-        return position_impl<0,0>(cnt,other);
+        using idx_t=C_String<Chars...>;
+        return find_id(ids_with<idx_t>(Indices()),cnt,
+                       first_same<idx_t,Args...,idx_t>());
     }
 
 };
@@ -533,65 +534,77 @@ struct MakeUnion<LHS_t,Indices<Args...>>
     using type=Indices<LHS_t,Args...>;
 };
 
-
-template<size_t Idx, bool Lgood, bool Rgood, size_t LMax, size_t RMax,
-         typename LHS_t, typename RHS_t>
-struct FreeIndicesImpl;
-
-template<size_t LMax, size_t RMax,typename LHS_t, typename RHS_t>
-struct FreeIndicesImpl<RMax,false,false,LMax,RMax,LHS_t,RHS_t>
+///The indices of \p LHS_t at positions \p L followed by those of \p RHS_t at
+///positions \p R (only used in decltype)
+template<typename LHS_t, typename RHS_t, size_t...L, size_t...R>
+Indices<decltype(LHS_t::template get<L>())...,
+        decltype(RHS_t::template get<R>())...>
+select_indices(std::index_sequence<L...>, std::index_sequence<R...>);
+
+template<typename LHS_t, typename RHS_t, size_t...NLHS, size_t...NRHS>
+auto free_indices(std::index_sequence<NLHS...>, std::index_sequence<NRHS...>)
+    -> decltype(select_indices<LHS_t,RHS_t>(
+        std::index_sequence<LHS_t::ith_unique(NLHS,RHS_t())...>(),
+        std::index_sequence<RHS_t::ith_unique(NRHS,LHS_t())...>()));
+
+/** \brief The indices of a pairwise contraction, i.e. the indices of \p LHS_t
+ *  that are not in \p RHS_t followed by those of \p RHS_t not in \p LHS_t.
+ */
+template<typename LHS_t, typename RHS_t>
+struct FreeIndices
 {
-    using type=Indices<>;
+    constexpr static size_t LMax=LHS_t::nunique(RHS_t());
+    constexpr static size_t RMax=RHS_t::nunique(LHS_t());
+    using type=decltype(free_indices<LHS_t,RHS_t>(
+                            std::make_index_sequence<LMax>(),
+                            std::make_index_sequence<RMax>()));
 };
 
-template<size_t Idx, size_t LMax, size_t RMax, typename LHS_t, typename RHS_t>
-struct FreeIndicesImpl<Idx,false,true,LMax,RMax,LHS_t,RHS_t> : public
-        FreeIndicesImpl<Idx+1,false,Idx+1!=RMax,LMax,RMax,LHS_t,RHS_t>
+///The position in \p Idx_t of the \p i -th index appearing once in it
+template<typename Idx_t>
+constexpr size_t ith_single(size_t i)noexcept
 {
-    constexpr static bool is_unique=RHS_t::template is_unique<Idx>(LHS_t{});
-    constexpr static bool rgood=Idx+1!=RMax;
-    using base_type=typename
-        FreeIndicesImpl<Idx+1,false,Idx+1!=RMax,LMax,RMax,LHS_t,RHS_t>::type;
-    using Idx_t=decltype(RHS_t::template get<Idx>());
-    using unique_type=typename MakeUnion<Idx_t,base_type>::type;
-    using type=typename std::conditional<is_unique,unique_type,base_type>::type;
-};
+    const auto ids=Idx_t::ids();
+    for(size_t k=0;k<ids.size();++k)
+        if(count_id(ids,ids[k])==1 && i--==0)
+            return k;
+    return ids.size();
+}
 
-template<size_t Idx, size_t LMax, size_t RMax,typename LHS_t, typename RHS_t>
-struct FreeIndicesImpl<Idx,true,true,LMax, RMax,LHS_t,RHS_t> : public
-     FreeIndicesImpl<Idx+1!=LMax?Idx+1:0,Idx+1!=LMax,true,LMax,RMax,LHS_t,RHS_t>
+///The number of indices appearing once in \p Idx_t
+template<typename Idx_t>
+constexpr size_t nsingle()noexcept
 {
-    constexpr static bool is_unique=LHS_t::template is_unique<Idx>(RHS_t{});
-    constexpr static bool lgood=Idx+1!=LMax;
-    constexpr static bool rgood=0!=RMax;
-    using base_type=typename
-        FreeIndicesImpl<lgood?Idx+1:0,lgood,true,LMax,RMax,LHS_t,RHS_t>::type;
-    using Idx_t=decltype(LHS_t::template get<Idx>());
-    using unique_type=typename MakeUnion<Idx_t,base_type>::type;
-    using type=typename std::conditional<is_unique,unique_type,base_type>::type;
-};
+    const auto ids=Idx_t::ids();
+    size_t rv=0;
+    for(size_t k=0;k<ids.size();++k)
+        rv+=(count_id(ids,ids[k])==1);
+    return rv;
+}
 
-template<typename LHS_t, typename RHS_t>
-struct FreeIndices
+template<typename Idx_t, size_t...I>
+auto single_indices(std::index_sequence<I...>)
+    -> decltype(select_indices<Idx_t,Indices<>>(
+        std::index_sequence<ith_single<Idx_t>(I)...>(),
+        std::index_sequence<>()));
+
+/** \brief The indices left after tracing over the repeated indices of
+ *  \p Idx_t, i.e. those appearing once in it, in order.
+ */
+template<typename Idx_t>
+struct TracedIndices
 {
-    constexpr static size_t LMax=LHS_t::size();
-    constexpr static size_t RMax=RHS_t::size();
-    constexpr static bool lgood=0!=LMax;
-    constexpr static bool rgood=0!=RMax;
-    using type=
-        typename FreeIndicesImpl<0,lgood,rgood,LMax,RMax,LHS_t,RHS_t>::type;
+    using type=decltype(single_indices<Idx_t>(
+                            std::make_index_sequence<nsingle<Idx_t>()>()));
 };
 
 template<typename LHS_t, typename RHS_t, size_t...NLHS,size_t...NRHS>
 constexpr std::pair<std::array<size_t,sizeof...(NLHS)>,
                     std::array<size_t,sizeof...(NRHS)>>
-get_free_impl(const LHS_t& lhs,
-              const RHS_t& rhs,
-              std::index_sequence<NLHS...>,
-              std::index_sequence<NRHS...>)
+get_free_impl(std::index_sequence<NLHS...>, std::index_sequence<NRHS...>)
 {
-    return {{LHS_t::ith_unique(NLHS,rhs)...},
-            {RHS_t::ith_unique(NRHS,lhs)...}};
+    return {{{LHS_t::ith_unique(NLHS,RHS_t())...}},
+            {{RHS_t::ith_unique(NRHS,LHS_t())...}}};
 }
 
 
@@ -604,27 +617,29 @@ get_free_impl(const LHS_t& lhs,
  *
  */
 template<typename LHS_t, typename RHS_t>
-constexpr auto get_free(const LHS_t& lhs, const RHS_t& rhs)noexcept
+constexpr auto get_free(const LHS_t&, const RHS_t&)noexcept
 {
-   constexpr size_t lnfree=lhs.nunique(rhs);
-   constexpr size_t rnfree=rhs.nunique(lhs);
-   return get_free_impl(lhs,rhs,
-                        std::make_index_sequence<lnfree>(),
-                        std::make_index_sequence<rnfree>());
+   constexpr size_t lnfree=LHS_t::nunique(RHS_t());
+   constexpr size_t rnfree=RHS_t::nunique(LHS_t());
+   return get_free_impl<LHS_t,RHS_t>(std::make_index_sequence<lnfree>(),
+                                     std::make_index_sequence<rnfree>());
+}
+
+///The position in \p RHS_t of the \p i -th index of \p LHS_t common to both
+template<typename LHS_t, typename RHS_t>
+constexpr size_t ith_dummy(size_t i)noexcept
+{
+    const auto map=LHS_t::get_map(RHS_t());
+    return map[LHS_t::ith_common(i,RHS_t())];
 }
 
 template<typename LHS_t, typename RHS_t, size_t...NLHS>
 constexpr std::pair<std::array<size_t,sizeof...(NLHS)>,
                     std::array<size_t,sizeof...(NLHS)>>
-get_dummy_impl(const LHS_t& lhs,
-               const RHS_t& rhs,
-               std::index_sequence<NLHS...>)
+get_dummy_impl(std::index_sequence<NLHS...>)
 {
-    constexpr auto lcommon=lhs.get_common(rhs);
-    if(lcommon.size()==0)//Technically not needed, but shuts compiler up
-        return {{},{}};
-    return {{lcommon[NLHS]...},
-            {RHS_t::position(0,lhs.template get<lcommon[NLHS]>())...}};
+    return {{{LHS_t::ith_common(NLHS,RHS_t())...}},
+            {{ith_dummy<LHS_t,RHS_t>(NLHS)...}}};
 }
 
 
@@ -640,12 +655,12 @@ get_dummy_impl(const LHS_t& lhs,
  *
  */
 template<typename LHS_t, typename RHS_t>
-constexpr auto get_dummy(const LHS_t& lhs, const RHS_t& rhs)noexcept
+constexpr auto get_dummy(const LHS_t&, const RHS_t&)noexcept
 {
-   constexpr size_t lcommon=lhs.ncommon(rhs);
-   constexpr size_t rcommon=rhs.ncommon(lhs);
+   constexpr size_t lcommon=LHS_t::ncommon(RHS_t());
+   constexpr size_t rcommon=RHS_t::ncommon(LHS_t());
    static_assert(lcommon==rcommon,"Error an index appears more than twice");
-   return get_dummy_impl(lhs,rhs,std::make_index_sequence<lcommon>());
+   return get_dummy_impl<LHS_t,RHS_t>(std::make_index_sequence<lcommon>());
 }
 
 template<char...Cs>
@@ -668,31 +683,14 @@ std::string stringify(const Indices<Args...>&,std::string spacer=",")
     return rv;
 }
 
-template<size_t R>
-struct GenericIndexBase;
-
-template<size_t R>
-struct GenericIndexBase:public GenericIndexBase<R-1> {
-    using base_t=GenericIndexBase<R-1>;
-    static constexpr char value=static_cast<char>(R);
-    using my_idx=C_String<value,'\0'>;
-    using type=typename MakeUnion<my_idx,typename base_t::type>::type;
-};
-
-template<>
-struct GenericIndexBase<0>{
-    static constexpr char value=static_cast<char>(0);
-    using type=make_indices<C_String<value,'\0'>>;
-};
+template<size_t R, size_t...I>
+Indices<C_String<static_cast<char>(R-1-I),'\0'>...>
+generic_index(std::index_sequence<I...>);
 
+///The indices of a rank \p R tensor that the user did not name
 template<size_t R>
 struct GenericIndex{
-    using type=typename GenericIndexBase<R-1>::type;
-};
-
-template<>
-struct GenericIndex<0>{
-    using type=Indices<>;
+    using type=decltype(generic_index<R>(std::make_index_sequence<R>()));
 };
 
 }}//End namespaces
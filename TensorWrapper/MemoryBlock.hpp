@@ -1,5 +1,6 @@
 #pragma once
 #include "TensorWrapper/Shape.hpp"
+#include "TensorWrapper/AlignedBuffer.hpp"
 #include <vector>
 #include <functional>
 #include <memory>
@@ -36,7 +37,7 @@ namespace TWrapper {
  *      size_t counter=0;
  *      for(const auto& idx : shapei)
  *      {
- *          buffer[counter++]=//set to data for idx;
+ *          buffer[mem.offset(blocki,counter++,idx)]=//set to data for idx;
  *      }//End loop over block's indices
  *
  *  }//End loop over blocks
@@ -157,10 +158,36 @@ public:
     void add_block(std::unique_ptr<T[]>&& mem, const Shape<rank>& shape)
     {
         T* _mem=mem.get();
-        memory_.push_back(std::move(mem));
+        memory_.emplace_back(mem.release(),detail_::BufferDeleter<T>{false});
         add_block(_mem,shape);
     }
 
+    /** \brief Adds a new block, whose memory this instance allocates and
+     *  owns, to the instance.
+     *
+     *  The buffer is aligned, and the fastest-running dimension possibly
+     *  padded, according to the RunTime's buffer options.  Use offset() (or
+     *  the strides of shape()) to locate an element.
+     *
+     *  \param[in] end The last index of the block.
+     *  \param[in] row_major Should the block be laid out row major?
+     *  \param[in] start The first index of the block.
+     *  \returns A pointer to the uninitialized buffer.
+     *  \throws std::bad_alloc if allocation fails.  Weak throw guarantee.
+     */
+    T* allocate_block(const index_type& end, bool row_major=true,
+                      const index_type& start=index_type{})
+    {
+        const auto& options=detail_::buffer_options();
+        const Shape<rank> shape=(options.pad ?
+                detail_::padded_shape<T>(end,row_major,start) :
+                Shape<rank>(end,row_major,start));
+        T* _mem=detail_::aligned_allocate<T>(shape.extent(),options.alignment);
+        memory_.emplace_back(_mem,detail_::BufferDeleter<T>{true});
+        add_block(_mem,shape);
+        return _mem;
+    }
+
     /** \brief Returns the number of blocks currently managed by this instance.
      *
      * \returns The number of blocks currently managed by this instance.
@@ -211,6 +238,37 @@ public:
         return shapes_[blocki].end();
     }
 
+    /** \brief Returns the shape of a specified block.
+     *
+     *  \param[in] blocki The block whose shape is wanted.  Must be in the
+     *             range [0,nblocks()); no check is made.
+     *  \throws None.  No throw guarantee.
+     */
+    const Shape<rank>& shape(size_t blocki)const noexcept
+    {
+        return shapes_[blocki];
+    }
+
+    /** \brief Returns where, relative to block(blocki), the element for an
+     *  index lives.
+     *
+     *  Packed blocks store their elements in the order the iterators of the
+     *  block visit the indices, so the element of the \p n-th index visited is
+     *  at offset \p n.  Padded blocks are instead laid out by the strides of
+     *  their shape.
+     *
+     *  \param[in] blocki The block \p idx is in.
+     *  \param[in] n How many indices of the block were visited before \p idx.
+     *  \param[in] idx The index whose element is wanted.
+     *  \returns The offset of the element from block(blocki).
+     *  \throws None.  No throw guarantee.
+     */
+    size_t offset(size_t blocki,size_t n,const index_type& idx)const noexcept
+    {
+        const Shape<rank>& shapei=shapes_[blocki];
+        return shapei.is_contiguous() ? n : shapei.offset(idx);
+    }
+
 private:
 
     ///The type of an index
@@ -220,7 +278,7 @@ private:
     std::vector<T*> buffers_;
 
     ///If the tensor doesn't expose T* these are the managed blocks
-    std::vector<std::unique_ptr<T[]>> memory_;
+    std::vector<std::unique_ptr<T,detail_::BufferDeleter<T>>> memory_;
 
     ///These are the shapes of each block
     std::vector<Shape<rank>> shapes_;
@@ -20,6 +20,7 @@
 #include "TensorWrapper/Operations/IndexedTensor.hpp"
 #include "TensorWrapper/Operations/Contraction.hpp"
 #include "TensorWrapper/Operations/Trace.hpp"
+#include "TensorWrapper/Operations/Cost.hpp"
 
 /** \brief \relates AddOp
  *
@@ -62,6 +62,18 @@ struct AddOp: public OperationBase<AddOp<LHS_t,RHS_t>>{
         return lhs_.dimensions();
     }
 
+    ///One addition per element of the result
+    double flops()const
+    {
+        return element_count(dimensions());
+    }
+
+    ///Both tensors are read and the result is written
+    double bytes()const
+    {
+        return 3.0*sizeof(scalar_type)*element_count(dimensions());
+    }
+
     /** \brief Actually evaluates the addition
      *
      *   When called this function will call eval on both the left and right
@@ -86,6 +98,9 @@ struct AddOp: public OperationBase<AddOp<LHS_t,RHS_t>>{
         using ridx=typename RHS_t::indices;
         static_assert(lidx::size()==ridx::size(),
                       "Can not add tensors of different rank");
+        TWRAPPER_PROFILE(profile,"Add",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
+        TWRAPPER_PROFILE_FLOPS(profile,flops());
 
         return TensorWrapperImpl<rank,scalar_type,TT>().
                 template add<lidx,ridx>(lhs_.template eval<TT>(),
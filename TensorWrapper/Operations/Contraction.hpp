@@ -58,6 +58,31 @@ struct Contraction: public OperationBase<Contraction<LHS_t,RHS_t>> {
         return rv;
     }
 
+    /** \brief A multiplication and an addition for each pair of elements
+     *  that are multiplied together.
+     *
+     *  That is, twice the size of the result times the extent of the
+     *  contracted indices.
+     */
+    double flops()const
+    {
+        auto free=get_free(typename LHS_t::indices(),
+                           typename RHS_t::indices());
+        auto ldims=lhs_.dimensions();
+        double nfree=1.0;
+        for(size_t i : free.first)nfree*=ldims[i];
+        const double ncontracted=element_count(ldims)/nfree;
+        return 2.0*element_count(dimensions())*ncontracted;
+    }
+
+    ///Each tensor is read once and the result is written once
+    double bytes()const
+    {
+        return sizeof(scalar_type)*(element_count(lhs_.dimensions())+
+                                    element_count(rhs_.dimensions())+
+                                    element_count(dimensions()));
+    }
+
     /** \brief Actually runs the contraction.
      *
      * \returns Whatever the backend returns
@@ -67,6 +92,9 @@ struct Contraction: public OperationBase<Contraction<LHS_t,RHS_t>> {
     template<TensorTypes TT>
     auto eval()const
     {
+        TWRAPPER_PROFILE(profile,"Contraction",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
+        TWRAPPER_PROFILE_FLOPS(profile,flops());
         using Impl_t=TensorWrapperImpl<LHS_t::rank,scalar_type,TT>;
         return Impl_t().template contraction<typename LHS_t::indices,
                                              typename RHS_t::indices>(
@@ -0,0 +1,128 @@
+#pragma once
+#include "TensorWrapper/Operations/OperationBase.hpp"
+
+/** \file Sums the estimated cost of every operation in an expression.
+ *
+ *  Each operation estimates its own floating-point operations and the bytes
+ *  of tensor elements it reads and writes (flops() and bytes()) from its
+ *  dimensions and indices.  The estimates assume every operation reads its
+ *  inputs and writes its result once; they do not account for the lazy
+ *  evaluation of some backends, which may fuse operations and skip
+ *  temporaries.
+ */
+
+namespace TWrapper {
+
+///The estimated cost of evaluating an expression
+struct OperationCost{
+    double flops=0.0;       //!< Floating-point operations
+    double bytes=0.0;       //!< Bytes of tensor elements read and written
+    size_t noperations=0;   //!< Operations that do work (not permutations
+                            //!< that are no-ops or named tensors)
+
+    ///Floating-point operations per byte moved (the arithmetic intensity)
+    double intensity()const noexcept
+    {
+        return bytes>0.0 ? flops/bytes : 0.0;
+    }
+
+    OperationCost& operator+=(const OperationCost& other)noexcept
+    {
+        flops+=other.flops;
+        bytes+=other.bytes;
+        noperations+=other.noperations;
+        return *this;
+    }
+};
+
+namespace detail_ {
+
+///Walks an expression, adding each operation's estimates to a total
+struct ExpressionCost{
+    ///Adds the estimates of \p op itself to \p rv
+    template<typename Op_t>
+    static void add_node(const Op_t& op, OperationCost& rv)
+    {
+        const double flops=op.flops(),bytes=op.bytes();
+        rv.flops+=flops;
+        rv.bytes+=bytes;
+        if(flops>0.0 || bytes>0.0)++rv.noperations;
+    }
+
+    ///The tensors themselves cost nothing
+    template<typename data_t>
+    static void find(const Convert<data_t>&,OperationCost&){}
+
+    template<typename T, typename Tensor_t, typename Index_t>
+    static void find(const IndexedTensor<T,Tensor_t,Index_t>& op,
+                     OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.tensor_,rv);
+    }
+
+    template<typename NewIdx, typename OldIdx, typename Tensor_t>
+    static void find(const Permutation<NewIdx,OldIdx,Tensor_t>& op,
+                     OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.t_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const AddOp<LHS_t,RHS_t>& op,OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const SubtractionOp<LHS_t,RHS_t>& op,OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const Contraction<LHS_t,RHS_t>& op,OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t>
+    static void find(const ScaleOp<LHS_t>& op,OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.lhs_,rv);
+    }
+
+    template<typename Tensor_t>
+    static void find(const Trace<Tensor_t>& op,OperationCost& rv)
+    {
+        add_node(op,rv);
+        find(op.lhs_,rv);
+    }
+};
+
+}//End namespace detail_
+
+/** \brief Returns the estimated cost of evaluating \p op.
+ *
+ *  \code
+ *  auto c=cost(A(i,k)*B(k,j)+C(i,j));
+ *  std::cout<<c.flops<<" FLOPs, "<<c.bytes<<" bytes"<<std::endl;
+ *  \endcode
+ */
+template<typename Op_t>
+OperationCost cost(const detail_::OperationBase<Op_t>& op)
+{
+    OperationCost rv;
+    detail_::ExpressionCost::find(static_cast<const Op_t&>(op),rv);
+    return rv;
+}
+
+}//End namespace TWrapper
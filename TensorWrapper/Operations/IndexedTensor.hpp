@@ -53,6 +53,12 @@ struct IndexedTensor: public OperationBase<IndexedTensor<T,Tensor_t,Index_t>>
         return tensor_.dimensions();
     }
 
+    ///Naming a tensor costs nothing
+    double flops()const noexcept{return 0.0;}
+
+    ///Naming a tensor costs nothing
+    double bytes()const noexcept{return 0.0;}
+
     /** \brief Returns the result of calling eval on the wrapped tensor.
      *
      *  \returns The result of calling eval on the wrapped tensor.
@@ -1,4 +1,6 @@
 #pragma once
+#include "TensorWrapper/Profiler.hpp"
+#include <array>
 
 namespace TWrapper {
 namespace detail_ {
@@ -6,6 +8,15 @@ namespace detail_ {
 ///A type for when we are getting something that does not have indices
 struct IdxNotSet{};
 
+///The number of elements of a tensor with dimensions \p dims, as a double
+template<size_t R>
+double element_count(const std::array<size_t,R>& dims)noexcept
+{
+    double rv=1.0;
+    for(size_t x : dims)rv*=x;
+    return rv;
+}
+
 template<typename Derived_t>
 struct OperationBase{
 
@@ -52,6 +52,15 @@ struct Permutation: public OperationBase<Permutation<NewIdx,OldIdx,Tensor_t>> {
         return rv;
     }
 
+    ///Permuting moves elements without arithmetic
+    double flops()const noexcept{return 0.0;}
+
+    ///The tensor is read and the permuted copy is written
+    double bytes()const
+    {
+        return 2.0*sizeof(scalar_type)*element_count(dimensions());
+    }
+
     /** \brief Actually evaluates the permutation.
      *
      *
@@ -61,6 +70,8 @@ struct Permutation: public OperationBase<Permutation<NewIdx,OldIdx,Tensor_t>> {
                                permute(t_.template eval<TT>(),
                                        OldIdx::get_map(NewIdx())))
     {
+        TWRAPPER_PROFILE(profile,"Permute",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
         TensorWrapperImpl<rank,scalar_type,TT> impl;
         return impl.permute(t_.template eval<TT>(),
                             OldIdx::get_map(NewIdx()));
@@ -98,6 +109,12 @@ struct Permutation<NewIdx,NewIdx,Tensor_t>:
     ///The indices after permutation
     using indices=NewIdx;
 
+    ///No permutation is done, so it costs nothing
+    double flops()const noexcept{return 0.0;}
+
+    ///No permutation is done, so it costs nothing
+    double bytes()const noexcept{return 0.0;}
+
     /** \brief Actually evaluates the permutation.
      *
      *  This is a null op.
@@ -49,6 +49,18 @@ struct ScaleOp: public OperationBase<ScaleOp<LHS_t>>{
         return lhs_.dimensions();
     }
 
+    ///One multiplication per element
+    double flops()const
+    {
+        return element_count(dimensions());
+    }
+
+    ///The tensor is read and the result is written
+    double bytes()const
+    {
+        return 2.0*sizeof(scalar_type)*element_count(dimensions());
+    }
+
     /** \brief Actually scales the tensor.
      *
      * \tparam TT The enum for the backend we want to use for the scaling.
@@ -58,6 +70,9 @@ struct ScaleOp: public OperationBase<ScaleOp<LHS_t>>{
     template<TensorTypes TT>
     auto eval()const
     {
+        TWRAPPER_PROFILE(profile,"Scale",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
+        TWRAPPER_PROFILE_FLOPS(profile,flops());
         TensorWrapperImpl<rank,scalar_type,TT> impl;
         return impl.template scale<indices>(lhs_.template eval<TT>(),scalar_);
     }
@@ -58,6 +58,18 @@ struct SubtractionOp : public OperationBase<SubtractionOp<LHS_t,RHS_t>> {
         return lhs_.dimensions();
     }
 
+    ///One subtraction per element of the result
+    double flops()const
+    {
+        return element_count(dimensions());
+    }
+
+    ///Both tensors are read and the result is written
+    double bytes()const
+    {
+        return 3.0*sizeof(scalar_type)*element_count(dimensions());
+    }
+
     /** \brief Actually evaluates the subtraction.
      *
      * \returns Whatever the backend returns
@@ -67,6 +79,9 @@ struct SubtractionOp : public OperationBase<SubtractionOp<LHS_t,RHS_t>> {
     template<TensorTypes TT>
     auto eval()const
     {
+        TWRAPPER_PROFILE(profile,"Subtract",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
+        TWRAPPER_PROFILE_FLOPS(profile,flops());
         TensorWrapperImpl<rank,scalar_type,TT> impl;
         return impl.template subtract<typename LHS_t::indices,
                                       typename RHS_t::indices>(
@@ -1,5 +1,6 @@
 #pragma once
-#include "TensorWrapper/TMUtils/TypeComparisons.hpp"
+#include "TensorWrapper/Indices.hpp"
+#include <cmath>
 
 /** \file Implements our lazy trace machinery.
  */
@@ -17,18 +18,8 @@ struct Trace: public OperationBase<Trace<Tensor_t>> {
     ///The tensor
     Tensor_t lhs_;
 
-    template<typename T>
-    struct GetUniqueHelper;
-
-    template<typename...Args>
-    struct GetUniqueHelper<Indices<Args...>>
-    {
-        using type=typename IndicesFromTuple<
-                                typename GetUnique<Args...>::type>::type;
-    };
-
     ///Indices after trace
-    using indices=typename GetUniqueHelper<typename Tensor_t::indices>::type;
+    using indices=typename TracedIndices<typename Tensor_t::indices>::type;
 
     ///Rank of result
     constexpr static size_t rank=indices::size();
@@ -56,6 +47,24 @@ struct Trace: public OperationBase<Trace<Tensor_t>> {
         return rv;
     }
 
+    /** \brief One addition per summed element.
+     *
+     *  Each traced index appears twice, so the tensor has the size of the
+     *  result times the square of the number of elements summed into each
+     *  element of the result.
+     */
+    double flops()const
+    {
+        return std::sqrt(element_count(lhs_.dimensions())*
+                         element_count(dimensions()));
+    }
+
+    ///The summed elements are read and the result is written
+    double bytes()const
+    {
+        return sizeof(scalar_type)*(flops()+element_count(dimensions()));
+    }
+
     /** \brief Actually runs the trace.
      *
      * \returns Whatever the backend returns
@@ -65,6 +74,9 @@ struct Trace: public OperationBase<Trace<Tensor_t>> {
     template<TensorTypes TT>
     auto eval()const
     {
+        TWRAPPER_PROFILE(profile,"Trace",TT);
+        TWRAPPER_PROFILE_BYTES(profile,bytes());
+        TWRAPPER_PROFILE_FLOPS(profile,flops());
         using Impl_t=TensorWrapperImpl<Tensor_t::rank,scalar_type,TT>;
         return Impl_t().template trace<typename Tensor_t::indices>(
                     lhs_.template eval<TT>());
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** \file Contains the wrapper around the hardware performance counters.
+ *
+ *  On Linux the counters are read with perf_event_open.  Each thread opens
+ *  its own group of counters, which count only what that thread does in user
+ *  space, so the counts of a step include the threads it starts only if they
+ *  too open scopes.  Counters the CPU, kernel, or permissions
+ *  (/proc/sys/kernel/perf_event_paranoid) don't allow are dropped, and
+ *  elsewhere no counter is ever available; code using the counters should
+ *  check which ones it got.
+ */
+
+namespace TWrapper {
+
+///The hardware events that can be counted
+enum class PerfEvent{Cycles,Instructions,CacheReferences,CacheMisses,
+                     BranchMisses,StalledCyclesFrontend,StalledCyclesBackend,
+                     L1DReadMisses,LLCReadMisses};
+
+namespace detail_ {
+
+///Every PerfEvent, in order
+constexpr PerfEvent all_perf_events[]={
+    PerfEvent::Cycles,PerfEvent::Instructions,PerfEvent::CacheReferences,
+    PerfEvent::CacheMisses,PerfEvent::BranchMisses,
+    PerfEvent::StalledCyclesFrontend,PerfEvent::StalledCyclesBackend,
+    PerfEvent::L1DReadMisses,PerfEvent::LLCReadMisses};
+
+///Returns the name perf(1) uses for an event
+constexpr const char* perf_event_name(PerfEvent event)
+{
+    return event==PerfEvent::Cycles ? "cycles" :
+           event==PerfEvent::Instructions ? "instructions" :
+           event==PerfEvent::CacheReferences ? "cache-references" :
+           event==PerfEvent::CacheMisses ? "cache-misses" :
+           event==PerfEvent::BranchMisses ? "branch-misses" :
+           event==PerfEvent::StalledCyclesFrontend ?
+               "stalled-cycles-frontend" :
+           event==PerfEvent::StalledCyclesBackend ?
+               "stalled-cycles-backend" :
+           event==PerfEvent::L1DReadMisses ? "L1-dcache-load-misses" :
+           "LLC-load-misses";
+}
+
+/** \brief Returns the events named in the comma-separated list \p names.
+ *
+ *  \throws std::invalid_argument if a name is not one of perf_event_name's.
+ */
+inline std::vector<PerfEvent> parse_perf_events(const std::string& names)
+{
+    std::vector<PerfEvent> rv;
+    size_t begin=0;
+    while(begin<=names.size())
+    {
+        const size_t end=std::min(names.find(',',begin),names.size());
+        const std::string name=names.substr(begin,end-begin);
+        begin=end+1;
+        if(name.empty())continue;
+        bool found=false;
+        for(PerfEvent event : all_perf_events)
+            if(name==perf_event_name(event))
+            {
+                rv.push_back(event);
+                found=true;
+            }
+        if(!found)
+            throw std::invalid_argument("Unknown hardware event "+name);
+    }
+    return rv;
+}
+
+/** \brief A group of hardware counters counting the calling thread from
+ *  construction to destruction.
+ *
+ *  The counters are read together, so the counts are consistent with one
+ *  another.  If the kernel multiplexes the group the counts are scaled up
+ *  by the fraction of the time it was counting.
+ */
+class PerfCounters{
+public:
+    ///Opens counters for as many of \p events as possible
+    explicit PerfCounters(const std::vector<PerfEvent>& events)
+    {
+    #ifdef __linux__
+        for(PerfEvent event : events)
+        {
+            perf_event_attr attr{};
+            attr.size=sizeof(attr);
+            set_config(event,attr);
+            attr.read_format=PERF_FORMAT_GROUP|PERF_FORMAT_TOTAL_TIME_ENABLED|
+                             PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel=1;
+            attr.exclude_hv=1;
+            const int leader=fds_.empty() ? -1 : fds_.front();
+            const long fd=syscall(SYS_perf_event_open,&attr,0,-1,leader,0);
+            if(fd<0)continue;
+            fds_.push_back(static_cast<int>(fd));
+            events_.push_back(event);
+        }
+    #endif
+    }
+
+    PerfCounters(const PerfCounters&)=delete;
+    PerfCounters& operator=(const PerfCounters&)=delete;
+
+    ~PerfCounters()
+    {
+    #ifdef __linux__
+        for(size_t i=fds_.size();i-->0;)close(fds_[i]);
+    #endif
+    }
+
+    ///The events being counted, in the order read() returns them
+    const std::vector<PerfEvent>& events()const noexcept{return events_;}
+
+    ///True if any counter could be opened
+    bool available()const noexcept{return !events_.empty();}
+
+    ///Returns the count of each of events() so far (empty if none)
+    std::vector<double> read()const
+    {
+        std::vector<double> rv;
+    #ifdef __linux__
+        if(fds_.empty())return rv;
+        //nr, time enabled, time running, then one value per counter
+        std::vector<uint64_t> buffer(3+fds_.size());
+        const size_t nbytes=buffer.size()*sizeof(uint64_t);
+        if(::read(fds_.front(),buffer.data(),nbytes)!=
+           static_cast<ssize_t>(nbytes))return rv;
+        const double scale=buffer[2] ? double(buffer[1])/buffer[2] : 0.0;
+        for(size_t i=0;i<fds_.size();++i)rv.push_back(buffer[3+i]*scale);
+    #endif
+        return rv;
+    }
+
+private:
+    std::vector<int> fds_;
+    std::vector<PerfEvent> events_;
+
+#ifdef __linux__
+    static void set_config(PerfEvent event, perf_event_attr& attr)
+    {
+        attr.type=PERF_TYPE_HARDWARE;
+        switch(event)
+        {
+            case(PerfEvent::Cycles):
+                attr.config=PERF_COUNT_HW_CPU_CYCLES;break;
+            case(PerfEvent::Instructions):
+                attr.config=PERF_COUNT_HW_INSTRUCTIONS;break;
+            case(PerfEvent::CacheReferences):
+                attr.config=PERF_COUNT_HW_CACHE_REFERENCES;break;
+            case(PerfEvent::CacheMisses):
+                attr.config=PERF_COUNT_HW_CACHE_MISSES;break;
+            case(PerfEvent::BranchMisses):
+                attr.config=PERF_COUNT_HW_BRANCH_MISSES;break;
+            case(PerfEvent::StalledCyclesFrontend):
+                attr.config=PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;break;
+            case(PerfEvent::StalledCyclesBackend):
+                attr.config=PERF_COUNT_HW_STALLED_CYCLES_BACKEND;break;
+            case(PerfEvent::L1DReadMisses):
+                attr.type=PERF_TYPE_HW_CACHE;
+                attr.config=PERF_COUNT_HW_CACHE_L1D|
+                            (PERF_COUNT_HW_CACHE_OP_READ<<8)|
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+                break;
+            case(PerfEvent::LLCReadMisses):
+                attr.type=PERF_TYPE_HW_CACHE;
+                attr.config=PERF_COUNT_HW_CACHE_LL|
+                            (PERF_COUNT_HW_CACHE_OP_READ<<8)|
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+                break;
+        }
+    }
+#endif
+};
+
+///The events the profiling hooks count (see RunTime::set_perf_events)
+struct PerfSettings{
+    std::mutex mutex;
+    std::vector<PerfEvent> events;
+    ///Bumped whenever events changes, so threads reopen their counters
+    std::atomic<size_t> generation{0};
+    ///Read without the lock by ProfileScope to skip the counters cheaply
+    std::atomic<bool> enabled{false};
+};
+
+///Returns the process-wide settings
+inline PerfSettings& perf_settings()
+{
+    static PerfSettings settings;
+    return settings;
+}
+
+///Returns the calling thread's counters for the events of perf_settings()
+inline PerfCounters& thread_perf_counters()
+{
+    static thread_local std::unique_ptr<PerfCounters> counters;
+    static thread_local size_t generation=0;
+    auto& settings=perf_settings();
+    if(!counters || generation!=settings.generation)
+    {
+        std::lock_guard<std::mutex> lock(settings.mutex);
+        counters.reset(new PerfCounters(settings.events));
+        generation=settings.generation;
+    }
+    return *counters;
+}
+
+}}//End namespaces
@@ -0,0 +1,67 @@
+#pragma once
+#include "TensorWrapper/Execution.hpp"
+#include <cmath>
+#include <vector>
+
+namespace TWrapper {
+namespace detail_ {
+
+/** \brief Computes the pivoted Cholesky decomposition of a positive
+ *  semi-definite matrix.
+ *
+ *  The result is a set of vectors \f$L^P\f$ such that:
+ *  \f[
+ *      M_{ij}\approx\sum_P L^P_iL^P_j
+ *  \f]
+ *  where the error in each diagonal element is at most \p threshold (for
+ *  a positive semi-definite matrix this bounds the error of every element).
+ *  At each step the largest remaining diagonal element is chosen as the pivot,
+ *  so the number of vectors is the numerical rank of \p M and not its
+ *  dimension.  Computing a vector is parallelized over its elements with
+ *  OpenMP.
+ *
+ *  \param[in] M The matrix to decompose stored row-major (since \p M is
+ *               symmetric this is also column-major).
+ *  \param[in] n The number of rows (and columns) of \p M.
+ *  \param[in] threshold The largest allowed error in a diagonal element.
+ *
+ *  \returns The Cholesky vectors, each of which has \p n elements.
+ *
+ *  \tparam T The type of the elements of \p M.
+ */
+template<typename T>
+std::vector<std::vector<T>> pivoted_cholesky(const T* M, size_t n, T threshold)
+{
+    //The diagonal of the residual matrix
+    std::vector<T> d(n);
+    for(size_t i=0;i<n;++i)d[i]=M[i*n+i];
+
+    std::vector<std::vector<T>> L;
+    while(L.size()<n)
+    {
+        //NaNs never compare greater than so they are never a pivot
+        size_t p=n;
+        T dmax=threshold;
+        for(size_t i=0;i<n;++i)
+            if(d[i]>dmax){dmax=d[i];p=i;}
+        if(p==n)break;
+
+        const T norm=std::sqrt(dmax);
+        const T* Mp=M+p*n;
+        std::vector<T> Lp(n);
+        const long nvecs=static_cast<long>(L.size());
+        #pragma omp parallel for schedule(static) num_threads(num_threads())
+        for(long i=0;i<static_cast<long>(n);++i)
+        {
+            T value=Mp[i];
+            for(long k=0;k<nvecs;++k)value-=L[k][i]*L[k][p];
+            Lp[i]=value/norm;
+            d[i]-=Lp[i]*Lp[i];
+        }
+        d[p]=T{0};//Guard against round-off
+        L.push_back(std::move(Lp));
+    }
+    return L;
+}
+
+}}//End namespaces
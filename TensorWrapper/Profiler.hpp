@@ -0,0 +1,490 @@
+#pragma once
+#include "TensorWrapper/TensorImpl/TensorTypes.hpp"
+#include "TensorWrapper/PerfCounters.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/** \file Contains the hooks that time the steps of evaluating a statement.
+ *
+ *  The evaluation of each operation (addition, contraction, permutation,...),
+ *  the public allocate/get_memory/set_memory calls, and conversions between
+ *  backends open a ProfileScope via TWRAPPER_PROFILE.  When the scope closes
+ *  its time is added to the totals of its operation and backend, and
+ *  subtracted from the self time of the scope it is nested in.  Each thread
+ *  keeps its own totals, so scopes on different threads don't wait on each
+ *  other; RunTime::profile() merges them.
+ *
+ *  If hardware events are selected with RunTime::set_perf_events() each scope
+ *  also counts them (see PerfCounters.hpp), including in nested scopes.
+ *
+ *  While tracing (RunTime::start_trace()) each scope is also recorded as an
+ *  event with its begin and end times and the thread and rank it ran on.
+ *  RunTime::write_trace() writes the events in the Chrome trace format, for
+ *  viewing the timeline in chrome://tracing or Perfetto.
+ *
+ *  The hooks are compiled in only if TensorWrapper is configured with
+ *  ENABLE_PROFILING; otherwise the macros expand to nothing and their
+ *  arguments are never evaluated.
+ *
+ *  For backends with lazy evaluation (Eigen) evaluating an operation only
+ *  builds an expression, so the arithmetic shows up as the self time of the
+ *  "Evaluate" step of the statement's assignment.  That step is credited with
+ *  the FLOPs and bytes of the whole expression (see cost()), so its GFLOP/s
+ *  is meaningful for every backend.
+ */
+
+namespace TWrapper {
+
+///The totals of one operation on one backend
+struct ProfileEntry{
+    std::string operation;//!< What was done, e.g. "Contraction"
+    std::string backend;  //!< The backend, or "From->To" for conversions
+    size_t calls=0;       //!< How many times it was done
+    double total_time=0.0;//!< Seconds spent, including nested steps
+    double self_time=0.0; //!< Seconds spent, excluding nested steps
+    size_t bytes=0;       //!< Bytes of tensor elements read and written
+    double flops=0.0;     //!< Floating-point operations (see OperationCost)
+    ///Counts of the hardware events selected, by perf_event_name
+    std::map<std::string,double> counters;
+
+    ///The rate of floating-point operations, in GFLOP/s, over the total time
+    double gflops()const noexcept
+    {
+        return total_time>0.0 ? flops/total_time*1E-9 : 0.0;
+    }
+};
+
+namespace detail_ {
+
+///Returns the name of a backend
+constexpr const char* backend_name(TensorTypes type)
+{
+    return type==TensorTypes::EigenMatrix ? "EigenMatrix" :
+           type==TensorTypes::EigenTensor ? "EigenTensor" :
+           type==TensorTypes::EigenSparse ? "EigenSparse" :
+           type==TensorTypes::GlobalArrays ? "GlobalArrays" :
+           type==TensorTypes::TiledArray ? "TiledArray" :
+           type==TensorTypes::CTF ? "CTF" : "Distributed";
+}
+
+///The bytes of the elements of a tensor with dimensions \p dims
+template<typename T, size_t R>
+size_t tensor_bytes(const std::array<size_t,R>& dims)
+{
+    size_t rv=sizeof(T);
+    for(size_t x : dims)rv*=x;
+    return rv;
+}
+
+///The bytes of the elements in the blocks of \p mem (a MemoryBlock)
+template<typename T, typename Memory_t>
+size_t memory_bytes(const Memory_t& mem)
+{
+    size_t rv=0;
+    for(size_t i=0;i<mem.nblocks();++i)rv+=mem.shape(i).size();
+    return rv*sizeof(T);
+}
+
+///The number of PerfEvent values
+constexpr size_t nperf_events=
+    sizeof(all_perf_events)/sizeof(all_perf_events[0]);
+
+///The totals of one operation on one backend, as one thread records them
+struct ProfileTotals{
+    size_t calls=0;
+    double total_time=0.0;
+    double self_time=0.0;
+    size_t bytes=0;
+    double flops=0.0;
+    ///Counts of the hardware events, indexed by PerfEvent
+    std::array<double,nperf_events> counters{};
+    ///Which of counters were counted
+    std::array<bool,nperf_events> counted{};
+
+    ///Adds \p other to these totals
+    void merge(const ProfileTotals& other)noexcept
+    {
+        calls+=other.calls;
+        total_time+=other.total_time;
+        self_time+=other.self_time;
+        bytes+=other.bytes;
+        flops+=other.flops;
+        for(size_t i=0;i<nperf_events;++i)
+        {
+            counters[i]+=other.counters[i];
+            counted[i]=counted[i] || other.counted[i];
+        }
+    }
+};
+
+/** \brief The totals of every operation recorded by one thread.
+ *
+ *  The key is the operation, backend, and source backend (for conversions).
+ *  Only the owning thread adds to the totals, so the mutex is only contended
+ *  while they are read or reset.
+ */
+struct ThreadProfile{
+    using key_type=std::tuple<const char*,TensorTypes,TensorTypes>;
+
+    std::mutex mutex;
+    std::map<key_type,ProfileTotals> entries;
+
+    ///Registers the table with profile_data()
+    ThreadProfile();
+
+    ///Adds the totals to those of exited threads
+    ~ThreadProfile();
+
+    ThreadProfile(const ThreadProfile&)=delete;
+    ThreadProfile& operator=(const ThreadProfile&)=delete;
+};
+
+///The tables of every thread
+struct ProfileData{
+    std::mutex mutex;
+    std::vector<ThreadProfile*> threads;
+    ///The totals of the threads that have exited
+    std::map<ThreadProfile::key_type,ProfileTotals> retired;
+};
+
+///Returns the process-wide profile (see RunTime::profile)
+inline ProfileData& profile_data()
+{
+    static ProfileData data;
+    return data;
+}
+
+inline ThreadProfile::ThreadProfile()
+{
+    auto& data=profile_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.threads.push_back(this);
+}
+
+inline ThreadProfile::~ThreadProfile()
+{
+    auto& data=profile_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    for(const auto& entry : entries)
+        data.retired[entry.first].merge(entry.second);
+    auto& threads=data.threads;
+    threads.erase(std::find(threads.begin(),threads.end(),this));
+}
+
+///Returns the table of the calling thread
+inline ThreadProfile& thread_profile()
+{
+    static thread_local ThreadProfile table;
+    return table;
+}
+
+///One step recorded while tracing
+struct TraceEvent{
+    const char* operation;//!< What was done
+    TensorTypes backend;  //!< The backend that did it
+    TensorTypes from;     //!< For conversions, the backend converted from
+    size_t thread;        //!< The thread that did it (see trace_thread)
+    double begin;         //!< Microseconds since tracing started
+    double end;           //!< Microseconds since tracing started
+    size_t bytes;         //!< Bytes of tensor elements read and written
+    double flops;         //!< Floating-point operations
+};
+
+///The events recorded while tracing, shared by all threads
+struct TraceData{
+    std::mutex mutex;
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point start;
+    int rank=0;//!< This process's rank in MPI_COMM_WORLD
+    std::vector<TraceEvent> events;
+};
+
+///Returns the process-wide trace (see RunTime::start_trace)
+inline TraceData& trace_data()
+{
+    static TraceData data;
+    return data;
+}
+
+///Numbers the threads of this process in the order they first record events
+inline size_t trace_thread()
+{
+    static std::atomic<size_t> next{0};
+    static thread_local size_t id=next++;
+    return id;
+}
+
+/** \brief Times a step from its construction to its destruction.
+ *
+ *  Scopes opened while another is open on the same thread are nested in it.
+ */
+class ProfileScope{
+public:
+    using clock_t=std::chrono::steady_clock;
+
+    /** \param[in] operation What is being done.  Must outlive the scope.
+     *  \param[in] backend The backend doing it.
+     *  \param[in] from For conversions, the backend being converted from.
+     */
+    ProfileScope(const char* operation, TensorTypes backend,
+                 TensorTypes from):
+        operation_(operation),backend_(backend),from_(from),parent_(current()),
+        start_(clock_t::now())
+    {
+        current()=this;
+        auto& perf=perf_settings();
+        if(perf.enabled)
+        {
+            perf_generation_=perf.generation;
+            start_counts_=thread_perf_counters().read();
+        }
+    }
+
+    ProfileScope(const char* operation, TensorTypes backend):
+        ProfileScope(operation,backend,backend)
+    {}
+
+    ProfileScope(const ProfileScope&)=delete;
+    ProfileScope& operator=(const ProfileScope&)=delete;
+
+    ~ProfileScope()
+    {
+        const auto end=clock_t::now();
+        std::vector<double> counts;
+        //The counters are only the same ones if the events haven't changed
+        if(!start_counts_.empty() &&
+           perf_settings().generation==perf_generation_)
+            counts=thread_perf_counters().read();
+        const std::chrono::duration<double> time=end-start_;
+        current()=parent_;
+        if(parent_)parent_->nested_+=time.count();
+        auto& trace=trace_data();
+        if(trace.enabled && start_>=trace.start)
+        {
+            using us=std::chrono::duration<double,std::micro>;
+            const TraceEvent event{operation_,backend_,from_,trace_thread(),
+                                   us(start_-trace.start).count(),
+                                   us(end-trace.start).count(),bytes_,
+                                   flops_};
+            std::lock_guard<std::mutex> lock(trace.mutex);
+            trace.events.push_back(event);
+        }
+        auto& table=thread_profile();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto& entry=table.entries[std::make_tuple(operation_,backend_,from_)];
+        ++entry.calls;
+        entry.total_time+=time.count();
+        entry.self_time+=time.count()-nested_;
+        entry.bytes+=bytes_;
+        entry.flops+=flops_;
+        if(counts.size()!=start_counts_.size())return;
+        const auto& events=thread_perf_counters().events();
+        for(size_t i=0;i<counts.size();++i)
+        {
+            const size_t event=static_cast<size_t>(events[i]);
+            entry.counters[event]+=counts[i]-start_counts_[i];
+            entry.counted[event]=true;
+        }
+    }
+
+    ///Adds \p bytes to the bytes this step touched
+    void add_bytes(double bytes)noexcept{bytes_+=static_cast<size_t>(bytes);}
+
+    ///Adds \p flops to the floating-point operations this step did
+    void add_flops(double flops)noexcept{flops_+=flops;}
+
+private:
+    const char* operation_;
+    TensorTypes backend_;
+    TensorTypes from_;
+
+    ///The scope this one is nested in, if any
+    ProfileScope* parent_;
+
+    clock_t::time_point start_;
+
+    ///Time spent in the scopes nested in this one
+    double nested_=0.0;
+
+    size_t bytes_=0;
+
+    double flops_=0.0;
+
+    ///The hardware event counts when the scope opened, if counting
+    std::vector<double> start_counts_;
+
+    ///The perf_settings() generation start_counts_ was read under
+    size_t perf_generation_=0;
+
+    ///The innermost open scope of this thread
+    static ProfileScope*& current()noexcept
+    {
+        static thread_local ProfileScope* scope=nullptr;
+        return scope;
+    }
+};
+
+/** \brief Returns the totals recorded so far, sorted by operation then
+ *  backend.
+ *
+ *  The tables of all threads are merged.
+ */
+inline std::vector<ProfileEntry> profile_entries()
+{
+    //The same operation may be named by different pointers
+    using key_type=std::tuple<std::string,TensorTypes,TensorTypes>;
+    std::map<key_type,ProfileTotals> totals;
+    auto add=[&](const std::map<ThreadProfile::key_type,ProfileTotals>& table){
+        for(const auto& entry : table)
+            totals[key_type(std::get<0>(entry.first),std::get<1>(entry.first),
+                            std::get<2>(entry.first))].merge(entry.second);
+    };
+    auto& data=profile_data();
+    {
+        std::lock_guard<std::mutex> lock(data.mutex);
+        add(data.retired);
+        for(ThreadProfile* table : data.threads)
+        {
+            std::lock_guard<std::mutex> table_lock(table->mutex);
+            add(table->entries);
+        }
+    }
+    std::vector<ProfileEntry> rv;
+    for(const auto& entry : totals)
+    {
+        rv.push_back(ProfileEntry());
+        auto& out=rv.back();
+        const TensorTypes to=std::get<1>(entry.first);
+        const TensorTypes from=std::get<2>(entry.first);
+        out.operation=std::get<0>(entry.first);
+        out.backend=from==to ? backend_name(to) :
+                std::string(backend_name(from))+"->"+backend_name(to);
+        const ProfileTotals& total=entry.second;
+        out.calls=total.calls;
+        out.total_time=total.total_time;
+        out.self_time=total.self_time;
+        out.bytes=total.bytes;
+        out.flops=total.flops;
+        for(size_t i=0;i<nperf_events;++i)
+            if(total.counted[i])
+                out.counters[perf_event_name(all_perf_events[i])]=
+                    total.counters[i];
+    }
+    return rv;
+}
+
+///Forgets the totals recorded so far by every thread
+inline void reset_profile()
+{
+    auto& data=profile_data();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.retired.clear();
+    for(ThreadProfile* table : data.threads)
+    {
+        std::lock_guard<std::mutex> table_lock(table->mutex);
+        table->entries.clear();
+    }
+}
+
+///Prints \p entries as a table, most self time first
+inline void print_profile(std::ostream& os, std::vector<ProfileEntry> entries)
+{
+    std::sort(entries.begin(),entries.end(),
+              [](const ProfileEntry& lhs, const ProfileEntry& rhs){
+                  return lhs.self_time>rhs.self_time;
+    });
+    std::ostringstream table;
+    table<<std::left<<std::setw(16)<<"Operation"<<std::setw(26)<<"Backend"
+         <<std::right<<std::setw(8)<<"Calls"<<std::setw(12)<<"Total (s)"
+         <<std::setw(12)<<"Self (s)"<<std::setw(14)<<"Bytes"
+         <<std::setw(10)<<"GFLOP/s"<<std::endl;
+    table<<std::scientific<<std::setprecision(3);
+    for(const auto& entry : entries)
+        table<<std::left<<std::setw(16)<<entry.operation<<std::setw(26)
+             <<entry.backend<<std::right<<std::setw(8)<<entry.calls
+             <<std::setw(12)<<entry.total_time<<std::setw(12)
+             <<entry.self_time<<std::setw(14)<<entry.bytes<<std::setw(10)
+             <<std::fixed<<std::setprecision(2)<<entry.gflops()
+             <<std::scientific<<std::setprecision(3)<<std::endl;
+    //The hardware events counted, if any, in a second table
+    std::vector<std::string> events;
+    for(const auto& entry : entries)
+        for(const auto& count : entry.counters)
+            if(std::find(events.begin(),events.end(),count.first)==
+               events.end())events.push_back(count.first);
+    if(!events.empty())
+    {
+        table<<std::endl<<std::left<<std::setw(16)<<"Operation"
+             <<std::setw(26)<<"Backend"<<std::right;
+        for(const auto& event : events)
+            table<<std::setw(std::max<int>(12,event.size()+2))<<event;
+        table<<std::endl;
+        for(const auto& entry : entries)
+        {
+            if(entry.counters.empty())continue;
+            table<<std::left<<std::setw(16)<<entry.operation<<std::setw(26)
+                 <<entry.backend<<std::right;
+            for(const auto& event : events)
+            {
+                auto itr=entry.counters.find(event);
+                table<<std::setw(std::max<int>(12,event.size()+2))
+                     <<(itr==entry.counters.end() ? 0.0 : itr->second);
+            }
+            table<<std::endl;
+        }
+    }
+    os<<table.str();
+}
+
+/** \brief Writes \p data in the Chrome trace format.
+ *
+ *  Each event is a complete ("X") event whose process is the rank and whose
+ *  category is the backend.  The trace files of several ranks can be merged
+ *  by concatenating their traceEvents arrays.
+ */
+inline void write_trace(std::ostream& os, TraceData& data)
+{
+    std::lock_guard<std::mutex> lock(data.mutex);
+    std::ostringstream ss;
+    ss<<std::fixed<<std::setprecision(3);
+    ss<<"{\"traceEvents\":["<<std::endl;
+    ss<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"<<data.rank
+      <<",\"args\":{\"name\":\"rank "<<data.rank<<"\"}}";
+    for(const auto& event : data.events)
+    {
+        ss<<","<<std::endl<<"{\"name\":\""<<event.operation<<"\",\"cat\":\"";
+        if(event.from!=event.backend)ss<<backend_name(event.from)<<"->";
+        ss<<backend_name(event.backend)<<"\",\"ph\":\"X\",\"ts\":"
+          <<event.begin<<",\"dur\":"<<event.end-event.begin<<",\"pid\":"
+          <<data.rank<<",\"tid\":"<<event.thread<<",\"args\":{\"bytes\":"
+          <<event.bytes<<",\"flops\":"<<event.flops<<"}}";
+    }
+    ss<<std::endl<<"],\"displayTimeUnit\":\"ms\"}"<<std::endl;
+    os<<ss.str();
+}
+
+}}//End namespaces
+
+#ifdef ENABLE_PROFILING
+    ///Opens a ProfileScope named \p scope for the rest of the block
+    #define TWRAPPER_PROFILE(scope,...)\
+        TWrapper::detail_::ProfileScope scope(__VA_ARGS__)
+    ///Adds \p bytes to the bytes touched by \p scope
+    #define TWRAPPER_PROFILE_BYTES(scope,bytes) (scope).add_bytes(bytes)
+    ///Adds \p flops to the floating-point operations done by \p scope
+    #define TWRAPPER_PROFILE_FLOPS(scope,flops) (scope).add_flops(flops)
+#else
+    #define TWRAPPER_PROFILE(scope,...)
+    #define TWRAPPER_PROFILE_BYTES(scope,bytes)
+    #define TWRAPPER_PROFILE_FLOPS(scope,flops)
+#endif
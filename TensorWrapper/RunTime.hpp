@@ -1,5 +1,11 @@
 #pragma once
 #include "TensorImpls.hpp"
+#include "TensorWrapper/FirstTouch.hpp"
+#include "TensorWrapper/Execution.hpp"
+#include "TensorWrapper/Tiling.hpp"
+#include "TensorWrapper/Profiler.hpp"
+#include <cstdlib>
+#include <fstream>
 /** \file Contains the definition and implementation of the RunTime class.
  *
  */
@@ -27,39 +33,107 @@ namespace TWrapper {
  *
  *  In particular this class is concerned with the number of MPI processes.
  *  It also will call the appropriate start-up functions for each backend.
+ *  Process-wide settings, such as where new tensors are placed in memory, are
+ *  also set through this class.
+ *
+ *  The resources each rank uses are set by an ExecutionConfig: the number of
+ *  threads, how they are pinned, and the communicator tensors are spread over.
+ *  The backends (and the worlds of CTF and TiledArray) get these from the
+ *  RunTime rather than from OpenMP or MPI_COMM_WORLD.  They should be set
+ *  before any tensor is made, as the thread pools are started on first use.
+ *  Global Arrays always uses all of MPI_COMM_WORLD.
+ *
+ *  If the environment variable TWRAPPER_TRACE is set to a file name, the
+ *  RunTime traces (see start_trace()) for as long as it exists and writes the
+ *  trace to that file (suffixed with ".<rank>" when there are several ranks).
  */
 class RunTime { //private detail_::DaWorld<void> {
+    ///True if this instance initialized MPI (and thus must finalize it)
     bool initialized_=false;
+
+    ///The ranks on this rank's node, if we made it
+    MPI_Comm node_comm_=MPI_COMM_WORLD;
 public:    
     //static CTF::World& world(){return *world_;}
-    RunTime(int argc=0, char** argv=nullptr, MPI_Comm comm=MPI_COMM_WORLD)
+    RunTime(int argc=0, char** argv=nullptr, MPI_Comm comm=MPI_COMM_WORLD):
+        RunTime(argc,argv,make_config(comm))
+    {}
+
+    ///Starts the backends with the resources in \p config
+    RunTime(int argc, char** argv, const ExecutionConfig& config)
     {
-    #ifdef ENABLE_CTF
+    #if defined(ENABLE_CTF) || defined(ENABLE_DISTRIBUTED)
         int temp_init;
         MPI_Initialized(&temp_init);
-        initialized_=temp_init!=0;
-        if(!initialized_)
+        if(!temp_init)
         {
             MPI_Init(&argc,&argv);
-            comm=MPI_COMM_WORLD;
+            initialized_=true;
         }
         //world_=std::make_unique<CTF::World>(argc,argv);
     #endif
-    #ifdef ENABLE_tiledarray
-        TiledArray::initialize(argc,argv);
+        auto& state=detail_::execution();
+        state.nthreads=config.threads_per_rank ? config.threads_per_rank :
+                         static_cast<size_t>(omp_get_max_threads());
+        omp_set_num_threads(detail_::num_threads());
+        state.comm=state.node_comm=config.comm;
+        unsigned long first=0,total=state.nthreads;
+    #ifdef ENABLE_DISTRIBUTED
+        MPI_Comm_split_type(config.comm,MPI_COMM_TYPE_SHARED,0,MPI_INFO_NULL,
+                            &node_comm_);
+        state.node_comm=node_comm_;
+        if(config.node_local)state.comm=node_comm_;
+        unsigned long mine=state.nthreads;
+        int node_rank;
+        MPI_Comm_rank(node_comm_,&node_rank);
+        MPI_Exscan(&mine,&first,1,MPI_UNSIGNED_LONG,MPI_SUM,node_comm_);
+        if(!node_rank)first=0;//Exscan leaves rank 0's result undefined
+        MPI_Allreduce(&mine,&total,1,MPI_UNSIGNED_LONG,MPI_SUM,node_comm_);
+    #endif
+        detail_::pin_threads(config.affinity,first,total);
+        if(std::getenv("TWRAPPER_TRACE"))start_trace();
+    #ifdef ENABLE_CTF
+        detail_::ctf_world()=std::make_unique<CTF::World>(state.comm);
+    #endif
+    #ifdef ENABLE_TILEDARRAY
+        TiledArray::initialize(argc,argv,state.comm);
     #endif
     #ifdef ENABLE_GAXX
         GAInitialize();
     #endif
     }
 
+    ///The destructor frees node_comm_ and may finalize MPI, so don't copy
+    RunTime(const RunTime&)=delete;
+    RunTime& operator=(const RunTime&)=delete;
+
     ~RunTime()
     {
+        if(const char* file=std::getenv("TWRAPPER_TRACE"))
+        {
+            stop_trace();
+            std::string name(file);
+            int nprocs=1;
+        #if defined(ENABLE_CTF) || defined(ENABLE_DISTRIBUTED)
+            MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+        #endif
+            if(nprocs>1)name+="."+std::to_string(detail_::trace_data().rank);
+            std::ofstream os(name);
+            write_trace(os);
+        }
         //world_.swap(std::unique_ptr<CTF::World>());
-    #ifdef ENABLE_tiledarray
+    #ifdef ENABLE_CTF
+        detail_::ctf_world().reset();
+    #endif
+    #ifdef ENABLE_TILEDARRAY
         TiledArray::finalize();
     #endif
-    #ifdef ENABLE_CTF
+        auto& state=detail_::execution();
+        state.comm=state.node_comm=MPI_COMM_WORLD;
+    #ifdef ENABLE_DISTRIBUTED
+        MPI_Comm_free(&node_comm_);
+    #endif
+    #if defined(ENABLE_CTF) || defined(ENABLE_DISTRIBUTED)
         if(initialized_)
         {
             MPI_Finalize();
@@ -67,6 +141,218 @@ public:
     #endif
     }
 
+    ///Returns the number of threads each rank uses
+    static size_t num_threads()noexcept
+    {
+        return detail_::execution().nthreads;
+    }
+
+    ///Returns the communicator tensors are spread over
+    static MPI_Comm comm()noexcept
+    {
+        return detail_::execution().comm;
+    }
+
+    ///Returns the communicator of the ranks on this rank's node
+    static MPI_Comm node_comm()noexcept
+    {
+        return detail_::execution().node_comm;
+    }
+
+    /** \brief Sets how the memory of tensors allocated from now on is placed.
+     *
+     *  For policies other than AllocationPolicy::Local, tensors made with the
+     *  dimension constructor of TensorWrapper are zeroed in parallel so that
+     *  their pages land on the NUMA nodes of the threads that will use them.
+     *  Only backends that hold the tensor in a local buffer are affected.
+     */
+    static void set_allocation_policy(AllocationPolicy policy)noexcept
+    {
+        detail_::allocation_policy()=policy;
+    }
+
+    ///Returns the current allocation policy
+    static AllocationPolicy allocation_policy()noexcept
+    {
+        return detail_::allocation_policy();
+    }
+
+    /** \brief Sets the alignment of buffers TensorWrapper itself allocates:
+     *  MemoryBlock::allocate_block and the local arrays of the Distributed
+     *  backend.
+     *
+     *  Eigen, GA, TiledArray, and CTF tensors keep their libraries' storage.
+     *
+     *  \param[in] bytes The alignment.  Use 64 for cache line alignment or
+     *                   huge_page_alignment for huge-page backed buffers.
+     *  \throws std::invalid_argument if \p bytes is not a power of two.
+     */
+    static void set_alignment(size_t bytes)
+    {
+        if(!bytes || (bytes & (bytes-1)))
+            throw std::invalid_argument("Alignment must be a power of two");
+        detail_::buffer_options().alignment=bytes;
+    }
+
+    ///Returns the alignment of buffers TensorWrapper allocates
+    static size_t alignment()noexcept
+    {
+        return detail_::buffer_options().alignment;
+    }
+
+    /** \brief Sets whether the fastest-running dimension of buffers
+     *  TensorWrapper allocates is padded.
+     *
+     *  Padding avoids the cache-set aliasing that dimensions which are powers
+     *  of two cause.  Padded buffers record their strides in their Shape.
+     *  Distributed tensors made afterwards pad the rows of their local
+     *  arrays, which their local GEMMs run on.
+     */
+    static void set_padding(bool pad)noexcept
+    {
+        detail_::buffer_options().pad=pad;
+    }
+
+    ///Returns true if buffers TensorWrapper allocates are padded
+    static bool padding()noexcept
+    {
+        return detail_::buffer_options().pad;
+    }
+
+    /** \brief Sets how blocked backends (TiledArray) tile the tensors they
+     *  make from now on.
+     *
+     *  The policy is used when tensors are allocated, sliced, or evaluated
+     *  from an expression.  The default, one tile per mode, puts the whole
+     *  tensor on one rank.
+     */
+    static void set_tiling_policy(const TilingPolicy& policy)
+    {
+        detail_::tiling_policy()=policy;
+    }
+
+    ///Returns the current tiling policy
+    static const TilingPolicy& tiling_policy()noexcept
+    {
+        return detail_::tiling_policy();
+    }
+
+    ///True if TensorWrapper was configured with ENABLE_PROFILING
+    static constexpr bool profiling_enabled()noexcept
+    {
+    #ifdef ENABLE_PROFILING
+        return true;
+    #else
+        return false;
+    #endif
+    }
+
+    /** \brief Returns the time spent in each operation on each backend since
+     *  the program started (or reset_profile() was called).
+     *
+     *  Calls, total and self time, and bytes touched are summed over the
+     *  threads of this rank.  Empty unless profiling_enabled().
+     */
+    static std::vector<ProfileEntry> profile()
+    {
+        return detail_::profile_entries();
+    }
+
+    ///Prints profile() as a table, the operations with the most self time first
+    static void print_profile(std::ostream& os)
+    {
+        detail_::print_profile(os,profile());
+    }
+
+    ///Forgets the totals recorded so far
+    static void reset_profile()
+    {
+        detail_::reset_profile();
+    }
+
+    /** \brief Sets the hardware events each profiled step counts (see
+     *  ProfileEntry::counters), none to stop counting.
+     *
+     *  Counting needs Linux and the permission to use perf_event_open, and
+     *  the CPU must have the events.  Events that can't be counted are
+     *  skipped; the ones that can are returned.  Each read of the counters is
+     *  a system call, so counting slows short steps down noticeably.
+     */
+    static std::vector<PerfEvent>
+    set_perf_events(const std::vector<PerfEvent>& events)
+    {
+        auto& settings=detail_::perf_settings();
+        {
+            std::lock_guard<std::mutex> lock(settings.mutex);
+            settings.events=events;
+            ++settings.generation;
+            settings.enabled=!events.empty();
+        }
+        const auto rv=detail_::thread_perf_counters().events();
+        settings.enabled=!rv.empty();
+        return rv;
+    }
+
+    ///Returns the hardware events selected with set_perf_events
+    static std::vector<PerfEvent> perf_events()
+    {
+        auto& settings=detail_::perf_settings();
+        std::lock_guard<std::mutex> lock(settings.mutex);
+        return settings.events;
+    }
+
+    /** \brief Starts recording every profiled step (operations, evaluations,
+     *  allocations, conversions, and communication) as an event, forgetting
+     *  any events recorded before.
+     *
+     *  Events are only recorded if profiling_enabled().
+     */
+    static void start_trace()
+    {
+        auto& data=detail_::trace_data();
+        data.enabled=false;
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.events.clear();
+        data.rank=0;
+    #if defined(ENABLE_CTF) || defined(ENABLE_DISTRIBUTED)
+        int init;
+        MPI_Initialized(&init);
+        if(init)MPI_Comm_rank(MPI_COMM_WORLD,&data.rank);
+    #endif
+        data.start=std::chrono::steady_clock::now();
+        data.enabled=true;
+    }
+
+    ///Stops recording events; those recorded so far are kept
+    static void stop_trace()noexcept
+    {
+        detail_::trace_data().enabled=false;
+    }
+
+    ///True between start_trace() and stop_trace()
+    static bool tracing()noexcept
+    {
+        return detail_::trace_data().enabled;
+    }
+
+    /** \brief Writes the events recorded on this rank as Chrome trace JSON.
+     *
+     *  Each event has its begin time and duration, its backend, the thread
+     *  that ran it, and this rank.  Nested steps nest on the timeline.
+     */
+    static void write_trace(std::ostream& os)
+    {
+        detail_::write_trace(os,detail_::trace_data());
+    }
+
+private:
+    ///The configuration of the original constructor
+    static ExecutionConfig make_config(MPI_Comm comm)
+    {
+        ExecutionConfig rv;
+        rv.comm=comm;
+        return rv;
+    }
 };
 
 }//End namespace
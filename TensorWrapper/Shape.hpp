@@ -10,6 +10,12 @@ namespace TWrapper {
 
 /** \brief A class to describe the shape of a block of a tensor.
  *
+ *  In addition to the range of indices in the block, the shape records the
+ *  stride of each dimension, *i.e.* how many elements apart in memory two
+ *  indices differing by one along that dimension are.  By default the
+ *  elements are packed, but the fastest-running dimension may be padded (see
+ *  MemoryBlock::allocate_block) in which case the elements should be located
+ *  with offset().
  *
  *  \tparam rank The rank of the tensor we are describing.
  */
@@ -42,12 +48,33 @@ public:
                    const index_type &start,
                    const IndexItr<rank>& begin_itr,
                    const IndexItr<rank>& end_itr):
-        first_(start),last_(end),dims_(),row_major_(row_major),
-        begin_(begin_itr),end_(end_itr)
+        first_(start),last_(end),dims_(),strides_(),packed_(true),
+        row_major_(row_major),begin_(begin_itr),end_(end_itr)
     {
         std::transform(last_.begin(),last_.end(),
                        first_.begin(),dims_.begin(),
                        std::minus<size_t>());
+        strides_=packed_strides();
+    }
+
+    /** \brief Constructs a class that describes the layout of a tensor whose
+     *  elements are not packed.
+     *
+     *  \param[in] end The last element in the this block of the tensor
+     *  \param[in] RowMajor Is the memory of the described tensor laid out in
+     *                      row major format?
+     *  \param[in] start The first element of the tensor.
+     *  \param[in] strides The number of elements between consecutive indices
+     *                     along each dimension.
+     */
+    explicit Shape(const index_type& end,
+                   bool row_major,
+                   const index_type& start,
+                   const index_type& strides):
+        Shape(end,row_major,start)
+    {
+        strides_=strides;
+        packed_=(strides_==packed_strides());
     }
 
     ///Returns the total number of elements in this block
@@ -69,6 +96,21 @@ public:
      */
     const index_type& dims()const noexcept{return dims_;}
 
+    ///Returns the stride of each dimension
+    const index_type& strides()const noexcept{return strides_;}
+
+    ///Returns true if the elements are packed (i.e. there is no padding)
+    bool is_contiguous()const noexcept{return packed_;}
+
+    ///Returns the number of elements of memory the block spans (incl. padding)
+    size_t extent()const noexcept
+    {
+        if(!size())return 0;
+        size_t rv=1;
+        for(size_t i=0;i<rank;++i)rv+=(dims_[i]-1)*strides_[i];
+        return rv;
+    }
+
     ///Returns an interator to the first index of the block
     const_iterator begin()const{return begin_;}
 
@@ -78,8 +120,9 @@ public:
     ///Checks if two shapes of the same rank are equal
     bool operator==(const Shape& other)const noexcept
     {
-        return std::tie(row_major_,dims_,begin_,end_)==
-               std::tie(other.row_major_,other.dims_,other.begin_,other.end_);
+        return std::tie(row_major_,dims_,strides_,begin_,end_)==
+               std::tie(other.row_major_,other.dims_,other.strides_,
+                        other.begin_,other.end_);
     }
 
     ///General check, will be false b/c same ranks resolve to the above fxn
@@ -102,25 +145,32 @@ public:
     {
         size_t result=0;
         for(size_t i=0;i<rank;++i)
-        {
-            const size_t start_rank=(row_major_ ? i+1 : 0);
-            const size_t end_rank=(row_major_ ? rank : i);
-            result+=idx[i]*product_dims(start_rank,end_rank);
-        }
+            result+=idx[i]*strides_[i];
         return result;
 
     }
 
+    ///Returns the offset of an index from the first element of this block
+    template<typename T>
+    size_t offset(const T& idx)const
+    {
+        size_t result=0;
+        for(size_t i=0;i<rank;++i)
+            result+=(idx[i]-first_[i])*strides_[i];
+        return result;
+    }
+
     ///Unflattens an index see @ref md_FlatteningTensors for derivation
     index_type unflatten_index(size_t idx)const
     {
         index_type rv{};
         for(size_t i=0;i<rank;++i)
         {
-            const size_t start_rank=(row_major_ ? i+1 : 0);
-            const size_t end_rank=(row_major_ ? rank : i);
-            const size_t prod=product_dims(start_rank,end_rank);
-            rv[i]=((idx-idx%prod)/prod)%dims_[i];
+            //The stride of the next slowest dimension bounds this one
+            const bool slowest=(row_major_ ? i==0 : i+1==rank);
+            const size_t outer=(slowest ? 0 :
+                                strides_[row_major_ ? i-1 : i+1]);
+            rv[i]=(slowest ? idx : idx%outer)/strides_[i];
         }
         return rv;
     }
@@ -135,6 +185,12 @@ private:
     ///The dimensions of this block of the tensor
     index_type dims_;
 
+    ///The strides of this block of the tensor
+    index_type strides_;
+
+    ///Are the elements packed (i.e. are the strides those implied by dims_)?
+    bool packed_;
+
     ///Is the tensor laid out in RowMajor format?
     bool row_major_;
 
@@ -144,6 +200,15 @@ private:
     ///An iterator just past the end of the block
     const_iterator end_;
 
+    ///Returns the strides of the block if its elements are packed
+    index_type packed_strides()const noexcept
+    {
+        index_type rv{};
+        for(size_t i=0;i<rank;++i)
+            rv[i]=(row_major_ ? product_dims(i+1,rank) : product_dims(0,i));
+        return rv;
+    }
+
     ///Returns the product of dimensions in the range [i,j)
     size_t product_dims(size_t i, size_t j)const
     {
@@ -0,0 +1,347 @@
+#pragma once
+#include "TensorWrapper/TensorWrapper.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace TWrapper {
+namespace detail_ {
+
+/** \brief Finds the tensors a statement of a TaskGraph reads and writes.
+ *
+ *  A tensor is identified by the address of its type-erased pointer, which is
+ *  what every Convert node of an expression refers to and what assignment
+ *  replaces the contents of.
+ */
+struct Operands{
+    ///The type of the set of tensors an expression reads
+    using set_t=std::set<const void*>;
+
+    ///Returns the identity of \p t
+    template<size_t R, typename T>
+    static const void* of(const TensorWrapperBase<R,T>& t)
+    {
+        return &t.tensor_;
+    }
+
+    ///Scalars are not tensors
+    template<typename data_t>
+    static void find(const Convert<data_t>&,set_t&){}
+
+    template<size_t R, typename T>
+    static void find(const Convert<TensorPtr<R,T>>& op,set_t& rv)
+    {
+        rv.insert(&op.data_);
+    }
+
+    template<size_t R, typename T>
+    static void find(const Convert<TensorWrapperBase<R,T>>& op,set_t& rv)
+    {
+        rv.insert(&op.data_);
+    }
+
+    template<size_t R, typename T, TensorTypes TT>
+    static void find(const Convert<TensorWrapper<R,T,TT>>& op,set_t& rv)
+    {
+        rv.insert(of(op.data_));
+    }
+
+    template<typename T, typename Tensor_t, typename Index_t>
+    static void find(const IndexedTensor<T,Tensor_t,Index_t>& op,set_t& rv)
+    {
+        find(op.tensor_,rv);
+    }
+
+    template<typename NewIdx, typename OldIdx, typename Tensor_t>
+    static void find(const Permutation<NewIdx,OldIdx,Tensor_t>& op,set_t& rv)
+    {
+        find(op.t_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const AddOp<LHS_t,RHS_t>& op,set_t& rv)
+    {
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const SubtractionOp<LHS_t,RHS_t>& op,set_t& rv)
+    {
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t, typename RHS_t>
+    static void find(const Contraction<LHS_t,RHS_t>& op,set_t& rv)
+    {
+        find(op.lhs_,rv);
+        find(op.rhs_,rv);
+    }
+
+    template<typename LHS_t>
+    static void find(const ScaleOp<LHS_t>& op,set_t& rv)
+    {
+        find(op.lhs_,rv);
+    }
+
+    template<typename Tensor_t>
+    static void find(const Trace<Tensor_t>& op,set_t& rv)
+    {
+        find(op.lhs_,rv);
+    }
+};
+
+}//End namespace detail_
+
+/** \brief Evaluates a block of tensor assignments, such as one iteration of a
+ *  coupled-cluster solver, as a graph instead of one statement at a time.
+ *
+ *  Statements are recorded with add() and nothing happens until run() is
+ *  called:
+ *
+ *  \code
+ *  TaskGraph graph;
+ *  auto& X=graph.intermediate<EigenTensor<2,double>>({n,n});
+ *  graph.add(X,A(i,k)*B(k,j));
+ *  graph.add(Y,C(i,k)*D(k,j));//Does not touch X so runs alongside it
+ *  graph.add(Z,X(i,j)+Y(j,i));//Waits for both
+ *  graph.run();
+ *  \endcode
+ *
+ *  A statement waits for the last statement that wrote any tensor it reads,
+ *  and before overwriting a tensor it waits for the statements that read or
+ *  wrote it before.  Statements not ordered this way run at the same time on
+ *  the shared thread pool.  Tensors made with intermediate() are emptied as
+ *  soon as the last statement using them finishes.  Of the statements that
+ *  become ready together, those with the most FLOPs (see cost()) are started
+ *  first, so the long ones don't end up last.
+ *
+ *  If any statement's result is on a backend that is not in this process's
+ *  memory (see eval_async) the statements are evaluated one after another in
+ *  the order they were added.
+ *
+ *  \note Statements refer to their tensors, so the tensors must outlive
+ *  run().  run() waits on the thread pool and must not be called from a task
+ *  running on it.
+ */
+class TaskGraph{
+public:
+    /** \brief Adds the statement \p result = \p op to the graph.
+     *
+     *  \param[in] result The tensor to assign to.
+     *  \param[in] op The expression to evaluate.
+     *  \returns The graph, to allow chaining.
+     */
+    template<size_t R, typename T, detail_::TensorTypes TT, typename Op_t>
+    TaskGraph& add(TensorWrapper<R,T,TT>& result,
+                   const detail_::OperationBase<Op_t>& op)
+    {
+        using tensor_t=TensorWrapper<R,T,TT>;
+        const Op_t& up_op=static_cast<const Op_t&>(op);
+        detail_::Operands::set_t reads;
+        detail_::Operands::find(up_op,reads);
+        const void* write=detail_::Operands::of(result);
+        const size_t me=statements_.size();
+        serial_=serial_ || !detail_::is_shared_memory(TT);
+
+        std::set<size_t> deps;
+        for(const void* x : reads)
+            if(last_writer_.count(x))deps.insert(last_writer_[x]);
+        if(last_writer_.count(write))deps.insert(last_writer_[write]);
+        for(size_t x : readers_[write])deps.insert(x);
+
+        tensor_t* ptr=&result;
+        statements_.push_back(Statement{[ptr,up_op](){*ptr=up_op;},{},
+                                        deps.size(),cost(op).flops});
+        for(size_t x : deps)statements_[x].next.push_back(me);
+        for(const void* x : reads)
+        {
+            readers_[x].push_back(me);
+            users_[x].push_back(me);
+        }
+        last_writer_[write]=me;
+        readers_[write].clear();
+        if(!reads.count(write))users_[write].push_back(me);
+        return *this;
+    }
+
+    /** \brief Makes a tensor owned by the graph.
+     *
+     *  Expressions need the shape of their tensors when they are built, so
+     *  the intermediate is allocated now.  It is emptied once the last
+     *  statement using it has run, but the returned reference remains valid
+     *  for the life of the graph.
+     *
+     *  \param[in] dims The shape of the intermediate.
+     *  \tparam Tensor_t The TensorWrapper type of the intermediate.
+     */
+    template<typename Tensor_t>
+    Tensor_t& intermediate(const typename Tensor_t::index_t& dims)
+    {
+        auto rv=std::make_shared<Tensor_t>(dims);
+        Tensor_t* ptr=rv.get();
+        release_[detail_::Operands::of(*ptr)]=[ptr](){*ptr=Tensor_t();};
+        owned_.push_back(std::move(rv));
+        return *ptr;
+    }
+
+    ///Returns the number of statements waiting to be run
+    size_t size()const noexcept{return statements_.size();}
+
+    /** \brief Evaluates every statement added since the last call.
+     *
+     *  \throws ??? Rethrows the first exception thrown by a statement, after
+     *          the statements already running have finished.  Statements
+     *          depending on one that threw are not run, nor (when evaluating
+     *          serially) are those after it; the intermediates are still
+     *          emptied.
+     */
+    void run()
+    {
+        std::vector<Statement> statements;
+        statements.swap(statements_);
+        //An intermediate is emptied once every statement using it is done
+        std::vector<std::vector<const void*>> uses(statements.size());
+        std::map<const void*,size_t> remaining;
+        for(const auto& x : users_)
+        {
+            if(!release_.count(x.first))continue;
+            remaining[x.first]=x.second.size();
+            for(size_t i : x.second)uses[i].push_back(x.first);
+        }
+        auto finished_with=[&](size_t i){
+            for(const void* x : uses[i])
+                if(!--remaining[x])release_[x]();
+        };
+        last_writer_.clear();
+        readers_.clear();
+        users_.clear();
+
+        if(serial_)
+        {
+            serial_=false;
+            for(size_t i=0;i<statements.size();++i)
+            {
+                try{
+                    statements[i].fxn();
+                }
+                catch(...){
+                    //This and the skipped statements are done with them too
+                    for(size_t j=i;j<statements.size();++j)finished_with(j);
+                    throw;
+                }
+                finished_with(i);
+            }
+            return;
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<size_t> done;
+        std::exception_ptr error;
+        auto submit=[&](size_t i){
+            detail_::thread_pool().submit([&,i](){
+                try{
+                    statements[i].fxn();
+                }
+                catch(...){
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(!error)error=std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back(i);
+                cv.notify_one();
+            });
+        };
+
+        //Starts the statements in ready, the costliest first
+        size_t running=0;
+        std::vector<bool> started(statements.size(),false);
+        auto submit_all=[&](std::vector<size_t>& ready){
+            std::stable_sort(ready.begin(),ready.end(),[&](size_t a,size_t b){
+                return statements[a].flops>statements[b].flops;
+            });
+            for(size_t i : ready)
+            {
+                started[i]=true;
+                submit(i);
+            }
+            running+=ready.size();
+            ready.clear();
+        };
+
+        std::vector<size_t> ready;
+        for(size_t i=0;i<statements.size();++i)
+            if(!statements[i].ndeps)ready.push_back(i);
+        submit_all(ready);
+        while(running)
+        {
+            std::vector<size_t> finished;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock,[&](){return !done.empty();});
+                finished.swap(done);
+            }
+            running-=finished.size();
+            for(size_t i : finished)
+            {
+                finished_with(i);
+                if(error)continue;
+                for(size_t j : statements[i].next)
+                    if(!--statements[j].ndeps)ready.push_back(j);
+            }
+            submit_all(ready);
+        }
+        if(!error)return;
+        //The statements that will not run are done with their intermediates
+        for(size_t i=0;i<statements.size();++i)
+            if(!started[i])finished_with(i);
+        std::rethrow_exception(error);
+    }
+
+private:
+    ///A recorded assignment
+    struct Statement{
+        ///Evaluates the assignment
+        std::function<void()> fxn;
+
+        ///The statements waiting on this one
+        std::vector<size_t> next;
+
+        ///The number of statements this one is still waiting on
+        size_t ndeps;
+
+        ///The estimated floating-point operations of the statement
+        double flops;
+    };
+
+    ///The statements added since the last call to run
+    std::vector<Statement> statements_;
+
+    ///The last statement to write each tensor
+    std::map<const void*,size_t> last_writer_;
+
+    ///The statements reading each tensor since it was last written
+    std::map<const void*,std::vector<size_t>> readers_;
+
+    ///The statements reading or writing each tensor
+    std::map<const void*,std::vector<size_t>> users_;
+
+    ///How to empty each intermediate
+    std::map<const void*,std::function<void()>> release_;
+
+    ///The intermediates
+    std::vector<std::shared_ptr<void>> owned_;
+
+    ///True if a statement's backend can not be evaluated on the thread pool
+    bool serial_=false;
+};
+
+}//End namespace TWrapper
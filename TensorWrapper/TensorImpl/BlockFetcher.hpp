@@ -0,0 +1,104 @@
+#pragma once
+#include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
+#include <array>
+#include <vector>
+
+namespace TWrapper {
+namespace detail_ {
+
+///Returns a packed, row-major Shape of the indices \p shape covers
+template<size_t R>
+Shape<R> packed_box(const Shape<R>& shape)
+{
+    const auto start=*shape.begin();
+    std::array<size_t,R> end;
+    for(size_t i=0;i<R;++i)end[i]=start[i]+shape.dims()[i];
+    return Shape<R>(end,true,start);
+}
+
+/** \brief Returns the boxes of a grid of tiles, in row-major order.
+ *
+ *  \param[in] bounds The tile boundaries of each mode, starting with 0 and
+ *             ending with the extent of the mode.
+ */
+template<size_t R>
+std::vector<Shape<R>>
+tile_boxes(const std::array<std::vector<size_t>,R>& bounds)
+{
+    std::vector<Shape<R>> rv;
+    for(const auto& mode : bounds)
+        if(mode.size()<2)return rv;
+    std::array<size_t,R> tile{},start,end;
+    while(true)
+    {
+        for(size_t i=0;i<R;++i)
+        {
+            start[i]=bounds[i][tile[i]];
+            end[i]=bounds[i][tile[i]+1];
+        }
+        rv.emplace_back(end,true,start);
+        size_t i=R;
+        while(i-->0)//Next tile
+        {
+            if(++tile[i]+1<bounds[i].size())break;
+            tile[i]=0;
+        }
+        if(i==static_cast<size_t>(-1))break;
+    }
+    return rv;
+}
+
+/** \brief Lists the blocks of a tensor and fetches them for BlockStream.
+ *
+ *  The blocks are boxes of indices that together cover the tensor once.
+ *  start(i,buffer) begins copying block i into \p buffer, laid out as
+ *  blocks()[i] says (packed and row-major), and wait(i,buffer) returns once
+ *  the elements are there.  The caller may work on other blocks in between.
+ *  Backends specialize this class; for distributed backends making a fetcher
+ *  may be collective.
+ *
+ *  The primary template is for backends that hold the whole tensor in each
+ *  process: the blocks are those of get_memory and start copies them.
+ */
+template<size_t R, typename T, TensorTypes TT>
+class BlockFetcher{
+public:
+    using impl_type=TensorWrapperImpl<R,T,TT>;
+    using tensor_type=typename impl_type::type;
+
+    BlockFetcher(const impl_type& impl, tensor_type& t):
+        mem_(impl.get_memory(t))
+    {
+        for(size_t i=0;i<mem_.nblocks();++i)
+            if(mem_.shape(i).size())
+            {
+                blocks_.push_back(packed_box(mem_.shape(i)));
+                index_.push_back(i);
+            }
+    }
+
+    ///Returns the blocks, in the order they are streamed
+    const std::vector<Shape<R>>& blocks()const noexcept{return blocks_;}
+
+    void start(size_t i, T* buffer)
+    {
+        const Shape<R>& from=mem_.shape(index_[i]);
+        const T* data=mem_.block(index_[i]);
+        for(const auto& idx : blocks_[i])
+            buffer[blocks_[i].offset(idx)]=data[from.offset(idx)];
+    }
+
+    void wait(size_t, T*){}
+
+private:
+    ///The tensor's blocks, which point into the tensor
+    MemoryBlock<R,T> mem_;
+
+    ///The blocks as they are handed out
+    std::vector<Shape<R>> blocks_;
+
+    ///The block of mem_ each entry of blocks_ is
+    std::vector<size_t> index_;
+};
+
+}}//End namespaces
@@ -1,13 +1,27 @@
 #pragma once
 #include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
+#include "TensorWrapper/TensorImpl/BlockFetcher.hpp"
+#include "TensorWrapper/Tiling.hpp"
 #ifdef __GNUC__
 #pragma GCC system_header
 #endif
 #include<ctf/ctf.hpp>
+#include <memory>
 
 namespace TWrapper {
 namespace detail_ {
 
+/** \brief The world CTF tensors are made in.
+ *
+ *  RunTime makes it from its communicator.  If there is no RunTime it is made
+ *  from MPI_COMM_WORLD the first time a tensor is allocated.
+ */
+inline std::unique_ptr<CTF::World>& ctf_world()
+{
+    static std::unique_ptr<CTF::World> world;
+    return world;
+}
+
 ///Struct for getting at the base of a CTF tensor
 template<size_t R, typename Index_t, typename Tensor_t>
 struct CTFDerefer
@@ -102,23 +116,70 @@ struct TensorWrapperImpl<rank,T,TensorTypes::CTF> {
 
     template<typename Tensor_t>
     void set_memory(Tensor_t& impl,const MemoryBlock<rank,T>& block)const
+    {
+        write_memory(impl,block,T{0});
+    }
+
+    /** \brief Sets each element in \p block to its value plus \p beta times
+     *  the tensor's.  Collective.
+     *
+     *  With \p beta 0 this sets the elements and with 1 it adds to them.  CTF
+     *  routes each element to its owner, where repeated elements are summed.
+     *  Ranks may hold different numbers of blocks, so all of this rank's
+     *  elements go in one write, as read_memory does for reads.
+     */
+    template<typename Tensor_t>
+    void write_memory(Tensor_t& impl,const MemoryBlock<rank,T>& block,
+                      T beta)const
     {
         Shape<rank> shape=dims(impl);
+        std::vector<int64_t> idxs;
+        std::vector<T> values;
         for(size_t i=0;i<block.nblocks();++i)
         {
-            std::vector<int64_t> idxs;
+            const T* buffer=block.block(i);
+            size_t n=0;
             for(auto idx=block.begin(i);idx!=block.end(i);++idx)
+            {
+                values.push_back(buffer[block.offset(i,n++,*idx)]);
                 idxs.push_back(shape.flat_index(*idx));
-            impl.write(idxs.size(),idxs.data(),block.block(i));
+            }
         }
+        impl.write(idxs.size(),T{1},beta,idxs.data(),values.data());
+    }
 
+    /** \brief Fills the blocks of \p block with the corresponding elements of
+     *  \p impl, wherever they live.  Collective.
+     *
+     *  CTF sends each rank the elements it asks for with one all-to-all.
+     */
+    template<typename Tensor_t>
+    void read_memory(Tensor_t& impl,MemoryBlock<rank,T>& block)const
+    {
+        Shape<rank> shape=dims(impl);
+        std::vector<int64_t> idxs;
+        for(size_t i=0;i<block.nblocks();++i)
+            for(auto idx=block.begin(i);idx!=block.end(i);++idx)
+                idxs.push_back(shape.flat_index(*idx));
+        std::vector<T> values(idxs.size());
+        impl.read(idxs.size(),idxs.data(),values.data());
+        size_t counter=0;
+        for(size_t i=0;i<block.nblocks();++i)
+        {
+            size_t n=0;
+            for(auto idx=block.begin(i);idx!=block.end(i);++idx)
+                block.block(i)[block.offset(i,n++,*idx)]=values[counter++];
+        }
     }
 
     type allocate(const array_t& dims)const{
         std::array<int,rank> idims{};
+        std::array<int,rank> sym{};//All NS
         for(size_t i=0;i<rank;++i)
             idims[i]=dims[i];
-        return type(rank,idims.data());
+        if(!ctf_world())ctf_world()=std::make_unique<CTF::World>(
+                    execution().comm);
+        return type(rank,idims.data(),sym.data(),*ctf_world());
     }
 
 //    template<typename Tensor_t>
@@ -234,4 +295,60 @@ struct TensorWrapperImpl<rank,T,TensorTypes::CTF> {
 //        return std::make_pair(evals,evecs);
 //    }
 };
+
+/** \brief Fetches blocks of a CTF tensor: the tiles the RunTime's
+ *  TilingPolicy gives it.
+ *
+ *  CTF's reads are collective and blocking, so a block is read as soon as its
+ *  fetch is started and every process must stream the tensor in step.
+ */
+template<size_t rank, typename T>
+class BlockFetcher<rank,T,TensorTypes::CTF>{
+public:
+    using impl_type=TensorWrapperImpl<rank,T,TensorTypes::CTF>;
+    using tensor_type=typename impl_type::type;
+
+    BlockFetcher(const impl_type& impl, tensor_type& t):
+        impl_(impl),t_(&t)
+    {
+        int nprocs;
+        MPI_Comm_size(execution().comm,&nprocs);
+        const auto dims=impl.dims(t).dims();
+        std::array<std::vector<size_t>,rank> bounds;
+        for(size_t i=0;i<rank;++i)
+            bounds[i]=tiling_policy().tile_boundaries(i,dims[i],rank,nprocs);
+        blocks_=tile_boxes(bounds);
+    }
+
+    ///Returns the tiles, in row-major order
+    const std::vector<Shape<rank>>& blocks()const noexcept{return blocks_;}
+
+    void start(size_t i, T* buffer)
+    {
+        MemoryBlock<rank,T> block;
+        block.add_block(buffer,blocks_[i]);
+        impl_.read_memory(*t_,block);
+    }
+
+    void wait(size_t, T*){}
+
+private:
+    impl_type impl_;
+    tensor_type* t_;
+    std::vector<Shape<rank>> blocks_;
+};
+
+/** \brief Adds the elements in \p mem to those of a CTF tensor.
+ *
+ *  Overloads the generic accumulate_memory with CTF's write, which scales the
+ *  old elements by 1.  Collective, so threads of a rank must not call it at
+ *  once.
+ */
+template<size_t rank, typename T, typename Tensor_t>
+void accumulate_memory(const TensorWrapperImpl<rank,T,TensorTypes::CTF>& impl,
+                       Tensor_t& t, const MemoryBlock<rank,T>& mem)
+{
+    impl.write_memory(t,mem,T{1});
+}
+
 }}
@@ -0,0 +1,1093 @@
+#pragma once
+#include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
+#include "TensorWrapper/TensorImpl/BlockFetcher.hpp"
+#include "TensorWrapper/AlignedBuffer.hpp"
+#include "TensorWrapper/Profiler.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+/** \file Contains TensorWrapper's own distributed tensor backend.
+ *
+ *  The backend only needs MPI.  Tensors are distributed block-cyclically over
+ *  a process grid with one dimension per mode of the tensor, remote elements
+ *  are read and written with one-sided (RMA) calls, and contractions are
+ *  mapped to matrix products that are done with the SUMMA algorithm.  The
+ *  communication steps are profiled (see Profiler.hpp) as "RMA get",
+ *  "RMA put", "Broadcast", and "Allreduce".
+ */
+
+namespace TWrapper {
+namespace detail_ {
+
+///Maps a scalar type to its MPI datatype
+template<typename T>
+struct MPIType;
+
+template<>
+struct MPIType<float>{
+    static MPI_Datatype type(){return MPI_FLOAT;}
+};
+
+template<>
+struct MPIType<double>{
+    static MPI_Datatype type(){return MPI_DOUBLE;}
+};
+
+/** \brief Exposes the local elements of a distributed tensor to one-sided
+ *  calls for the lifetime of the instance.
+ *
+ *  Making and destroying an instance are collective over the communicator.
+ *  All ranks share one passive target epoch, so calls may target any rank.
+ *  On a single rank every element is local, so no window is made (some MPI
+ *  implementations can not make one there).
+ */
+template<typename T>
+class RMAWindow{
+public:
+    RMAWindow(T* data, size_t n, MPI_Comm comm):
+        comm_(comm)
+    {
+        int nprocs;
+        MPI_Comm_size(comm_,&nprocs);
+        if(nprocs==1)return;
+        MPI_Win_create(data,static_cast<MPI_Aint>(n*sizeof(T)),sizeof(T),
+                       MPI_INFO_NULL,comm_,&win_);
+        MPI_Win_lock_all(0,win_);
+    }
+
+    RMAWindow(const RMAWindow&)=delete;
+    RMAWindow& operator=(const RMAWindow&)=delete;
+
+    ~RMAWindow()
+    {
+        if(win_==MPI_WIN_NULL)return;
+        MPI_Win_unlock_all(win_);
+        MPI_Win_free(&win_);
+    }
+
+    ///Reads \p n elements starting at \p disp on \p rank into \p out
+    void get(T* out, size_t n, int rank, size_t disp)
+    {
+        MPI_Get(out,static_cast<int>(n),MPIType<T>::type(),rank,
+                static_cast<MPI_Aint>(disp),static_cast<int>(n),
+                MPIType<T>::type(),win_);
+    }
+
+    ///Starts reading \p n elements at \p disp on \p rank; wait on the request
+    MPI_Request rget(T* out, size_t n, int rank, size_t disp)
+    {
+        MPI_Request rv;
+        MPI_Rget(out,static_cast<int>(n),MPIType<T>::type(),rank,
+                 static_cast<MPI_Aint>(disp),static_cast<int>(n),
+                 MPIType<T>::type(),win_,&rv);
+        return rv;
+    }
+
+    /** \brief Writes \p n elements to \p rank starting at \p disp.
+     *
+     *  Done as an atomic replacement so that ranks writing the same element
+     *  (*e.g.* when each holds a copy of the whole tensor) are not in error.
+     *  With \p op MPI_SUM the elements are added instead.
+     */
+    void put(const T* in, size_t n, int rank, size_t disp,
+             MPI_Op op=MPI_REPLACE)
+    {
+        MPI_Accumulate(in,static_cast<int>(n),MPIType<T>::type(),rank,
+                       static_cast<MPI_Aint>(disp),static_cast<int>(n),
+                       MPIType<T>::type(),op,win_);
+    }
+
+    ///Waits for every rank's puts to land and be visible locally
+    void complete()
+    {
+        if(win_==MPI_WIN_NULL)return;
+        MPI_Win_flush_all(win_);
+        MPI_Barrier(comm_);
+        MPI_Win_sync(win_);
+    }
+
+private:
+    MPI_Comm comm_;
+    MPI_Win win_=MPI_WIN_NULL;
+};
+
+/** \brief A tensor whose elements are distributed block-cyclically over the
+ *  ranks of an MPI communicator.
+ *
+ *  The ranks form a process grid with one dimension per mode of the tensor
+ *  (ranks are assigned to grid coordinates in row-major order).  Along mode
+ *  \f$d\f$ the indices are cut into blocks of block()[d] indices and block
+ *  \f$k\f$ belongs to grid coordinate \f$k \bmod g_d\f$, where \f$g_d\f$ is
+ *  grid()[d].  Each rank stores the elements it owns in one row-major array
+ *  whose dimensions are local_dims().  The array is aligned, and its rows
+ *  padded, according to the RunTime's buffer options when the tensor is made
+ *  (see RunTime::set_alignment and RunTime::set_padding); local_strides()
+ *  gives its layout.
+ *
+ *  Member functions documented as collective must be called by every rank of
+ *  comm().
+ *
+ *  \tparam R The rank of the tensor
+ *  \tparam T The type of the elements
+ */
+template<size_t R, typename T>
+class DistributedTensor{
+public:
+    using index_t=std::array<size_t,R>;
+
+    ///Makes a tensor with no elements that belongs to no communicator
+    DistributedTensor()=default;
+
+    /** \brief Makes a zeroed tensor distributed over the ranks of \p comm.
+     *
+     *  The process grid is chosen by MPI_Dims_create and the blocks are at
+     *  most 64 indices long, but short enough that each rank has at least
+     *  two of them along every mode large enough to allow it.
+     */
+    explicit DistributedTensor(const index_t& dims,
+                               MPI_Comm comm=execution().comm):
+        dims_(dims),comm_(comm),pad_(buffer_options().pad)
+    {
+        int nprocs;
+        MPI_Comm_size(comm_,&nprocs);
+        std::array<int,R> grid{};
+        MPI_Dims_create(nprocs,static_cast<int>(R),grid.data());
+        for(size_t i=0;i<R;++i)
+        {
+            grid_[i]=static_cast<size_t>(grid[i]);
+            block_[i]=default_block(dims_[i],grid_[i]);
+        }
+        setup();
+    }
+
+    /** \brief Makes a zeroed tensor with a given distribution.
+     *
+     *  \param[in] pad Should the rows of the local arrays be padded?
+     *  \throws std::invalid_argument if the grid does not have one point per
+     *          rank of \p comm or if a block is empty.
+     */
+    DistributedTensor(const index_t& dims, const index_t& grid,
+                      const index_t& block, MPI_Comm comm=execution().comm,
+                      bool pad=buffer_options().pad):
+        dims_(dims),grid_(grid),block_(block),comm_(comm),pad_(pad)
+    {
+        int nprocs;
+        MPI_Comm_size(comm_,&nprocs);
+        size_t npoints=1;
+        for(size_t i=0;i<R;++i)
+        {
+            if(!block_[i])
+                throw std::invalid_argument("Blocks must not be empty");
+            npoints*=grid_[i];
+        }
+        if(npoints!=static_cast<size_t>(nprocs))
+            throw std::invalid_argument("Grid size does not match #ranks");
+        setup();
+    }
+
+    ///Returns the number of indices along each mode
+    const index_t& dims()const noexcept{return dims_;}
+
+    ///Returns the number of ranks along each mode of the process grid
+    const index_t& grid()const noexcept{return grid_;}
+
+    ///Returns the number of indices in a block along each mode
+    const index_t& block()const noexcept{return block_;}
+
+    ///Returns this rank's coordinates in the process grid
+    const index_t& coords()const noexcept{return coords_;}
+
+    ///Returns the dimensions of this rank's local array
+    const index_t& local_dims()const noexcept{return local_dims_;}
+
+    ///Returns the communicator the tensor is distributed over
+    MPI_Comm comm()const noexcept{return comm_;}
+
+    ///Returns the strides of this rank's local array
+    const index_t& local_strides()const noexcept{return local_strides_;}
+
+    ///True if the rows of the local arrays are padded
+    bool padded()const noexcept{return pad_;}
+
+    ///Returns the number of elements held by this rank
+    size_t local_size()const noexcept{return nlocal_;}
+
+    /** \brief Returns the length of this rank's local array, including any
+     *  padding.
+     *
+     *  Padding elements are zero and stay zero under the element-wise
+     *  operations, which therefore loop over the whole array.
+     */
+    size_t local_extent()const noexcept{return local_.size();}
+
+    ///Returns this rank's local array, laid out by local_strides()
+    T* data()noexcept{return local_.data();}
+
+    ///\copydoc data()
+    const T* data()const noexcept{return local_.data();}
+
+    ///Returns the rank that owns the element at \p idx
+    int owner(const index_t& idx)const noexcept
+    {
+        size_t rv=0;
+        for(size_t i=0;i<R;++i)
+            rv=rv*grid_[i]+(idx[i]/block_[i])%grid_[i];
+        return static_cast<int>(rv);
+    }
+
+    ///Returns where the element at \p idx is in its owner's local array
+    size_t local_offset(const index_t& idx)const noexcept
+    {
+        size_t rv=0;
+        for(size_t i=0;i<R;++i)
+        {
+            const size_t blocki=idx[i]/block_[i];
+            const size_t local=blocki/grid_[i]*block_[i]+idx[i]%block_[i];
+            const size_t coord=blocki%grid_[i];
+            rv=rv*(i==R-1 ? row_length(coord) : counts_[i][coord])+local;
+        }
+        return rv;
+    }
+
+    ///True if \p other has the same elements on the same ranks
+    bool same_layout(const DistributedTensor& other)const noexcept
+    {
+        return dims_==other.dims_ && grid_==other.grid_ &&
+               block_==other.block_ && comm_==other.comm_ &&
+               pad_==other.pad_;
+    }
+
+    /** \brief Calls \p fxn with the index and a reference to each of this
+     *  rank's elements, in the order they are stored locally.
+     */
+    template<typename Fxn_t>
+    void for_each_local(Fxn_t&& fxn)
+    {
+        if(local_.empty())return;
+        index_t local{},idx{};
+        for(size_t i=0;i<R;++i)idx[i]=coords_[i]*block_[i];
+        for(size_t n=0;n<nlocal_;++n)
+        {
+            size_t offset=0;
+            for(size_t i=0;i<R;++i)offset+=local[i]*local_strides_[i];
+            fxn(const_cast<const index_t&>(idx),local_[offset]);
+            for(size_t i=R;i-->0;)//Next index in row-major order
+            {
+                if(++local[i]<local_dims_[i])
+                {
+                    idx[i]=global_index(i,local[i]);
+                    break;
+                }
+                local[i]=0;
+                idx[i]=coords_[i]*block_[i];
+            }
+        }
+    }
+
+    ///\copydoc for_each_local()
+    template<typename Fxn_t>
+    void for_each_local(Fxn_t&& fxn)const
+    {
+        const_cast<DistributedTensor&>(*this).for_each_local(
+            [&](const index_t& idx,T& value){
+                fxn(idx,const_cast<const T&>(value));
+            });
+    }
+
+    /** \brief Returns this rank's elements as one block per tile.
+     *
+     *  A tile is the set of elements in one block along each mode.  Along
+     *  modes the grid does not split the tile is the whole mode.  The blocks
+     *  point into the local array so writes to them are writes to the tensor.
+     */
+    MemoryBlock<R,T> get_memory()
+    {
+        MemoryBlock<R,T> rv;
+        if(local_.empty())return rv;
+        index_t width{},start{};
+        for(size_t i=0;i<R;++i)
+        {
+            width[i]=grid_[i]==1 ? dims_[i] : block_[i];
+            start[i]=coords_[i]*block_[i];
+        }
+        while(true)
+        {
+            index_t end{};
+            for(size_t i=0;i<R;++i)
+                end[i]=std::min(start[i]+width[i],dims_[i]);
+            rv.add_block(local_.data()+local_offset(start),
+                         Shape<R>(end,true,start,local_strides_));
+            size_t i=R;
+            while(i-->0)//Next tile
+            {
+                start[i]+=grid_[i]*width[i];
+                if(start[i]<dims_[i])break;
+                start[i]=coords_[i]*block_[i];
+            }
+            if(i==static_cast<size_t>(-1))break;
+        }
+        return rv;
+    }
+
+    /** \brief Sets the elements in \p mem, wherever they live.  Collective.
+     *
+     *  Blocks that point into this rank's local array (*i.e.* came from
+     *  get_memory()) are already in place.  See write_memory.
+     */
+    void set_memory(const MemoryBlock<R,T>& mem)
+    {
+        write_memory(mem,false);
+    }
+
+    /** \brief Adds the elements in \p mem to the tensor's, wherever they
+     *  live.  Collective.
+     *
+     *  Like set_memory, but remote elements are added with MPI_SUM, which is
+     *  atomic, so ranks may add to the same elements.
+     */
+    void accumulate_memory(const MemoryBlock<R,T>& mem)
+    {
+        write_memory(mem,true);
+    }
+
+    /** \brief Sets each local element of this tensor to an element of
+     *  \p src.  Collective.
+     *
+     *  \param[in] src The tensor to read from.  Must be distributed over the
+     *                 same communicator as this tensor.
+     *  \param[in] fxn Maps the index of an element of this tensor to the
+     *                 index of the element of \p src it is set to.
+     */
+    template<size_t R2, typename Fxn_t>
+    void fetch(const DistributedTensor<R2,T>& src, Fxn_t&& fxn)
+    {
+        std::vector<std::array<size_t,R2>> from;
+        from.reserve(nlocal_);
+        for_each_local([&](const index_t& idx,T&){from.push_back(fxn(idx));});
+        if(nlocal_==local_.size())
+        {
+            fetch_elements(src,from,local_.data());
+            return;
+        }
+        //The elements are fetched in order, so padded arrays are unpacked
+        std::vector<T> packed(nlocal_);
+        fetch_elements(src,from,packed.data());
+        size_t n=0;
+        for_each_local([&](const index_t&,T& value){value=packed[n++];});
+    }
+
+    ///Returns every element, in row-major order, on every rank.  Collective.
+    std::vector<T> gather()const
+    {
+        const Shape<R> shape(dims_);
+        std::vector<index_t> from(shape.size());
+        for(size_t i=0;i<from.size();++i)from[i]=shape.unflatten_index(i);
+        std::vector<T> rv(from.size());
+        fetch_elements(*this,from,rv.data());
+        return rv;
+    }
+
+private:
+    ///The number of indices along each mode
+    index_t dims_{};
+
+    ///The number of ranks along each mode of the process grid
+    index_t grid_{};
+
+    ///The number of indices in a block along each mode
+    index_t block_{};
+
+    ///This rank's coordinates in the grid
+    index_t coords_{};
+
+    ///The dimensions of the local array
+    index_t local_dims_{};
+
+    ///The strides of the local array
+    index_t local_strides_{};
+
+    ///The number of elements this rank owns
+    size_t nlocal_=0;
+
+    ///counts_[i][c] is how many indices along mode i coordinate c holds
+    std::array<std::vector<size_t>,R> counts_;
+
+    ///The communicator the tensor is distributed over
+    MPI_Comm comm_=MPI_COMM_NULL;
+
+    ///Are the rows of the local array padded?
+    bool pad_=false;
+
+    ///The elements this rank owns (and the padding)
+    std::vector<T,AlignedAllocator<T>> local_;
+
+    static size_t default_block(size_t n, size_t g)noexcept
+    {
+        return std::max<size_t>(1,std::min<size_t>(64,(n+2*g-1)/(2*g)));
+    }
+
+    /** \brief Returns the length of the rows of the local arrays of the
+     *  ranks at coordinate \p coord along the last mode, including padding.
+     *
+     *  Vectors, and ranks that own nothing, are not padded.
+     */
+    size_t row_length(size_t coord)const noexcept
+    {
+        const size_t n=counts_[R-1][coord];
+        return pad_ && R>1 && n ? padded_length<T>(n) : n;
+    }
+
+    ///Returns the index along \p mode of the \p local-th local index
+    size_t global_index(size_t mode, size_t local)const noexcept
+    {
+        const size_t b=block_[mode];
+        return (local/b*grid_[mode]+coords_[mode])*b+local%b;
+    }
+
+    ///Works out the coordinates and local array of this rank
+    void setup()
+    {
+        int me;
+        MPI_Comm_rank(comm_,&me);
+        size_t rank=static_cast<size_t>(me);
+        for(size_t i=R;i-->0;)
+        {
+            coords_[i]=rank%grid_[i];
+            rank/=grid_[i];
+        }
+        for(size_t i=0;i<R;++i)
+        {
+            counts_[i].assign(grid_[i],0);
+            for(size_t k=0;k*block_[i]<dims_[i];++k)
+                counts_[i][k%grid_[i]]+=
+                        std::min(block_[i],dims_[i]-k*block_[i]);
+            local_dims_[i]=counts_[i][coords_[i]];
+        }
+        nlocal_=1;
+        for(size_t i=0;i<R;++i)nlocal_*=local_dims_[i];
+        size_t stride=1;
+        for(size_t i=R;i-->0;)
+        {
+            local_strides_[i]=stride;
+            stride*=(i==R-1 ? row_length(coords_[R-1]) : local_dims_[i]);
+        }
+        local_.assign(nlocal_ ? stride : 0,T{0});
+    }
+
+    /** \brief Sets (or, if \p add, adds to) the elements in \p mem.
+     *  Collective.
+     *
+     *  Elements this rank owns are copied directly and the rest are written
+     *  with one-sided calls; runs of elements that are consecutive on both
+     *  sides are written with one call.  When setting, blocks that point into
+     *  this rank's local array (*i.e.* came from get_memory()) are already in
+     *  place.
+     */
+    void write_memory(const MemoryBlock<R,T>& mem, bool add)
+    {
+        TWRAPPER_PROFILE(profile,"RMA put",TensorTypes::Distributed);
+        TWRAPPER_PROFILE_BYTES(profile,memory_bytes<T>(mem));
+        int me;
+        MPI_Comm_rank(comm_,&me);
+        const T* begin=local_.data();
+        const T* end=begin+local_.size();
+        auto is_remote=[&](size_t i){
+            const T* block=mem.block(i);
+            std::less<const T*> less;
+            return add || less(block,begin) || !less(block,end);
+        };
+        const MPI_Op op=add ? MPI_SUM : MPI_REPLACE;
+        //Local writes are done before the window exists
+        for(size_t i=0;i<mem.nblocks();++i)
+        {
+            if(!is_remote(i))continue;
+            size_t counter=0;
+            for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+            {
+                const size_t from=mem.offset(i,counter++,*idx);
+                if(owner(*idx)!=me)continue;
+                T& x=local_[local_offset(*idx)];
+                if(add)
+                    x+=mem.block(i)[from];
+                else
+                    x=mem.block(i)[from];
+            }
+        }
+        RMAWindow<T> win(local_.data(),local_.size(),comm_);
+        int rank=0;
+        const T* run=nullptr;
+        size_t disp=0,length=0;
+        auto flush=[&](){
+            if(length)win.put(run,length,rank,disp,op);
+            length=0;
+        };
+        for(size_t i=0;i<mem.nblocks();++i)
+        {
+            if(!is_remote(i))continue;
+            size_t counter=0;
+            for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+            {
+                const T* from=mem.block(i)+mem.offset(i,counter++,*idx);
+                const int to=owner(*idx);
+                if(to==me)continue;
+                const size_t offset=local_offset(*idx);
+                if(length && to==rank && offset==disp+length &&
+                   from==run+length)
+                {
+                    ++length;
+                    continue;
+                }
+                flush();
+                rank=to;
+                run=from;
+                disp=offset;
+                length=1;
+            }
+        }
+        flush();
+        win.complete();
+    }
+
+    /** \brief Reads the elements of \p src at the indices in \p from into
+     *  \p out.  Collective.
+     *
+     *  Elements owned by this rank are copied directly.  The rest are read
+     *  with one-sided calls, one per run of elements that are consecutive
+     *  both in \p out and in their owner's local array.
+     */
+    template<size_t R2>
+    static void fetch_elements(const DistributedTensor<R2,T>& src,
+                               const std::vector<std::array<size_t,R2>>& from,
+                               T* out)
+    {
+        TWRAPPER_PROFILE(profile,"RMA get",TensorTypes::Distributed);
+        TWRAPPER_PROFILE_BYTES(profile,from.size()*sizeof(T));
+        int me;
+        MPI_Comm_rank(src.comm(),&me);
+        RMAWindow<T> win(const_cast<T*>(src.data()),src.local_extent(),
+                         src.comm());
+        int rank=0;
+        size_t disp=0,start=0,length=0;
+        auto flush=[&](){
+            if(length)win.get(out+start,length,rank,disp);
+            length=0;
+        };
+        for(size_t i=0;i<from.size();++i)
+        {
+            const int owner=src.owner(from[i]);
+            const size_t offset=src.local_offset(from[i]);
+            if(owner==me)
+            {
+                out[i]=src.data()[offset];
+                continue;
+            }
+            if(length && owner==rank && offset==disp+length &&
+               i==start+length)
+            {
+                ++length;
+                continue;
+            }
+            flush();
+            rank=owner;
+            disp=offset;
+            start=i;
+            length=1;
+        }
+        flush();
+    }
+
+    template<size_t R2, typename T2>
+    friend class DistributedTensor;
+};
+
+///Returns a zeroed tensor distributed the same way as \p t
+template<size_t R, typename T>
+DistributedTensor<R,T> like(const DistributedTensor<R,T>& t)
+{
+    return DistributedTensor<R,T>(t.dims(),t.grid(),t.block(),t.comm(),
+                                  t.padded());
+}
+
+/** \brief Multiplies two matrices with the SUMMA algorithm.  Collective.
+ *
+ *  \p A and \p B must be distributed over the same two-dimensional grid with
+ *  square blocks of the same size.  For each block of columns of \p A (rows
+ *  of \p B) the owning ranks broadcast their panel along their grid row
+ *  (column) and every rank adds the product of the panels it received to its
+ *  part of the result.
+ *
+ *  \returns \f$AB\f$, distributed like \p A and \p B.
+ */
+template<typename T>
+DistributedTensor<2,T> summa(const DistributedTensor<2,T>& A,
+                             const DistributedTensor<2,T>& B)
+{
+    using matrix_t=Eigen::Matrix<T,Eigen::Dynamic,Eigen::Dynamic,
+                                 Eigen::RowMajor>;
+    const auto& grid=A.grid();
+    const auto& coords=A.coords();
+    const size_t b=A.block()[1];
+    const size_t K=A.dims()[1];
+    DistributedTensor<2,T> C({A.dims()[0],B.dims()[1]},grid,A.block(),
+                             A.comm());
+    const size_t mloc=C.local_dims()[0],nloc=C.local_dims()[1];
+    const size_t astride=A.local_strides()[0],bstride=B.local_strides()[0];
+    MPI_Comm row_comm,col_comm;
+    MPI_Comm_split(A.comm(),static_cast<int>(coords[0]),
+                   static_cast<int>(coords[1]),&row_comm);
+    MPI_Comm_split(A.comm(),static_cast<int>(coords[1]),
+                   static_cast<int>(coords[0]),&col_comm);
+    std::vector<T> apanel(mloc*b),bpanel(b*nloc);
+    Eigen::Map<matrix_t,Eigen::Unaligned,Eigen::OuterStride<>> c(
+        C.data(),mloc,nloc,Eigen::OuterStride<>(C.local_strides()[0]));
+    for(size_t k=0,kb=0;k<K;k+=b,++kb)
+    {
+        const size_t w=std::min(b,K-k);
+        const size_t acol=kb%grid[1],brow=kb%grid[0];
+        if(coords[1]==acol)
+        {
+            const size_t first=kb/grid[1]*b;
+            for(size_t i=0;i<mloc;++i)
+                std::copy(A.data()+i*astride+first,
+                          A.data()+i*astride+first+w,apanel.data()+i*w);
+        }
+        if(coords[0]==brow)
+        {
+            const T* first=B.data()+kb/grid[0]*b*bstride;
+            for(size_t i=0;i<w;++i)
+                std::copy(first+i*bstride,first+i*bstride+nloc,
+                          bpanel.data()+i*nloc);
+        }
+        {
+            TWRAPPER_PROFILE(profile,"Broadcast",TensorTypes::Distributed);
+            TWRAPPER_PROFILE_BYTES(profile,(mloc+nloc)*w*sizeof(T));
+            MPI_Bcast(apanel.data(),static_cast<int>(mloc*w),
+                      MPIType<T>::type(),static_cast<int>(acol),row_comm);
+            MPI_Bcast(bpanel.data(),static_cast<int>(w*nloc),
+                      MPIType<T>::type(),static_cast<int>(brow),col_comm);
+        }
+        if(mloc && nloc)
+            c.noalias()+=Eigen::Map<const matrix_t>(apanel.data(),mloc,w)*
+                         Eigen::Map<const matrix_t>(bpanel.data(),w,nloc);
+    }
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    return C;
+}
+
+/** \brief Contracts two distributed tensors.
+ *
+ *  The free indices of the left tensor are flattened into the rows, and the
+ *  dummy indices into the columns, of a matrix; likewise the dummy and free
+ *  indices of the right tensor.  The matrices are made (with one-sided reads)
+ *  on a two-dimensional grid, multiplied with summa(), and the product is
+ *  read back into a tensor whose indices are the left's free indices followed
+ *  by the right's.
+ *
+ *  \tparam nfree The number of free indices.
+ */
+template<size_t nfree>
+struct DistributedContraction{
+    template<typename LHS_Idx, typename RHS_Idx,
+             size_t LR, size_t RR, typename T>
+    static DistributedTensor<nfree,T> eval(const DistributedTensor<LR,T>& lhs,
+                                           const DistributedTensor<RR,T>& rhs)
+    {
+        constexpr size_t lnfree=LHS_Idx::nunique(RHS_Idx());
+        const auto free=get_free(LHS_Idx(),RHS_Idx());
+        const auto dummy=get_dummy(LHS_Idx(),RHS_Idx());
+        const auto& ldims=lhs.dims();
+        const auto& rdims=rhs.dims();
+        std::array<size_t,nfree> dims{};
+        size_t M=1,N=1,K=1,counter=0;
+        for(size_t i : free.first)M*=(dims[counter++]=ldims[i]);
+        for(size_t i : free.second)N*=(dims[counter++]=rdims[i]);
+        for(size_t i : dummy.first)K*=ldims[i];
+
+        int nprocs;
+        MPI_Comm_size(lhs.comm(),&nprocs);
+        std::array<int,2> igrid{};
+        MPI_Dims_create(nprocs,2,igrid.data());
+        const std::array<size_t,2> grid{static_cast<size_t>(igrid[0]),
+                                        static_cast<size_t>(igrid[1])};
+        const size_t g=std::max(grid[0],grid[1]);
+        const size_t b=std::max<size_t>(1,
+                           std::min<size_t>(64,(std::max(M,N)+2*g-1)/(2*g)));
+        const std::array<size_t,2> block{b,b};
+
+        //Unflattens x into the modes listed in modes
+        auto unflatten=[](size_t x, const auto& modes, const auto& extents,
+                          auto& idx){
+            for(size_t i=modes.size();i-->0;)
+            {
+                idx[modes[i]]=x%extents[modes[i]];
+                x/=extents[modes[i]];
+            }
+        };
+
+        DistributedTensor<2,T> A({M,K},grid,block,lhs.comm());
+        A.fetch(lhs,[&](const std::array<size_t,2>& mk){
+            std::array<size_t,LR> idx{};
+            unflatten(mk[0],free.first,ldims,idx);
+            unflatten(mk[1],dummy.first,ldims,idx);
+            return idx;
+        });
+        DistributedTensor<2,T> B({K,N},grid,block,lhs.comm());
+        B.fetch(rhs,[&](const std::array<size_t,2>& kn){
+            std::array<size_t,RR> idx{};
+            unflatten(kn[0],dummy.second,rdims,idx);
+            unflatten(kn[1],free.second,rdims,idx);
+            return idx;
+        });
+        const DistributedTensor<2,T> C=summa(A,B);
+
+        DistributedTensor<nfree,T> rv(dims,lhs.comm());
+        rv.fetch(C,[&](const std::array<size_t,nfree>& idx){
+            std::array<size_t,2> mn{};
+            for(size_t i=0;i<lnfree;++i)mn[0]=mn[0]*dims[i]+idx[i];
+            for(size_t i=lnfree;i<nfree;++i)mn[1]=mn[1]*dims[i]+idx[i];
+            return mn;
+        });
+        return rv;
+    }
+};
+
+///Full contractions are local dot products once the layouts match
+template<>
+struct DistributedContraction<0>{
+    template<typename LHS_Idx, typename RHS_Idx,
+             size_t LR, size_t RR, typename T>
+    static T eval(const DistributedTensor<LR,T>& lhs,
+                  const DistributedTensor<RR,T>& rhs)
+    {
+        const auto map=LHS_Idx::get_map(RHS_Idx());
+        auto r=like(lhs);
+        r.fetch(rhs,[&](const std::array<size_t,LR>& idx){
+            std::array<size_t,RR> rv{};
+            for(size_t i=0;i<LR;++i)rv[map[i]]=idx[i];
+            return rv;
+        });
+        T local{0},rv{0};
+        for(size_t i=0;i<lhs.local_extent();++i)
+            local+=lhs.data()[i]*r.data()[i];
+        TWRAPPER_PROFILE(profile,"Allreduce",TensorTypes::Distributed);
+        MPI_Allreduce(&local,&rv,1,MPIType<T>::type(),MPI_SUM,lhs.comm());
+        return rv;
+    }
+};
+
+/** \brief The wrapper around TensorWrapper's own distributed backend.
+ *
+ *  Operations are evaluated eagerly.  Every operation, as well as
+ *  set_memory, is collective over the tensor's communicator.
+ */
+template<size_t R, typename T>
+struct TensorWrapperImpl<R,T,TensorTypes::Distributed> {
+    using array_t=std::array<size_t,R>;
+    using type=DistributedTensor<R,T>;
+
+    Shape<R> dims(const type& impl)const
+    {
+        return Shape<R>(impl.dims(),true);
+    }
+
+    ///Returns one block per tile this rank holds (see type::get_memory)
+    MemoryBlock<R,T> get_memory(type& impl)const
+    {
+        return impl.get_memory();
+    }
+
+    void set_memory(type& impl,const MemoryBlock<R,T>& block)const
+    {
+        impl.set_memory(block);
+    }
+
+    type allocate(const array_t& dims)const
+    {
+        return type(dims);
+    }
+
+    type permute(const type& t, const array_t& map)const
+    {
+        array_t new_dims{};
+        for(size_t i=0;i<R;++i)new_dims[map[i]]=t.dims()[i];
+        type rv(new_dims,t.comm());
+        rv.fetch(t,[&](const array_t& idx){
+            array_t old_idx{};
+            for(size_t i=0;i<R;++i)old_idx[i]=idx[map[i]];
+            return old_idx;
+        });
+        return rv;
+    }
+
+    type slice(const type& t, const array_t& start, const array_t& end)const
+    {
+        array_t new_dims{};
+        for(size_t i=0;i<R;++i)new_dims[i]=end[i]-start[i];
+        type rv(new_dims,t.comm());
+        rv.fetch(t,[&](const array_t& idx){
+            array_t old_idx{};
+            for(size_t i=0;i<R;++i)old_idx[i]=idx[i]+start[i];
+            return old_idx;
+        });
+        return rv;
+    }
+
+    ///True on every rank if the tensors have the same shape and elements
+    bool are_equal(const type& lhs, const type& rhs)const
+    {
+        if(lhs.dims()!=rhs.dims())return false;
+        type temp;
+        const type* r=&rhs;
+        if(!lhs.same_layout(rhs))r=&(temp=aligned(lhs,rhs));
+        int local=std::equal(lhs.data(),lhs.data()+lhs.local_extent(),
+                             r->data());
+        int rv=0;
+        TWRAPPER_PROFILE(profile,"Allreduce",TensorTypes::Distributed);
+        MPI_Allreduce(&local,&rv,1,MPI_INT,MPI_LAND,lhs.comm());
+        return rv!=0;
+    }
+
+    template<typename,typename Tensor_t>
+    type scale(const Tensor_t& lhs,double val)const
+    {
+        type rv(lhs);
+        for(size_t i=0;i<rv.local_extent();++i)rv.data()[i]*=val;
+        return rv;
+    }
+
+    ///Adds to the tensor
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t>
+    type add(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        return combine<LHS_Idx,RHS_Idx>(lhs,rhs,T{1});
+    }
+
+    ///Subtracts from the tensor
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t>
+    type subtract(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        return combine<LHS_Idx,RHS_Idx>(lhs,rhs,T{-1});
+    }
+
+    template<typename,typename Op_t>
+    type eval(const Op_t& op,const array_t&)const
+    {
+        return op;
+    }
+
+    template<typename LHS_Idx,typename RHS_Idx,typename LHS_t,typename RHS_t>
+    auto contraction(const LHS_t& lhs, const RHS_t& rhs)const
+    {
+        constexpr size_t nfree=LHS_Idx::size()+RHS_Idx::size()-
+                               2*LHS_Idx::ncommon(RHS_Idx());
+        return DistributedContraction<nfree>::template
+                eval<LHS_Idx,RHS_Idx>(lhs,rhs);
+    }
+
+    template<typename LHS_Idx,typename LHS_t>
+    T trace(const LHS_t& lhs)const
+    {
+        static_assert(LHS_Idx().size()==2,"Trace only available for matrix");
+        T local{0},rv{0};
+        lhs.for_each_local([&](const array_t& idx,const T& value){
+            if(idx[0]==idx[1])local+=value;
+        });
+        TWRAPPER_PROFILE(profile,"Allreduce",TensorTypes::Distributed);
+        MPI_Allreduce(&local,&rv,1,MPIType<T>::type(),MPI_SUM,lhs.comm());
+        return rv;
+    }
+
+    ///Every rank gathers the matrix and solves the eigen system redundantly
+    template<typename My_t>
+    auto self_adjoint_eigen_solver(const My_t& tensor)const
+    {
+        static_assert(R==2,"Eigen solving only available for matrices");
+        using matrix_t=Eigen::Matrix<T,Eigen::Dynamic,Eigen::Dynamic,
+                                     Eigen::RowMajor>;
+        const size_t n=tensor.dims()[0];
+        const std::vector<T> elements=tensor.gather();
+        Eigen::SelfAdjointEigenSolver<matrix_t> solver(
+                    Eigen::Map<const matrix_t>(elements.data(),n,n));
+        DistributedTensor<1,T> evals(std::array<size_t,1>{n},tensor.comm());
+        type evecs(array_t{n,n},tensor.comm());
+        evals.for_each_local([&](const std::array<size_t,1>& idx,T& value){
+            value=solver.eigenvalues()(idx[0]);
+        });
+        evecs.for_each_local([&](const array_t& idx,T& value){
+            value=solver.eigenvectors()(idx[0],idx[1]);
+        });
+        return std::make_pair(evals,evecs);
+    }
+
+private:
+    ///Returns \p rhs distributed like \p lhs, its modes in \p lhs's order
+    type aligned(const type& lhs, const type& rhs,
+                 const array_t& map=identity())const
+    {
+        type rv=like(lhs);
+        rv.fetch(rhs,[&](const array_t& idx){
+            array_t rhs_idx{};
+            for(size_t i=0;i<R;++i)rhs_idx[i]=idx[map[i]];
+            return rhs_idx;
+        });
+        return rv;
+    }
+
+    static array_t identity()noexcept
+    {
+        array_t rv{};
+        for(size_t i=0;i<R;++i)rv[i]=i;
+        return rv;
+    }
+
+    ///Returns lhs+factor*rhs after aligning the two tensors
+    template<typename LHS_Idx,typename RHS_Idx>
+    type combine(const type& lhs,const type& rhs, T factor)const
+    {
+        const auto map=RHS_Idx::get_map(LHS_Idx());
+        type temp;
+        const type* r=&rhs;
+        if(!std::is_same<LHS_Idx,RHS_Idx>::value || !lhs.same_layout(rhs))
+            r=&(temp=aligned(lhs,rhs,map));
+        type rv(lhs);
+        for(size_t i=0;i<rv.local_extent();++i)
+            rv.data()[i]+=factor*r->data()[i];
+        return rv;
+    }
+};
+
+/** \brief Fetches the tiles of a distributed tensor (see
+ *  DistributedTensor::get_memory) with non-blocking one-sided gets.
+ *
+ *  A tile belongs to one rank; it is read with one MPI_Rget per run of
+ *  elements that are consecutive in the owner's local array.  Making and
+ *  destroying a fetcher is collective.
+ */
+template<size_t R, typename T>
+class BlockFetcher<R,T,TensorTypes::Distributed>{
+public:
+    using impl_type=TensorWrapperImpl<R,T,TensorTypes::Distributed>;
+    using tensor_type=typename impl_type::type;
+
+    BlockFetcher(const impl_type&, tensor_type& t):
+        t_(&t),
+        win_(std::make_unique<RMAWindow<T>>(t.data(),t.local_extent(),
+                                            t.comm()))
+    {
+        MPI_Comm_rank(t.comm(),&me_);
+        std::array<std::vector<size_t>,R> bounds;
+        for(size_t i=0;i<R;++i)
+        {
+            const size_t width=t.grid()[i]==1 ? t.dims()[i] : t.block()[i];
+            for(size_t j=0;j<t.dims()[i];j+=width)bounds[i].push_back(j);
+            bounds[i].push_back(t.dims()[i]);
+        }
+        blocks_=tile_boxes(bounds);
+    }
+
+    ///Returns the tiles, in row-major order
+    const std::vector<Shape<R>>& blocks()const noexcept{return blocks_;}
+
+    void start(size_t i, T* buffer)
+    {
+        std::vector<MPI_Request>& requests=pending_[i];
+        const Shape<R>& shape=blocks_[i];
+        int rank=0;
+        size_t disp=0,first=0,length=0;
+        auto flush=[&](){
+            if(length)requests.push_back(win_->rget(buffer+first,length,
+                                                    rank,disp));
+            length=0;
+        };
+        for(const auto& idx : shape)
+        {
+            const size_t out=shape.offset(idx);
+            const int owner=t_->owner(idx);
+            const size_t offset=t_->local_offset(idx);
+            if(owner==me_)
+            {
+                buffer[out]=t_->data()[offset];
+                continue;
+            }
+            if(length && owner==rank && offset==disp+length &&
+               out==first+length)
+            {
+                ++length;
+                continue;
+            }
+            flush();
+            rank=owner;
+            disp=offset;
+            first=out;
+            length=1;
+        }
+        flush();
+    }
+
+    void wait(size_t i, T*)
+    {
+        auto requests=pending_.find(i);
+        if(requests==pending_.end())return;
+        MPI_Waitall(static_cast<int>(requests->second.size()),
+                    requests->second.data(),MPI_STATUSES_IGNORE);
+        pending_.erase(requests);
+    }
+
+private:
+    const tensor_type* t_;
+    int me_;
+    std::unique_ptr<RMAWindow<T>> win_;
+    std::vector<Shape<R>> blocks_;
+
+    ///The gets of each tile that has been started but not waited on
+    std::unordered_map<size_t,std::vector<MPI_Request>> pending_;
+};
+
+/** \brief Gathers every element of a distributed tensor onto every rank.
+ *
+ *  Overloads the generic gather_memory.  Collective.
+ */
+template<size_t R, typename T, typename Tensor_t>
+MemoryBlock<R,T> gather_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::Distributed>&, Tensor_t& t)
+{
+    const Shape<R> shape(t.dims());
+    const std::vector<T> elements=t.gather();
+    std::unique_ptr<T[]> buffer(new T[elements.size()]);
+    std::copy(elements.begin(),elements.end(),buffer.get());
+    MemoryBlock<R,T> rv;
+    rv.add_block(std::move(buffer),shape);
+    return rv;
+}
+
+/** \brief Adds the elements in \p mem to those of a distributed tensor.
+ *
+ *  Overloads the generic accumulate_memory.  Collective, like set_memory, so
+ *  threads of a rank must not call it at once; remote elements are added with
+ *  MPI_SUM so ranks may add to the same elements.
+ */
+template<size_t R, typename T, typename Tensor_t>
+void accumulate_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::Distributed>&,
+        Tensor_t& t, const MemoryBlock<R,T>& mem)
+{
+    t.accumulate_memory(mem);
+}
+
+///The communicator a distributed tensor spans (see Redistribute.hpp)
+template<size_t R, typename T, typename Tensor_t>
+MPI_Comm tensor_comm(const TensorWrapperImpl<R,T,TensorTypes::Distributed>&,
+                     const Tensor_t& t)
+{
+    return t.comm();
+}
+
+}}//End namespaces
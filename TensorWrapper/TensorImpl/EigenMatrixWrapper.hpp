@@ -239,7 +239,8 @@ struct SetMemoryImpl{
 
             while(index!=last)
             {
-                impl((*index)[Is]...)=blocki[counter++];
+                impl((*index)[Is]...)=
+                        blocki[block.offset(i,counter++,*index)];
                 ++index;
             }
         }
@@ -394,4 +395,14 @@ struct TensorWrapperImpl<R,T,TensorTypes::EigenMatrix> {
 
 };
 
+///get_memory points into the matrix, so adds go straight in, atomically
+template<size_t R, typename T, typename Tensor_t>
+void accumulate_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::EigenMatrix>& impl,
+        Tensor_t& t, const MemoryBlock<R,T>& mem)
+{
+    auto local=impl.get_memory(t);
+    add_blocks(local,mem,true);
+}
+
 }}//End namespaces
@@ -0,0 +1,886 @@
+#pragma once
+#include "TensorWrapper/TensorImpl/EigenMatrixWrapper.hpp"
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/** \file This file wraps Eigen's sparse vector/matrix classes.
+ *
+ *  Vectors map onto Eigen::SparseVector and matrices onto a row-major (CSR)
+ *  Eigen::SparseMatrix.  Eigen has no sparse tensor class so tensors of rank
+ *  three or higher are stored as the mode-0 unfolding of the tensor in a CSR
+ *  matrix (see EigenSparseTensor).  Regardless of the rank, the nonzero
+ *  elements are addressed by their row-major flat index.
+ */
+
+namespace TWrapper {
+namespace detail_ {
+
+/** \brief Storage for element-sparse tensors of rank three or higher.
+ *
+ *  The tensor is held as a CSR matrix whose rows run over the first index of
+ *  the tensor and whose columns run over the remaining indices flattened in
+ *  row-major order.  For a three-index density fitting tensor,
+ *  \f$B^P_{mn}\f$, this means each auxiliary index is one row.
+ *
+ *  \tparam R The rank of the tensor
+ *  \tparam T The type of the elements in the tensor
+ */
+template<size_t R, typename T>
+struct EigenSparseTensor{
+    ///The type of the unfolded tensor
+    using matrix_type=Eigen::SparseMatrix<T,Eigen::RowMajor,std::ptrdiff_t>;
+
+    ///The length of each dimension
+    std::array<size_t,R> dims{};
+
+    ///The mode-0 unfolding of the tensor
+    matrix_type matrix;
+
+    ///Makes an empty rank R tensor with all dimensions of length zero
+    EigenSparseTensor()=default;
+
+    ///Makes a tensor with the given dimensions and no nonzero elements
+    explicit EigenSparseTensor(const std::array<size_t,R>& dims_in):
+        dims(dims_in),
+        matrix(dims_in[0],std::accumulate(dims_in.begin()+1,dims_in.end(),
+                                          size_t{1},std::multiplies<size_t>()))
+    {}
+
+    ///Returns a copy of this tensor with each element scaled by \p val
+    EigenSparseTensor operator*(T val)const
+    {
+        EigenSparseTensor rv(*this);
+        rv.matrix*=val;
+        return rv;
+    }
+
+    ///Returns the element-wise sum of this tensor and \p other
+    EigenSparseTensor operator+(const EigenSparseTensor& other)const
+    {
+        EigenSparseTensor rv(dims);
+        rv.matrix=matrix+other.matrix;
+        return rv;
+    }
+
+    ///Returns the element-wise difference of this tensor and \p other
+    EigenSparseTensor operator-(const EigenSparseTensor& other)const
+    {
+        EigenSparseTensor rv(dims);
+        rv.matrix=matrix-other.matrix;
+        return rv;
+    }
+};
+
+///Primary template for selecting the sparse backend type
+template<size_t R, typename T>
+struct ToEigenSparseType
+{
+    using type=EigenSparseTensor<R,T>;
+};
+
+///Specialization selecting a CSR matrix
+template<typename T>
+struct ToEigenSparseType<2,T>
+{
+    using type=Eigen::SparseMatrix<T,Eigen::RowMajor>;
+};
+
+///Specialization selecting a sparse column vector
+template<typename T>
+struct ToEigenSparseType<1,T>
+{
+    using type=Eigen::SparseVector<T>;
+};
+
+///Specialization selecting a scalar
+template<typename T>
+struct ToEigenSparseType<0,T>
+{
+    using type=T;
+};
+
+/** \brief Uniform access to the operands of the sparse kernels.
+ *
+ *  Each specialization provides the rank of the operand, its dimensions, and
+ *  a function that visits its nonzero elements.  The visitor is called with
+ *  the row-major flat index and the value of each element.  Specializations
+ *  for the types used as storage by the sparse backend additionally expose
+ *  the raw CSR arrays and a way to refill the tensor from a list of elements
+ *  sorted by flat index.
+ *
+ *  The primary template handles scalars.
+ */
+template<typename Tensor_t>
+struct SparseOperand
+{
+    constexpr static size_t rank=0;
+    using entries_t=std::vector<std::pair<size_t,Tensor_t>>;
+
+    static std::array<size_t,0> dims(const Tensor_t&){return {};}
+
+    template<typename Fxn_t>
+    static void for_each(const Tensor_t& t,Fxn_t&& fxn)
+    {
+        if(t!=Tensor_t{0})fxn(size_t{0},t);
+    }
+
+    static Tensor_t make(const std::array<size_t,0>&){return Tensor_t{0};}
+
+    static void set_entries(Tensor_t& t,const entries_t& entries)
+    {
+        t=(entries.empty() ? Tensor_t{0} : entries[0].second);
+    }
+};
+
+///Specialization to sparse vectors
+template<typename T, int Opt, typename Index_t>
+struct SparseOperand<Eigen::SparseVector<T,Opt,Index_t>>
+{
+    using tensor_type=Eigen::SparseVector<T,Opt,Index_t>;
+    using entries_t=std::vector<std::pair<size_t,T>>;
+    constexpr static size_t rank=1;
+
+    static std::array<size_t,1> dims(const tensor_type& t)
+    {
+        return {(size_t)t.size()};
+    }
+
+    template<typename Fxn_t>
+    static void for_each(const tensor_type& t,Fxn_t&& fxn)
+    {
+        for(typename tensor_type::InnerIterator it(t);it;++it)
+            fxn((size_t)it.index(),it.value());
+    }
+
+    static tensor_type make(const std::array<size_t,1>& dims)
+    {
+        return tensor_type(dims[0]);
+    }
+
+    static void set_entries(tensor_type& t,const entries_t& entries)
+    {
+        t.setZero();
+        t.reserve(entries.size());
+        for(const auto& x : entries)
+            t.insertBack(x.first)=x.second;
+    }
+
+    static tensor_type& unfolded(tensor_type& t){return t;}
+
+    ///Sparse vectors are always stored compressed
+    static void compress(tensor_type&){}
+
+    ///Vectors have a single row so there is no outer index array
+    static const Index_t* outer(const tensor_type&){return nullptr;}
+};
+
+///Specialization to sparse matrices
+template<typename T, int Opt, typename Index_t>
+struct SparseOperand<Eigen::SparseMatrix<T,Opt,Index_t>>
+{
+    using tensor_type=Eigen::SparseMatrix<T,Opt,Index_t>;
+    using entries_t=std::vector<std::pair<size_t,T>>;
+    constexpr static size_t rank=2;
+
+    static std::array<size_t,2> dims(const tensor_type& t)
+    {
+        return {(size_t)t.rows(),(size_t)t.cols()};
+    }
+
+    template<typename Fxn_t>
+    static void for_each(const tensor_type& t,Fxn_t&& fxn)
+    {
+        const size_t ncols=t.cols();
+        for(Eigen::Index k=0;k<t.outerSize();++k)
+            for(typename tensor_type::InnerIterator it(t,k);it;++it)
+                fxn(it.row()*ncols+it.col(),it.value());
+    }
+
+    static tensor_type make(const std::array<size_t,2>& dims)
+    {
+        return tensor_type(dims[0],dims[1]);
+    }
+
+    static void set_entries(tensor_type& t,const entries_t& entries)
+    {
+        const size_t ncols=t.cols();
+        std::vector<Eigen::Triplet<T,Index_t>> triplets;
+        triplets.reserve(entries.size());
+        for(const auto& x : entries)
+            triplets.emplace_back(x.first/ncols,x.first%ncols,x.second);
+        t.setFromTriplets(triplets.begin(),triplets.end());
+    }
+
+    static tensor_type& unfolded(tensor_type& t){return t;}
+
+    static void compress(tensor_type& t){t.makeCompressed();}
+
+    static const Index_t* outer(const tensor_type& t)
+    {
+        return t.outerIndexPtr();
+    }
+};
+
+///Specialization to the unfolded higher rank tensors
+template<size_t R, typename T>
+struct SparseOperand<EigenSparseTensor<R,T>>
+{
+    using tensor_type=EigenSparseTensor<R,T>;
+    using matrix_type=typename tensor_type::matrix_type;
+    using entries_t=std::vector<std::pair<size_t,T>>;
+    constexpr static size_t rank=R;
+
+    static std::array<size_t,R> dims(const tensor_type& t){return t.dims;}
+
+    template<typename Fxn_t>
+    static void for_each(const tensor_type& t,Fxn_t&& fxn)
+    {
+        SparseOperand<matrix_type>::for_each(t.matrix,std::forward<Fxn_t>(fxn));
+    }
+
+    static tensor_type make(const std::array<size_t,R>& dims)
+    {
+        return tensor_type(dims);
+    }
+
+    static void set_entries(tensor_type& t,const entries_t& entries)
+    {
+        SparseOperand<matrix_type>::set_entries(t.matrix,entries);
+    }
+
+    static matrix_type& unfolded(tensor_type& t){return t.matrix;}
+
+    static void compress(tensor_type& t){t.matrix.makeCompressed();}
+
+    static const std::ptrdiff_t* outer(const tensor_type& t)
+    {
+        return t.matrix.outerIndexPtr();
+    }
+};
+
+///Specialization to dense Eigen vectors/matrices, for mixed contractions
+template<typename T, int Rows, int Cols, int Opt, int MRows, int MCols>
+struct SparseOperand<Eigen::Matrix<T,Rows,Cols,Opt,MRows,MCols>>
+{
+    using tensor_type=Eigen::Matrix<T,Rows,Cols,Opt,MRows,MCols>;
+    constexpr static size_t rank=(Cols==1 ? 1 : 2);
+
+    static std::array<size_t,rank> dims(const tensor_type& t)
+    {
+        return DimMaker<rank>::eval(t).dims();
+    }
+
+    template<typename Fxn_t>
+    static void for_each(const tensor_type& t,Fxn_t&& fxn)
+    {
+        const size_t ncols=t.cols();
+        for(Eigen::Index i=0;i<t.rows();++i)
+            for(Eigen::Index j=0;j<t.cols();++j)
+                if(t(i,j)!=T{0})fxn(i*ncols+j,t(i,j));
+    }
+};
+
+/** \brief Returns an evaluated version of an operand.
+ *
+ *  Eigen's kernels return expression templates.  The general sparse kernels
+ *  work on actual tensors so these functions evaluate an expression into its
+ *  plain type, while tensors are passed through untouched.
+ */
+template<typename T,
+         typename=typename std::enable_if<std::is_arithmetic<T>::value>::type>
+T plain(T value){return value;}
+
+template<size_t R, typename T>
+const EigenSparseTensor<R,T>& plain(const EigenSparseTensor<R,T>& t){return t;}
+
+template<typename T, int Opt, typename Index_t>
+const Eigen::SparseVector<T,Opt,Index_t>&
+plain(const Eigen::SparseVector<T,Opt,Index_t>& t){return t;}
+
+template<typename T, int Opt, typename Index_t>
+const Eigen::SparseMatrix<T,Opt,Index_t>&
+plain(const Eigen::SparseMatrix<T,Opt,Index_t>& t){return t;}
+
+template<typename T, int Rows, int Cols, int Opt, int MRows, int MCols>
+const Eigen::Matrix<T,Rows,Cols,Opt,MRows,MCols>&
+plain(const Eigen::Matrix<T,Rows,Cols,Opt,MRows,MCols>& t){return t;}
+
+template<typename Derived>
+typename Derived::PlainObject plain(const Eigen::EigenBase<Derived>& expr)
+{
+    return typename Derived::PlainObject(expr.derived());
+}
+
+///Returns the nonzero elements of a tensor sorted by flat index
+template<typename T, typename Tensor_t>
+std::vector<std::pair<size_t,T>> sorted_nonzeros(const Tensor_t& t)
+{
+    std::vector<std::pair<size_t,T>> rv;
+    SparseOperand<Tensor_t>::for_each(t,[&](size_t flat,T value){
+        if(value!=T{0})rv.emplace_back(flat,value);
+    });
+    std::sort(rv.begin(),rv.end());
+    return rv;
+}
+
+/** \brief Makes iterators over the indices of the nonzero elements of a
+ *  compressed sparse buffer.
+ *
+ *  The indices are generated in the order the nonzero values are stored, so
+ *  the i-th index generated corresponds to the i-th value.  The current
+ *  position in the buffer is recovered by a binary search within the row of
+ *  the current index.
+ *
+ *  \param[in] outer The offsets of each row in \p inner, or nullptr if the
+ *                   buffer is a single row (a vector).
+ *  \param[in] inner The column of each nonzero element.
+ *  \param[in] nnz The number of nonzero elements.
+ *  \param[in] shape The shape of the full tensor.
+ */
+template<size_t rank, typename Index_t>
+std::array<IndexItr<rank>,2>
+EigenSparse_make_itr(const Index_t* outer, const Index_t* inner, size_t nnz,
+                     const Shape<rank>& shape)
+{
+    using array_t=std::array<size_t,rank>;
+    const array_t end=shape.dims();
+    const size_t nrows=(outer ? end[0] : 1);
+    const size_t ncols=(outer ? (nrows ? shape.size()/nrows : 0) :
+                                shape.size());
+    auto row_start=[=](size_t row){
+        return outer ? (size_t)outer[row] : row*nnz;
+    };
+    auto row_of=[=](size_t p)->size_t{
+        if(!outer)return 0;
+        return std::upper_bound(outer,outer+nrows+1,(Index_t)p)-outer-1;
+    };
+    auto index_of=[=](size_t p){
+        return shape.unflatten_index(row_of(p)*ncols+inner[p]);
+    };
+
+    IndexItr<rank> end_itr(end,false,true);
+    IndexItr<rank> begin_itr(end,true,true,(nnz ? index_of(0) : end),
+        [=](array_t& idx,const array_t&,const array_t& end_in,bool)
+        {
+            const size_t flat=shape.flat_index(idx);
+            const size_t row=flat/ncols;
+            const Index_t* first=inner+row_start(row);
+            const Index_t* last=inner+row_start(row+1);
+            const size_t p=std::lower_bound(first,last,(Index_t)(flat%ncols))-
+                           inner+1;
+            idx=(p<nnz ? index_of(p) : end_in);
+        }
+    );
+    return {begin_itr,end_itr};
+}
+
+///Primary template for accessing the memory of a sparse tensor
+template<size_t R, typename T>
+struct EigenSparseMemory{
+    template<typename Tensor_t>
+    static MemoryBlock<R,T> get(Tensor_t& impl)
+    {
+        using op_t=SparseOperand<Tensor_t>;
+        op_t::compress(impl);
+        auto& buffer=op_t::unfolded(impl);
+        const Shape<R> shape(op_t::dims(impl));
+        auto itrs=EigenSparse_make_itr(op_t::outer(impl),
+                                       buffer.innerIndexPtr(),
+                                       (size_t)buffer.nonZeros(),shape);
+        MemoryBlock<R,T> rv;
+        rv.add_block(buffer.valuePtr(),
+                     Shape<R>(shape.dims(),true,{},itrs[0],itrs[1]));
+        return rv;
+    }
+
+    /** \brief Writes the elements in \p block into the tensor.
+     *
+     *  Elements of the tensor not in \p block are left alone, elements in
+     *  \p block that are zero are removed from the sparsity pattern.  If
+     *  \p add the elements in \p block are added to the tensor's instead.
+     */
+    template<typename Tensor_t>
+    static void set(Tensor_t& impl,const MemoryBlock<R,T>& block,
+                    bool add=false)
+    {
+        using op_t=SparseOperand<Tensor_t>;
+        //Check if it's actually the value buffer of this tensor
+        if(!add && block.nblocks()==1 &&
+           block.block(0)==op_t::unfolded(impl).valuePtr())
+            return;
+        const Shape<R> shape(op_t::dims(impl));
+        std::vector<std::pair<size_t,T>> entries;
+        op_t::for_each(impl,[&](size_t flat,T value){
+            entries.emplace_back(flat,value);
+        });
+        for(size_t i=0;i<block.nblocks();++i)
+        {
+            const T* blocki=block.block(i);
+            size_t counter=0;
+            for(auto idx=block.begin(i);idx!=block.end(i);++idx)
+                entries.emplace_back(shape.flat_index(*idx),
+                                     blocki[block.offset(i,counter++,*idx)]);
+        }
+        //Stable so that for repeated indices the last write wins
+        std::stable_sort(entries.begin(),entries.end(),
+                         [](const std::pair<size_t,T>& lhs,
+                            const std::pair<size_t,T>& rhs){
+                             return lhs.first<rhs.first;
+                         });
+        std::vector<std::pair<size_t,T>> nonzeros;
+        nonzeros.reserve(entries.size());
+        for(size_t i=0;i<entries.size();++i)
+        {
+            if(i+1<entries.size() && entries[i+1].first==entries[i].first)
+            {
+                if(add)entries[i+1].second+=entries[i].second;
+                continue;
+            }
+            if(entries[i].second!=T{0})
+                nonzeros.push_back(entries[i]);
+        }
+        op_t::set_entries(impl,nonzeros);
+    }
+};
+
+template<typename T>
+struct EigenSparseMemory<0,T>{
+    template<typename Tensor_t>
+    static MemoryBlock<0,T> get(Tensor_t& impl)
+    {
+        MemoryBlock<0,T> rv;
+        rv.add_block(&impl,Shape<0>(std::array<size_t,0>{},true));
+        return rv;
+    }
+
+    template<typename Tensor_t>
+    static void set(Tensor_t& impl,const MemoryBlock<0,T>& block,
+                    bool add=false)
+    {
+        impl=(add ? impl : T{0})+block.block(0)[0];
+    }
+};
+
+/** \brief A general contraction kernel for sparse tensors of any rank.
+ *
+ *  The nonzero elements of the right tensor are bucketed by their dummy
+ *  indices.  Then for each nonzero element of the left tensor the matching
+ *  bucket is looked up and the products are accumulated into a hash map
+ *  keyed on the result's flat index.  This is a generalization of Gustavson's
+ *  SpGEMM algorithm, the work scales with the number of nonzero products
+ *  rather than with the dimensions of the tensors.
+ *
+ *  Either operand may also be a dense Eigen vector/matrix; however, only its
+ *  nonzero elements participate.
+ *
+ *  \returns The result in the sparse backend's storage format for the rank of
+ *           the result.
+ */
+template<typename LHS_Idx, typename RHS_Idx, typename T,
+         typename LHS_t, typename RHS_t>
+auto sparse_contraction(const LHS_t& lhs_in, const RHS_t& rhs_in)
+{
+    const auto& lhs=plain(lhs_in);
+    const auto& rhs=plain(rhs_in);
+    using lop=SparseOperand<std::decay_t<decltype(lhs)>>;
+    using rop=SparseOperand<std::decay_t<decltype(rhs)>>;
+    constexpr size_t lrank=LHS_Idx::size();
+    constexpr size_t rrank=RHS_Idx::size();
+    constexpr size_t ndummy=LHS_Idx::ncommon(RHS_Idx());
+    constexpr size_t lnfree=lrank-ndummy;
+    constexpr size_t rnfree=rrank-ndummy;
+    using result_t=typename ToEigenSparseType<lnfree+rnfree,T>::type;
+    static_assert(lop::rank==lrank && rop::rank==rrank,
+                  "Number of indices does not match rank of tensor");
+
+    const auto dummy=get_dummy(LHS_Idx(),RHS_Idx());
+    const auto free=get_free(LHS_Idx(),RHS_Idx());
+    const auto ldims=lop::dims(lhs);
+    const auto rdims=rop::dims(rhs);
+    const Shape<lrank> lshape(ldims);
+    const Shape<rrank> rshape(rdims);
+    std::array<size_t,lnfree+rnfree> dims{};
+    size_t counter=0,rfree_size=1;
+    for(size_t i : free.first)dims[counter++]=ldims[i];
+    for(size_t i : free.second)
+    {
+        dims[counter++]=rdims[i];
+        rfree_size*=rdims[i];
+    }
+
+    //Group the right side by dummy indices
+    std::unordered_map<size_t,std::vector<std::pair<size_t,T>>> buckets;
+    rop::for_each(rhs,[&](size_t flat,T value){
+        const auto idx=rshape.unflatten_index(flat);
+        size_t key=0,rfree=0;
+        for(size_t i=0;i<ndummy;++i)
+            key=key*rdims[dummy.second[i]]+idx[dummy.second[i]];
+        for(size_t i : free.second)
+            rfree=rfree*rdims[i]+idx[i];
+        buckets[key].emplace_back(rfree,value);
+    });
+
+    std::unordered_map<size_t,T> accumulator;
+    lop::for_each(lhs,[&](size_t flat,T value){
+        const auto idx=lshape.unflatten_index(flat);
+        size_t key=0,lfree=0;
+        for(size_t i=0;i<ndummy;++i)
+            key=key*ldims[dummy.first[i]]+idx[dummy.first[i]];
+        auto bucket=buckets.find(key);
+        if(bucket==buckets.end())
+            return;
+        for(size_t i : free.first)
+            lfree=lfree*ldims[i]+idx[i];
+        for(const auto& x : bucket->second)
+            accumulator[lfree*rfree_size+x.first]+=value*x.second;
+    });
+
+    std::vector<std::pair<size_t,T>> entries;
+    entries.reserve(accumulator.size());
+    for(const auto& x : accumulator)
+        if(x.second!=T{0})entries.push_back(x);
+    std::sort(entries.begin(),entries.end());
+
+    using result_op=SparseOperand<result_t>;
+    result_t rv=result_op::make(dims);
+    result_op::set_entries(rv,entries);
+    return rv;
+}
+
+/** \brief Maps a contraction onto Eigen's sparse kernels.
+ *
+ *  Matrix-matrix products become SpGEMM when both sides are sparse and SpMM
+ *  when one side is dense, Eigen picks the kernel based on the operand types.
+ *  The primary template handles everything Eigen does not have a kernel for
+ *  by calling sparse_contraction.
+ */
+template<size_t LRank, size_t RRank, size_t NFree, bool ltranspose,
+         bool rtranspose>
+struct SparseContractionHelper{
+    template<typename LHS_Idx,typename RHS_Idx,typename T,
+             typename LHS_t,typename RHS_t>
+    static auto contract(const LHS_t& lhs, const RHS_t& rhs)
+    {
+        return sparse_contraction<LHS_Idx,RHS_Idx,T>(lhs,rhs);
+    }
+};
+
+#define SHelperSpecial(LRank,RRank,NFree,ltranspose,rtranspose,guts)\
+template<>\
+struct SparseContractionHelper<LRank,RRank,NFree,ltranspose,rtranspose>{\
+template<typename,typename,typename,typename LHS_t,typename RHS_t>\
+static auto contract(const LHS_t& lhs, const RHS_t& rhs){\
+   return guts;\
+}}
+
+//i,j * i,j
+SHelperSpecial(2,2,0,false,false,lhs.cwiseProduct(rhs).sum());
+//i,j * k,j
+SHelperSpecial(2,2,2,false,true,lhs*rhs.transpose());
+//j,i * j,k
+SHelperSpecial(2,2,2,true,false,lhs.transpose()*rhs);
+//i,j * j,k
+SHelperSpecial(2,2,2,false,false,lhs*rhs);
+//j,i * k,j
+SHelperSpecial(2,2,2,true,true,lhs.transpose()*rhs.transpose());
+//i,j * j
+SHelperSpecial(2,1,1,false,false,lhs*rhs);
+//j,i * j
+SHelperSpecial(2,1,1,true,false,lhs.transpose()*rhs);
+//i * i,j (computed as a column vector)
+SHelperSpecial(1,2,1,true,false,rhs.transpose()*lhs);
+//i * j,i
+SHelperSpecial(1,2,1,true,true,rhs*lhs);
+//i * i
+SHelperSpecial(1,1,0,true,false,lhs.dot(rhs));
+//i * j
+SHelperSpecial(1,1,2,false,true,lhs*rhs.transpose());
+//scalar * scalar
+SHelperSpecial(0,0,0,false,false,lhs*rhs);
+
+#undef SHelperSpecial
+
+/** \brief Works out which entry of SparseContractionHelper to call.
+ *
+ *  For vectors and matrices we defer to ContractionTraits to work out the
+ *  transposes.  Unlike the dense case the number of free indices is computed
+ *  from the actual number of common indices, so contractions without a
+ *  matrix kernel (e.g. outer products of matrices) fall through to the general
+ *  kernel.
+ */
+template<typename LHS_Idx, typename RHS_Idx,
+         size_t LRank=LHS_Idx::size(), size_t RRank=RHS_Idx::size(),
+         bool is_matrix=(LRank==1 || LRank==2) && (RRank==1 || RRank==2)>
+struct SparseContractionTraits{
+    constexpr static size_t nfree=LRank+RRank-2*LHS_Idx::ncommon(RHS_Idx());
+    constexpr static bool ltranspose=false;
+    constexpr static bool rtranspose=false;
+};
+
+template<typename LHS_Idx, typename RHS_Idx, size_t LRank, size_t RRank>
+struct SparseContractionTraits<LHS_Idx,RHS_Idx,LRank,RRank,true>{
+    using contract=ContractionTraits<LHS_Idx,RHS_Idx,LRank,RRank>;
+    constexpr static size_t nfree=LRank+RRank-2*LHS_Idx::ncommon(RHS_Idx());
+    constexpr static bool ltranspose=contract::ltranspose;
+    constexpr static bool rtranspose=contract::rtranspose;
+};
+
+/** \brief Primary template for converting the result of an operation to our
+ *  type.
+ *
+ *  Applies to sparse expressions, scalars, and the higher rank tensors (which
+ *  are never expressions).
+ */
+template<size_t R, typename T, bool is_dense>
+struct SparseEvaluator{
+    template<typename Op_t>
+    static auto eval(const Op_t& op)
+    {
+        return typename ToEigenSparseType<R,T>::type(op);
+    }
+};
+
+///Specialization for when Eigen's kernels produced a dense result (SpMM)
+template<size_t R, typename T>
+struct SparseEvaluator<R,T,true>{
+    template<typename Op_t>
+    static auto eval(const Op_t& op)
+    {
+        typename ToEigenType<R,T>::type dense=op;
+        return typename ToEigenSparseType<R,T>::type(dense.sparseView());
+    }
+};
+
+///Primary template for permuting a sparse tensor
+template<size_t R, typename T>
+struct SparsePermuter{
+    template<typename Tensor_t>
+    static auto eval(const Tensor_t& t,const std::array<size_t,R>& map)
+    {
+        using op_t=SparseOperand<Tensor_t>;
+        const auto old_dims=op_t::dims(t);
+        std::array<size_t,R> new_dims{};
+        for(size_t i=0;i<R;++i)new_dims[map[i]]=old_dims[i];
+        const Shape<R> old_shape(old_dims),new_shape(new_dims);
+        std::vector<std::pair<size_t,T>> entries;
+        op_t::for_each(t,[&](size_t flat,T value){
+            const auto old_idx=old_shape.unflatten_index(flat);
+            std::array<size_t,R> new_idx{};
+            for(size_t i=0;i<R;++i)new_idx[map[i]]=old_idx[i];
+            entries.emplace_back(new_shape.flat_index(new_idx),value);
+        });
+        std::sort(entries.begin(),entries.end());
+        auto rv=op_t::make(new_dims);
+        op_t::set_entries(rv,entries);
+        return rv;
+    }
+};
+
+///Specialization to matrices, only possibility is a transpose
+template<typename T>
+struct SparsePermuter<2,T>{
+    template<typename Tensor_t>
+    static auto eval(const Tensor_t& t,const std::array<size_t,2>&)
+    {
+        return typename ToEigenSparseType<2,T>::type(t.transpose());
+    }
+};
+
+//Sparse matrix/vector specialization
+template<size_t R, typename T>
+struct TensorWrapperImpl<R,T,TensorTypes::EigenSparse> {
+
+    using array_t=std::array<size_t,R>;
+    using type=typename ToEigenSparseType<R,T>::type;
+
+    template<typename LHS_Idx,typename RHS_Idx>
+    using EnableIfSameIdx=std::enable_if<
+            std::is_same<LHS_Idx,RHS_Idx>::value,int>;
+
+    template<typename LHS_Idx,typename RHS_Idx>
+    using EnableIfNotSameIdx=std::enable_if<
+            !std::is_same<LHS_Idx,RHS_Idx>::value,int>;
+
+    template<typename Tensor_t>
+    Shape<R> dims(const Tensor_t& impl)const{
+        return Shape<R>(SparseOperand<Tensor_t>::dims(impl),true);
+    }
+
+    /** \brief Returns the nonzero elements of the tensor.
+     *
+     *  The result is a single block pointing at the tensor's value buffer.
+     *  Iterating over the block generates only the indices of the nonzero
+     *  elements.  Nonzero elements may be modified in place, but new ones can
+     *  only be added via set_memory.
+     */
+    template<typename Tensor_t>
+    auto get_memory(Tensor_t& impl)const{
+        return EigenSparseMemory<R,T>::get(impl);
+    }
+
+    template<typename Tensor_t>
+    void set_memory(Tensor_t& impl,const MemoryBlock<R,T>& block)const
+    {
+        EigenSparseMemory<R,T>::set(impl,block);
+    }
+
+    ///Allocates a tensor with no nonzero elements
+    type allocate(const array_t& dims)const{
+        return SparseOperand<type>::make(dims);
+    }
+
+    template<typename Tensor_t>
+    type permute(const Tensor_t& t, const array_t& map)const
+    {
+        return SparsePermuter<R,T>::eval(plain(t),map);
+    }
+
+    template<typename Tensor_t>
+    type slice(const Tensor_t& impl,
+               const array_t& start,const array_t& end)const{
+        const auto& t=plain(impl);
+        using op_t=SparseOperand<std::decay_t<decltype(t)>>;
+        array_t new_dims{};
+        for(size_t i=0;i<R;++i)new_dims[i]=end[i]-start[i];
+        const Shape<R> old_shape(op_t::dims(t)),new_shape(new_dims);
+        std::vector<std::pair<size_t,T>> entries;
+        op_t::for_each(t,[&](size_t flat,T value){
+            auto idx=old_shape.unflatten_index(flat);
+            for(size_t i=0;i<R;++i)
+            {
+                if(idx[i]<start[i] || idx[i]>=end[i])return;
+                idx[i]-=start[i];
+            }
+            entries.emplace_back(new_shape.flat_index(idx),value);
+        });
+        std::sort(entries.begin(),entries.end());
+        type rv=allocate(new_dims);
+        SparseOperand<type>::set_entries(rv,entries);
+        return rv;
+    }
+
+    ///Returns true if two tensors have the same shape and nonzero elements
+    template<typename LHS_t, typename RHS_t>
+    bool are_equal(const LHS_t& lhs, const RHS_t& rhs)const
+    {
+        const auto& l=plain(lhs);
+        const auto& r=plain(rhs);
+        using lop=SparseOperand<std::decay_t<decltype(l)>>;
+        using rop=SparseOperand<std::decay_t<decltype(r)>>;
+        return lop::dims(l)==rop::dims(r) &&
+               sorted_nonzeros<T>(l)==sorted_nonzeros<T>(r);
+    }
+
+    template<typename, typename Tensor_t>
+    auto scale(const Tensor_t& lhs,double val)const
+    {
+        return lhs*val;
+    }
+
+    ///Adds to the tensor
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t,
+             typename EnableIfSameIdx<LHS_Idx,RHS_Idx>::type=0>
+    auto add(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        return lhs+rhs;
+    }
+
+    //Sparse element-wise operations need the same storage order on both sides
+    //so the right side is permuted into a new tensor, which means the sum has
+    //to be evaluated before that tensor goes out of scope
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t,
+             typename EnableIfNotSameIdx<LHS_Idx,RHS_Idx>::type=0>
+    auto add(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        const type rhs_permuted=permute(rhs,RHS_Idx::get_map(LHS_Idx()));
+        return plain(lhs+rhs_permuted);
+    }
+
+    ///Subtracts from the tensor
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t,
+             typename EnableIfSameIdx<LHS_Idx,RHS_Idx>::type=0>
+    auto subtract(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        return lhs-rhs;
+    }
+
+    template<typename LHS_Idx,typename RHS_Idx,
+             typename LHS_t,typename RHS_t,
+             typename EnableIfNotSameIdx<LHS_Idx,RHS_Idx>::type=0>
+    auto subtract(const LHS_t& lhs,const RHS_t&rhs)const
+    {
+        const type rhs_permuted=permute(rhs,RHS_Idx::get_map(LHS_Idx()));
+        return plain(lhs-rhs_permuted);
+    }
+
+    template<typename,typename Op_t>
+    type eval(const Op_t& op,const array_t&)const
+    {
+        constexpr bool is_dense=(R==1 || R==2) &&
+                !std::is_base_of<Eigen::SparseMatrixBase<Op_t>,Op_t>::value;
+        return SparseEvaluator<R,T,is_dense>::eval(op);
+    }
+
+    /** \brief Contracts two tensors.
+     *
+     *  Both sides may be sparse, or one side may be a dense Eigen
+     *  vector/matrix.  Matrix/vector contractions use Eigen's kernels, all
+     *  others use sparse_contraction.
+     */
+    template<typename LHS_Idx,typename RHS_Idx,typename LHS_t,typename RHS_t>
+    auto contraction(const LHS_t& lhs, const RHS_t& rhs)const
+    {
+        using traits=SparseContractionTraits<LHS_Idx,RHS_Idx>;
+        return SparseContractionHelper<LHS_Idx::size(),
+                                       RHS_Idx::size(),
+                                       traits::nfree,
+                                       traits::ltranspose,
+                                       traits::rtranspose>().template
+                contract<LHS_Idx,RHS_Idx,T>(lhs,rhs);
+    }
+
+    template<typename LHS_Idx,typename LHS_t>
+    auto trace(const LHS_t& lhs)const
+    {
+        static_assert(LHS_Idx().size()==2,"Trace only available for matrix");
+        return plain(lhs).diagonal().sum();
+    }
+
+    ///The eigen system is dense so this goes through Eigen's dense solver
+    template<typename My_t>
+    auto self_adjoint_eigen_solver(const My_t& tensor)const
+    {
+        static_assert(R==2,"Eigen solving only available for matrices");
+        using matrix_t=typename ToEigenType<2,T>::type;
+        const matrix_t dense(tensor);
+        Eigen::SelfAdjointEigenSolver<matrix_t> solver(dense);
+        typename ToEigenSparseType<1,T>::type evals=
+                solver.eigenvalues().sparseView();
+        type evecs=solver.eigenvectors().sparseView();
+        return std::make_pair(evals,evecs);
+    }
+
+};
+
+/** \brief Adds the elements in \p mem to those of a sparse tensor.
+ *
+ *  Adding may change the sparsity pattern, so accumulations into the same
+ *  tensor are serialized with a striped lock.
+ */
+template<size_t R, typename T, typename Tensor_t>
+void accumulate_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::EigenSparse>&,
+        Tensor_t& t, const MemoryBlock<R,T>& mem)
+{
+    std::lock_guard<std::mutex> lock(accumulate_lock(&t));
+    EigenSparseMemory<R,T>::set(t,mem,true);
+}
+
+}}//End namespaces
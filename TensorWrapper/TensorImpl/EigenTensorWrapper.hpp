@@ -1,6 +1,5 @@
 #pragma once
 #include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
-#include "TensorWrapper/TMUtils/TypeComparisons.hpp"
 #include <Eigen/Dense>
 #include <unsupported/Eigen/CXX11/ThreadPool>
 #include <unsupported/Eigen/CXX11/Tensor>
@@ -24,6 +23,20 @@ auto allocater(const std::array<size_t,rank>& idx)
      return allocate_guts<Tensor_t>(idx, std::make_index_sequence<rank>{});
 }
 
+/** \brief The device Eigen tensor expressions are evaluated on.
+ *
+ *  Its threads are shared by every evaluation, so expressions evaluated at the
+ *  same time (see eval_async) do not each start their own.  It has as many
+ *  threads as the RunTime gives each rank when it is first used.
+ */
+inline Eigen::ThreadPoolDevice& eigen_device()
+{
+    static const int nthreads=num_threads();
+    static Eigen::ThreadPool pool(nthreads);
+    static Eigen::ThreadPoolDevice device(&pool,nthreads);
+    return device;
+}
+
 template<typename T>
 struct TraceHelper;
 
@@ -31,7 +44,7 @@ template<typename...Idxs>
 struct TraceHelper<Indices<Idxs...>>{
     static constexpr size_t full_size=sizeof...(Idxs);
     static constexpr size_t done_size=
-            std::tuple_size<typename GetUnique<Idxs...>::type>::value;
+            TracedIndices<Indices<Idxs...>>::type::size();
 };
 
 
@@ -164,11 +177,8 @@ struct TensorWrapperImpl<rank,T,TensorTypes::EigenTensor> {
     template<typename,typename Op_t>
     type eval(const Op_t& op,const array_t& dims)const
     {
-        const int nthreads=omp_get_max_threads();
-        Eigen::ThreadPool pool(nthreads);
-        Eigen::ThreadPoolDevice my_device(&pool,nthreads);
         auto c=allocate(dims);
-        c.device(my_device)=op;
+        c.device(eigen_device())=op;
         return c;
     }
 
@@ -192,4 +202,15 @@ struct TensorWrapperImpl<rank,T,TensorTypes::EigenTensor> {
         return std::make_pair(evals,evecs);
     }
 };
+
+///get_memory points into the tensor, so adds go straight in, atomically
+template<size_t R, typename T, typename Tensor_t>
+void accumulate_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::EigenTensor>& impl,
+        Tensor_t& t, const MemoryBlock<R,T>& mem)
+{
+    auto local=impl.get_memory(t);
+    add_blocks(local,mem,true);
+}
+
 }}//End namespaces
@@ -1,7 +1,13 @@
 #pragma once
 #include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
 #include "TensorWrapper/TensorImpl/ContractionHelper.hpp"
+#include "TensorWrapper/TensorImpl/BlockFetcher.hpp"
+#include "TensorWrapper/TensorImpl/Redistribute.hpp"
 #include <ga_cxx/GATensor.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace TWrapper {
 namespace detail_ {
@@ -36,22 +42,212 @@ struct GAContract<lt,rt,0>{
     }
 };
 
+/** \brief A Global Array, or a patch of one, that is shared until it is
+ *  written to.
+ *
+ *  Slicing makes a view: it shares the parent's array and only records the
+ *  patch it covers, so no elements move.  Views are read in place; get_values
+ *  and my_slice refer to the parent's patch.  The first time a view is written
+ *  to, or used in an operation GA only does on whole arrays, it is
+ *  materialized into an array of its own.  Copies share the array too and
+ *  whichever copy is written to first makes its own, so later writes to the
+ *  parent never show up in its views.
+ *
+ *  \note Making a Global Array is collective, so every process must use a
+ *  view in the same way.  As materialization happens in const member
+ *  functions two threads should not concurrently use the same view.  For the
+ *  same reason acc_values, which need not be collective, never makes an
+ *  array: the instance must already have one of its own (see own_array()).
+ */
+template<size_t rank, typename T>
+class GAView{
+public:
+    using tensor_type=GATensor<rank,T>;
+    using array_t=std::array<size_t,rank>;
+
+    GAView()=default;
+
+    ///Makes a zeroed array
+    explicit GAView(const array_t& dims):
+        GAView(tensor_type(dims))
+    {}
+
+    ///Takes ownership of \p t
+    GAView(tensor_type&& t):
+        array_(std::make_shared<tensor_type>(std::move(t))),
+        end_(array_->dims())
+    {}
+
+    ///Makes a view of the patch [\p start, \p end) of \p parent
+    GAView(const GAView& parent, const array_t& start, const array_t& end):
+        array_(parent.array_)
+    {
+        for(size_t i=0;i<rank;++i)
+        {
+            start_[i]=parent.start_[i]+start[i];
+            end_[i]=parent.start_[i]+end[i];
+        }
+    }
+
+    ///Returns the number of indices along each mode
+    array_t dims()const noexcept
+    {
+        array_t rv;
+        for(size_t i=0;i<rank;++i)rv[i]=end_[i]-start_[i];
+        return rv;
+    }
+
+    ///True if this only covers part of the array it shares
+    bool is_view()const noexcept
+    {
+        return array_ && (start_!=array_t{} || end_!=array_->dims());
+    }
+
+    /** \brief Returns the first and (one past the) last index of the part of
+     *  this patch held by this process.  Both are zero if it holds none.
+     */
+    std::pair<array_t,array_t> my_slice()const
+    {
+        array_t start,end;
+        std::tie(start,end)=array_->my_slice();
+        for(size_t i=0;i<rank;++i)
+        {
+            const size_t first=std::max(start[i],start_[i]);
+            const size_t last=std::min(end[i],end_[i]);
+            if(first>=last)return {array_t{},array_t{}};
+            start[i]=first-start_[i];
+            end[i]=last-start_[i];
+        }
+        return {start,end};
+    }
+
+    ///Reads the elements in [\p start, \p end) of this patch
+    std::vector<T> get_values(const array_t& start, const array_t& end)const
+    {
+        return array_->get_values(shift(start),shift(end));
+    }
+
+    ///Writes the elements in [\p start, \p end), materializing if needed
+    void set_values(const array_t& start, const array_t& end, const T* values)
+    {
+        detach();
+        array_->set_values(start,end,values);
+    }
+
+    /** \brief Adds to the elements in [\p start, \p end) with NGA_Acc.
+     *
+     *  GA's accumulate is atomic, so threads and processes may call this at
+     *  once.  This instance must have an array of its own (see own_array()),
+     *  as making one is collective.
+     *
+     *  \throws std::logic_error if this is a view or shares its array.
+     */
+    void acc_values(const array_t& start, const array_t& end, const T* values)
+    {
+        if(!owns_array())
+            throw std::logic_error("Can't accumulate into a shared Global "
+                                   "Array; set its memory (collectively) "
+                                   "first");
+        array_->acc_values(start,end,values);
+    }
+
+    ///True if this instance has an array no other instance uses
+    bool owns_array()const noexcept
+    {
+        return !is_view() && array_.use_count()==1;
+    }
+
+    ///Gives this instance an array of its own.  Collective if it hasn't one.
+    void own_array()
+    {
+        detach();
+    }
+
+    ///Returns the array, materializing this view if needed
+    const tensor_type& tensor()const
+    {
+        if(is_view())materialize();
+        return *array_;
+    }
+
+    ///Returns an array only this instance uses
+    tensor_type& tensor()
+    {
+        detach();
+        return *array_;
+    }
+
+private:
+    ///The array this instance (or patch of it) lives in
+    mutable std::shared_ptr<tensor_type> array_;
+
+    ///The first index of the patch, in the array
+    mutable array_t start_{};
+
+    ///One past the last index of the patch, in the array
+    mutable array_t end_{};
+
+    array_t shift(const array_t& idx)const noexcept
+    {
+        array_t rv;
+        for(size_t i=0;i<rank;++i)rv[i]=start_[i]+idx[i];
+        return rv;
+    }
+
+    ///Copies the patch into an array of its own
+    void materialize()const
+    {
+        const array_t new_dims=dims();
+        tensor_type t(new_dims);
+        const auto values=array_->get_values(start_,end_);
+        t.set_values(array_t{},new_dims,values.data());
+        array_=std::make_shared<tensor_type>(std::move(t));
+        start_=array_t{};
+        end_=new_dims;
+    }
+
+    ///Makes sure no other instance shares the array
+    void detach()
+    {
+        if(is_view())
+            materialize();
+        else if(array_.use_count()>1)
+            array_=std::make_shared<tensor_type>(*array_);
+    }
+};
+
+///Returns the Global Array behind an operand (materializing views)
+template<typename Tensor_t>
+const Tensor_t& unview(const Tensor_t& t)
+{
+    return t;
+}
+
+template<size_t rank, typename T>
+const GATensor<rank,T>& unview(const GAView<rank,T>& t)
+{
+    return t.tensor();
+}
+
 template<size_t rank, typename T>
 struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
-    using type = GATensor<rank,T>;
+    using type = GAView<rank,T>;
     using array_t = std::array<size_t,rank>;
 
-    Shape<rank> dims(const type& impl)const{
+    template<typename Tensor_t>
+    Shape<rank> dims(const Tensor_t& impl)const{
         return Shape<rank>(impl.dims(),true);
     }
 
+    ///For views, only the part of the parent's patch held by this process
     template<typename Tensor_t>
     auto get_memory(Tensor_t& impl)const{
         array_t start,end;
         std::tie(start,end)=impl.my_slice();
-        auto mem=impl.get_values(start,end);
         Shape<rank> my_shape(end,true,start);
         MemoryBlock<rank,T> rv;
+        if(!my_shape.size())return rv;
+        auto mem=impl.get_values(start,end);
         std::unique_ptr<T[]> ptr(new T[my_shape.size()]);
         std::copy(mem.begin(),mem.end(),ptr.get());
         rv.add_block(std::move(ptr),my_shape);
@@ -61,9 +257,38 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
     template<typename Tensor_t>
     void set_memory(Tensor_t& impl,const MemoryBlock<rank,T>& block)const
     {
+        write_memory(impl,block,false);
+    }
+
+    /** \brief Sets (or, if \p add, accumulates into) the patches in \p block.
+     *
+     *  Setting is collective: it materializes a view, which makes a Global
+     *  Array, so every process does so up front, including those whose
+     *  \p block is empty.  Accumulating is not, so \p impl must already have
+     *  an array of its own (see GAView::acc_values).
+     */
+    template<typename Tensor_t>
+    void write_memory(Tensor_t& impl,const MemoryBlock<rank,T>& block,
+                      bool add)const
+    {
+        if(!add)impl.own_array();
         for(size_t i=0;i<block.nblocks();++i)
         {
-            impl.set_values(*block.begin(i),*block.end(i),block.block(i));
+            const Shape<rank>& shape=block.shape(i);
+            const T* values=block.block(i);
+            //GA wants the elements packed
+            std::vector<T> packed;
+            if(!shape.is_contiguous())
+            {
+                packed.reserve(shape.size());
+                for(auto idx=block.begin(i);idx!=block.end(i);++idx)
+                    packed.push_back(block.block(i)[shape.offset(*idx)]);
+                values=packed.data();
+            }
+            if(add)
+                impl.acc_values(*block.begin(i),*block.end(i),values);
+            else
+                impl.set_values(*block.begin(i),*block.end(i),values);
         }
     }
 
@@ -76,45 +301,39 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
     auto trace(const LHS_t& lhs)const
     {
         static_assert(LHS_Idx().size()==2,"Trace only available for matrix");
-        return lhs.trace();
+        return unview(lhs).trace();
     }
 
     template<typename Tensor_t>
     auto permute(const Tensor_t& t, const array_t&)const
     {
-        return t.transpose();
+        return unview(t).transpose();
     }
 
-    template<typename Tensor_t>
-    auto slice(const Tensor_t& impl,
+    ///Returns a view of the patch; no elements are moved
+    type slice(const type& impl,
                const array_t& start,
                const array_t& end)const{
-        auto data=impl.get_values(start,end);
-        array_t new_dims,zero{};
-        for(size_t i=0;i<start.size();++i)
-            new_dims[i]=end[i]-start[i];
-        type rv(new_dims);
-        rv.set_values(zero,new_dims,data.data());
-        return rv;
+        return type(impl,start,end);
     }
 
     template<typename LHS_t, typename RHS_t>
     bool are_equal(const LHS_t& lhs, const RHS_t& other)const
     {
-        return lhs==other;
+        return unview(lhs)==unview(other);
     }
 
     template<typename Index_t, typename LHS_t>
     auto scale(const LHS_t& lhs,double val)const
     {
-        return lhs*val;
+        return unview(lhs)*val;
     }
 
     template<typename Op_t>
     type eval(const Op_t& op,const array_t&)const
     {
-        type c=op;
-        return c;
+        typename type::tensor_type c=unview(op);
+        return type(std::move(c));
     }
 
     ///Adds to the tensor
@@ -123,8 +342,8 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
     auto add(const LHS_t& lhs,const RHS_t&rhs)const
     {
         if(std::is_same<LHS_Idx,RHS_Idx>::value)
-            return lhs+rhs;
-        return lhs+rhs.transpose();
+            return unview(lhs)+unview(rhs);
+        return unview(lhs)+unview(rhs).transpose();
     }
 
     ///Subtracts from the tensor
@@ -133,15 +352,15 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
     auto subtract(const LHS_t& lhs,const RHS_t&rhs)const
     {
         if(std::is_same<LHS_Idx,RHS_Idx>::value)
-            return lhs-rhs;
-        return lhs-rhs.transpose();
+            return unview(lhs)-unview(rhs);
+        return unview(lhs)-unview(rhs).transpose();
     }
 
     template<typename,typename Op_t>
     auto eval(const Op_t& op,const array_t&)const
     {
-        type c=op;
-        return c;
+        typename type::tensor_type c=unview(op);
+        return type(std::move(c));
     }
 
     ///Contraction
@@ -153,7 +372,7 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
         using traits=
             ContractionTraits<LHS_Idx,RHS_Idx,LHS_Idx::size(),RHS_Idx::size()>;
         return GAContract<traits::ltranspose,traits::rtranspose,traits::nfree>::
-                eval(lhs,rhs);
+                eval(unview(lhs),unview(rhs));
     }
 
 
@@ -176,4 +395,82 @@ struct TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays> {
 //    return std::make_pair(evals,evecs);
 //    }
 };
+/** \brief Fetches the patches each process holds of a Global Array.
+ *
+ *  ga_cxx only has blocking gets, so a patch is read as soon as its fetch is
+ *  started: streams read ahead but do not overlap the reads with work.
+ *  Making a fetcher is collective over MPI_COMM_WORLD.
+ */
+template<size_t rank, typename T>
+class BlockFetcher<rank,T,TensorTypes::GlobalArrays>{
+public:
+    using impl_type=TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays>;
+    using tensor_type=typename impl_type::type;
+    using array_t=std::array<size_t,rank>;
+
+    BlockFetcher(const impl_type&, tensor_type& t):
+        t_(&t)
+    {
+        array_t start,end;
+        std::tie(start,end)=t.my_slice();
+        std::vector<uint64_t> mine;
+        if(Shape<rank>(end,true,start).size())
+        {
+            mine.insert(mine.end(),start.begin(),start.end());
+            mine.insert(mine.end(),end.begin(),end.end());
+        }
+        for(const auto& boxes : all_boxes(mine,MPI_COMM_WORLD))
+            for(size_t i=0;i<boxes.size();i+=2*rank)
+            {
+                std::copy(&boxes[i],&boxes[i]+rank,start.begin());
+                std::copy(&boxes[i]+rank,&boxes[i]+2*rank,end.begin());
+                blocks_.emplace_back(end,true,start);
+            }
+    }
+
+    ///Returns the patches, in the order of the processes holding them
+    const std::vector<Shape<rank>>& blocks()const noexcept{return blocks_;}
+
+    void start(size_t i, T* buffer)
+    {
+        const array_t start=*blocks_[i].begin();
+        array_t end;
+        for(size_t j=0;j<rank;++j)end[j]=start[j]+blocks_[i].dims()[j];
+        const auto values=t_->get_values(start,end);
+        std::copy(values.begin(),values.end(),buffer);
+    }
+
+    void wait(size_t, T*){}
+
+private:
+    const tensor_type* t_;
+    std::vector<Shape<rank>> blocks_;
+};
+
+/** \brief Adds the elements in \p mem to those of a Global Array with GA's
+ *  atomic accumulate (see GAView::acc_values).
+ *
+ *  Overloads the generic accumulate_memory.  Contributions may go to any
+ *  element, local or not, and need not be collective.  Hence a view, or a copy
+ *  still sharing its array, can't be accumulated into until a collective call
+ *  (*e.g.* set_memory) has given it an array of its own.
+ *
+ *  \throws std::logic_error if \p t is a view or shares its array.
+ */
+template<size_t rank, typename T, typename Tensor_t>
+void accumulate_memory(
+        const TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays>& impl,
+        Tensor_t& t, const MemoryBlock<rank,T>& mem)
+{
+    impl.write_memory(t,mem,true);
+}
+
+///Global Arrays always spans MPI_COMM_WORLD (see Redistribute.hpp)
+template<size_t rank, typename T, typename Tensor_t>
+MPI_Comm tensor_comm(const TensorWrapperImpl<rank,T,TensorTypes::GlobalArrays>&,
+                     const Tensor_t&)
+{
+    return MPI_COMM_WORLD;
+}
+
 }}//End namespaces
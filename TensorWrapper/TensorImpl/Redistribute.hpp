@@ -0,0 +1,312 @@
+#pragma once
+#include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/** \file Moves the elements of a distributed tensor into a tensor of another
+ *  distributed backend without gathering them.
+ *
+ *  Each rank describes the boxes of indices it holds of the source and of the
+ *  target.  Every rank learns all of the boxes, after which the elements one
+ *  rank sends another are those in the intersections of its source boxes with
+ *  the other's target boxes.  Both sides enumerate the intersections in the
+ *  same order, so only the elements themselves are sent, with one
+ *  MPI_Alltoallv.
+ */
+
+namespace TWrapper {
+namespace detail_ {
+
+///The ways the elements of one backend's tensor are copied into another's
+enum class CopyStrategy {
+    Gather,      //!< Every rank gets the whole source (the general case)
+    Redistribute,//!< Exchanged between backends with box blocks
+    WriteCTF,    //!< CTF's write routes this rank's source elements
+    ReadCTF      //!< CTF's read fetches this rank's target elements
+};
+
+///True if the blocks the backend hands out are boxes (see redistribute)
+constexpr bool has_box_blocks(TensorTypes type)
+{
+    return type==TensorTypes::Distributed || type==TensorTypes::GlobalArrays ||
+           type==TensorTypes::TiledArray;
+}
+
+///Returns how a tensor of backend \p T2 is copied into one of backend \p T1
+constexpr CopyStrategy copy_strategy(TensorTypes T1, TensorTypes T2)
+{
+#ifdef ENABLE_DISTRIBUTED
+    return !is_distributed(T1) || !is_distributed(T2) ? CopyStrategy::Gather :
+            T1==TensorTypes::CTF ? CopyStrategy::WriteCTF :
+            T2==TensorTypes::CTF ? CopyStrategy::ReadCTF :
+            has_box_blocks(T1) && has_box_blocks(T2) ?
+                CopyStrategy::Redistribute : CopyStrategy::Gather;
+#else
+    return CopyStrategy::Gather;
+#endif
+}
+
+/** \brief Copies the elements of \p from, a tensor of backend T2, into
+ *  \p to, a newly allocated tensor of backend T1.  Collective.
+ *
+ *  The primary template gathers the source onto every rank and sets the
+ *  target from it.
+ */
+template<TensorTypes T1, TensorTypes T2,
+         CopyStrategy strategy=copy_strategy(T1,T2)>
+struct CopyElements{
+    template<typename Impl1_t, typename Tensor1_t,
+             typename Impl2_t, typename Tensor2_t>
+    static void eval(const Impl1_t& impl, Tensor1_t& to,
+                     const Impl2_t& impl2, Tensor2_t& from)
+    {
+        impl.set_memory(to,gather_memory(impl2,from));
+    }
+};
+
+#ifdef ENABLE_DISTRIBUTED
+
+/** \brief Returns the blocks of a newly allocated tensor that this rank is to
+ *  fill before handing them to set_memory.
+ *
+ *  For most backends this is get_memory.  Backends whose get_memory can't be
+ *  called on a tensor that has no elements yet overload this function (it is
+ *  found by argument dependent lookup).
+ */
+template<size_t R, typename T, TensorTypes TT, typename Tensor_t>
+MemoryBlock<R,T> local_memory(const TensorWrapperImpl<R,T,TT>& impl,
+                              Tensor_t& t)
+{
+    return impl.get_memory(t);
+}
+
+///The first and last index of each block of \p mem, flattened
+template<size_t R, typename T>
+std::vector<uint64_t> block_boxes(const MemoryBlock<R,T>& mem)
+{
+    std::vector<uint64_t> rv;
+    rv.reserve(2*R*mem.nblocks());
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        const auto& shape=mem.shape(i);
+        const auto start=*shape.begin();
+        for(size_t j=0;j<R;++j)rv.push_back(start[j]);
+        for(size_t j=0;j<R;++j)rv.push_back(start[j]+shape.dims()[j]);
+    }
+    return rv;
+}
+
+///Returns the boxes of every rank of \p comm; rv[r] are those of rank r
+inline std::vector<std::vector<uint64_t>>
+all_boxes(const std::vector<uint64_t>& mine, MPI_Comm comm)
+{
+    int nprocs;
+    MPI_Comm_size(comm,&nprocs);
+    std::vector<int> counts(nprocs),displs(nprocs,0);
+    const int n=static_cast<int>(mine.size());
+    MPI_Allgather(&n,1,MPI_INT,counts.data(),1,MPI_INT,comm);
+    for(int r=1;r<nprocs;++r)displs[r]=displs[r-1]+counts[r-1];
+    std::vector<uint64_t> buffer(displs.back()+counts.back());
+    MPI_Allgatherv(mine.data(),n,MPI_UINT64_T,buffer.data(),counts.data(),
+                   displs.data(),MPI_UINT64_T,comm);
+    std::vector<std::vector<uint64_t>> rv(nprocs);
+    for(int r=0;r<nprocs;++r)
+        rv[r].assign(buffer.begin()+displs[r],
+                     buffer.begin()+displs[r]+counts[r]);
+    return rv;
+}
+
+/** \brief Calls \p fxn with each index in the intersection of the boxes
+ *  starting at \p lhs and \p rhs, in row-major order.
+ */
+template<size_t R, typename Fxn_t>
+void for_each_common(const uint64_t* lhs, const uint64_t* rhs, Fxn_t&& fxn)
+{
+    std::array<size_t,R> start{},end{};
+    for(size_t i=0;i<R;++i)
+    {
+        start[i]=std::max(lhs[i],rhs[i]);
+        end[i]=std::min(lhs[R+i],rhs[R+i]);
+        if(start[i]>=end[i])return;
+    }
+    const Shape<R> common(end,true,start);
+    for(auto idx=common.begin();idx!=common.end();++idx)fxn(*idx);
+}
+
+/** \brief Returns the parts of the blocks of \p mem inside the box
+ *  [\p start, \p end), with indices relative to \p start.
+ *
+ *  Used to slice a tensor by redistributing only the elements of the slice.
+ */
+template<size_t R, typename T>
+MemoryBlock<R,T> clip_blocks(const MemoryBlock<R,T>& mem,
+                             const std::array<size_t,R>& start,
+                             const std::array<size_t,R>& end)
+{
+    std::vector<uint64_t> box(start.begin(),start.end());
+    box.insert(box.end(),end.begin(),end.end());
+    const auto boxes=block_boxes(mem);
+    MemoryBlock<R,T> rv;
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        const uint64_t* block=&boxes[2*R*i];
+        std::array<size_t,R> first,last;
+        bool empty=false;
+        for(size_t j=0;j<R;++j)
+        {
+            first[j]=std::max<size_t>(block[j],start[j])-start[j];
+            last[j]=std::min<size_t>(block[R+j],end[j]);
+            last[j]=last[j]>start[j] ? last[j]-start[j] : 0;
+            empty=empty || first[j]>=last[j];
+        }
+        if(empty)continue;
+        T* buffer=rv.allocate_block(last,true,first);
+        const auto& from=mem.shape(i);
+        const auto& to=rv.shape(rv.nblocks()-1);
+        const T* old_buffer=mem.block(i);
+        for_each_common<R>(block,box.data(),
+            [&](const std::array<size_t,R>& idx){
+                std::array<size_t,R> new_idx;
+                for(size_t j=0;j<R;++j)new_idx[j]=idx[j]-start[j];
+                buffer[to.offset(new_idx)]=old_buffer[from.offset(idx)];
+        });
+    }
+    return rv;
+}
+
+/** \brief Sets the elements of \p to from those of \p from.  Collective.
+ *
+ *  \param[in] from This rank's blocks of the source tensor.
+ *  \param[in,out] to This rank's blocks of the target tensor.
+ *  \param[in] comm The ranks both tensors are distributed over.
+ *
+ *  Together the blocks of \p from (and those of \p to) must cover each
+ *  element of the tensor once, and each block must be the box of indices
+ *  between the first index of its shape and the first index plus its
+ *  dimensions.
+ */
+template<size_t R, typename T>
+void redistribute(const MemoryBlock<R,T>& from, MemoryBlock<R,T>& to,
+                  MPI_Comm comm)
+{
+    constexpr size_t box=2*R;
+    const auto from_boxes=all_boxes(block_boxes(from),comm);
+    const auto to_boxes=all_boxes(block_boxes(to),comm);
+    int me;
+    MPI_Comm_rank(comm,&me);
+    const int nprocs=static_cast<int>(from_boxes.size());
+    const auto& my_from=from_boxes[me];
+    const auto& my_to=to_boxes[me];
+
+    std::vector<T> send,recv;
+    std::vector<int> scounts(nprocs),sdispls(nprocs),rcounts(nprocs),
+                     rdispls(nprocs);
+    for(int r=0;r<nprocs;++r)
+    {
+        sdispls[r]=static_cast<int>(send.size());
+        for(size_t j=0;j<to_boxes[r].size();j+=box)
+            for(size_t i=0;i<my_from.size();i+=box)
+            {
+                const auto& shape=from.shape(i/box);
+                const T* buffer=from.block(i/box);
+                for_each_common<R>(&my_from[i],&to_boxes[r][j],
+                    [&](const std::array<size_t,R>& idx){
+                        send.push_back(buffer[shape.offset(idx)]);
+                });
+            }
+        scounts[r]=static_cast<int>(send.size())-sdispls[r];
+    }
+    MPI_Alltoall(scounts.data(),1,MPI_INT,rcounts.data(),1,MPI_INT,comm);
+    for(int r=1;r<nprocs;++r)rdispls[r]=rdispls[r-1]+rcounts[r-1];
+    recv.resize(rdispls.back()+rcounts.back());
+    MPI_Alltoallv(send.data(),scounts.data(),sdispls.data(),
+                  MPIType<T>::type(),recv.data(),rcounts.data(),
+                  rdispls.data(),MPIType<T>::type(),comm);
+
+    //Unpack in the order the senders packed
+    size_t counter=0;
+    for(int r=0;r<nprocs;++r)
+        for(size_t j=0;j<my_to.size();j+=box)
+        {
+            const auto& shape=to.shape(j/box);
+            T* buffer=to.block(j/box);
+            for(size_t i=0;i<from_boxes[r].size();i+=box)
+                for_each_common<R>(&from_boxes[r][i],&my_to[j],
+                    [&](const std::array<size_t,R>& idx){
+                        buffer[shape.offset(idx)]=recv[counter++];
+                });
+        }
+}
+
+/** \brief Returns the communicator both \p lhs and \p rhs are distributed
+ *  over.
+ *
+ *  Each backend with box blocks overloads tensor_comm(impl,t), which returns
+ *  the communicator of its tensor \p t (it is found by argument dependent
+ *  lookup).
+ *
+ *  \throws std::invalid_argument if the tensors don't span the same ranks.
+ */
+template<typename Impl1_t, typename Tensor1_t,
+         typename Impl2_t, typename Tensor2_t>
+MPI_Comm common_comm(const Impl1_t& impl, const Tensor1_t& lhs,
+                     const Impl2_t& impl2, const Tensor2_t& rhs)
+{
+    const MPI_Comm comm=tensor_comm(impl,lhs);
+    int result;
+    MPI_Comm_compare(comm,tensor_comm(impl2,rhs),&result);
+    if(result!=MPI_IDENT && result!=MPI_CONGRUENT)
+        throw std::invalid_argument("Tensors are distributed over different "
+                                    "communicators");
+    return comm;
+}
+
+/** \brief Copies between backends with box blocks by sending each element
+ *  straight to its new owner.
+ *
+ *  The exchange is over the communicator of the tensors, which must be the
+ *  same (see common_comm).
+ */
+template<TensorTypes T1, TensorTypes T2>
+struct CopyElements<T1,T2,CopyStrategy::Redistribute>{
+    template<typename Impl1_t, typename Tensor1_t,
+             typename Impl2_t, typename Tensor2_t>
+    static void eval(const Impl1_t& impl, Tensor1_t& to,
+                     const Impl2_t& impl2, Tensor2_t& from)
+    {
+        const MPI_Comm comm=common_comm(impl,to,impl2,from);
+        auto mem=local_memory(impl,to);
+        redistribute(impl2.get_memory(from),mem,comm);
+        impl.set_memory(to,mem);
+    }
+};
+
+///CTF's write sends this rank's elements of the source to their owners
+template<TensorTypes T2>
+struct CopyElements<TensorTypes::CTF,T2,CopyStrategy::WriteCTF>{
+    template<typename Impl1_t, typename Tensor1_t,
+             typename Impl2_t, typename Tensor2_t>
+    static void eval(const Impl1_t& impl, Tensor1_t& to,
+                     const Impl2_t& impl2, Tensor2_t& from)
+    {
+        impl.set_memory(to,impl2.get_memory(from));
+    }
+};
+
+///CTF's read fetches the elements of this rank's blocks of the target
+template<TensorTypes T1>
+struct CopyElements<T1,TensorTypes::CTF,CopyStrategy::ReadCTF>{
+    template<typename Impl1_t, typename Tensor1_t,
+             typename Impl2_t, typename Tensor2_t>
+    static void eval(const Impl1_t& impl, Tensor1_t& to,
+                     const Impl2_t& impl2, Tensor2_t& from)
+    {
+        auto mem=local_memory(impl,to);
+        impl2.read_memory(from,mem);
+        impl.set_memory(to,mem);
+    }
+};
+
+#endif
+}}//End namespaces
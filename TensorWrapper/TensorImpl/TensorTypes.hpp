@@ -1,4 +1,5 @@
 #pragma once
+#include "TensorWrapper/Config.hpp"
 #include <utility>
 #include <stdexcept>
 
@@ -7,10 +8,38 @@ namespace detail_{
 ///Enumerations of the tensors
 enum class TensorTypes {EigenMatrix,
                         EigenTensor,
+                        EigenSparse,
                         GlobalArrays,
                         TiledArray,
-                        CTF
+                        CTF,
+                        Distributed
 };
+
+///True if the backend keeps the entire tensor in one local, dense buffer
+constexpr bool is_local_dense(TensorTypes type)
+{
+    return type==TensorTypes::EigenMatrix || type==TensorTypes::EigenTensor;
+}
+
+///True if the backend can be evaluated on any thread of this process
+constexpr bool is_shared_memory(TensorTypes type)
+{
+    return is_local_dense(type) || type==TensorTypes::EigenSparse;
+}
+
+///True if the backend spreads the tensor over several processes
+constexpr bool is_distributed(TensorTypes type)
+{
+    return type==TensorTypes::GlobalArrays || type==TensorTypes::TiledArray ||
+           type==TensorTypes::CTF || type==TensorTypes::Distributed;
+}
+
+///True if the backend can hold a tensor of rank \p R
+constexpr bool holds_rank(TensorTypes type, size_t R)
+{
+    return type!=TensorTypes::EigenMatrix || R<=2;
+}
+
 ///Macro for calling a function with one of the TensorTypes
 #define TTGuts(name)\
     fxn_t().template eval<name>(std::forward<Args>(args)...)
@@ -35,6 +64,19 @@ decltype(TTGuts(TensorTypes::EigenMatrix))
 {
     TTEntry(TensorTypes::EigenMatrix)
     TTEntry(TensorTypes::EigenTensor)
+    TTEntry(TensorTypes::EigenSparse)
+#ifdef ENABLE_GAXX
+    TTEntry(TensorTypes::GlobalArrays)
+#endif
+#ifdef ENABLE_TILEDARRAY
+    TTEntry(TensorTypes::TiledArray)
+#endif
+#ifdef ENABLE_CTF
+    TTEntry(TensorTypes::CTF)
+#endif
+#ifdef ENABLE_DISTRIBUTED
+    TTEntry(TensorTypes::Distributed)
+#endif
     throw std::logic_error("I don't know what crazy tensor you're trying to"
                             " get, but I don't know how to make it.");
 }
@@ -2,7 +2,12 @@
 #include "TensorWrapper/Shape.hpp"
 #include "TensorWrapper/MemoryBlock.hpp"
 #include "TensorWrapper/TensorImpl/TensorTypes.hpp"
+#include "TensorWrapper/Execution.hpp"
 #include "TensorWrapper/Indices.hpp"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
 
 namespace TWrapper {
 namespace detail_ {
@@ -135,6 +140,108 @@ struct TensorWrapperImpl {
     }
 };
 
+/** \brief Returns a MemoryBlock holding every element of a tensor on every
+ *  process.
+ *
+ *  For backends whose get_memory already returns the whole tensor this is
+ *  get_memory.  Distributed backends overload this function (it is found by
+ *  argument dependent lookup) to also gather the remote elements.
+ */
+template<size_t R, typename T, TensorTypes TT, typename Tensor_t>
+MemoryBlock<R,T> gather_memory(const TensorWrapperImpl<R,T,TT>& impl,
+                               Tensor_t& t)
+{
+    return impl.get_memory(t);
+}
+
+///Adds \p x to \p *target atomically
+template<typename T>
+void atomic_add(T* target, T x)noexcept
+{
+    #pragma omp atomic
+    *target+=x;
+}
+
+///Returns the lock accumulations into the tensor at \p t serialize on
+inline std::mutex& accumulate_lock(const void* t)
+{
+    static std::array<std::mutex,64> locks;
+    const auto address=reinterpret_cast<std::uintptr_t>(t);
+    return locks[(address/64)%locks.size()];
+}
+
+/** \brief Adds the elements of \p from to the elements of \p to with the
+ *  same indices.
+ *
+ *  The elements of \p from are visited with its own iterators and offsets,
+ *  so its blocks may be of any kind; those of \p to must be the boxes their
+ *  shapes describe, as get_memory returns.  Elements of \p from outside every
+ *  block of \p to are skipped.  If \p atomic each add is atomic, so several
+ *  threads may add into the same blocks at once.
+ */
+template<size_t R, typename T>
+void add_blocks(MemoryBlock<R,T>& to, const MemoryBlock<R,T>& from,
+                bool atomic)
+{
+    //The first index of each block of to, and one past its last
+    std::vector<std::array<size_t,R>> starts(to.nblocks()),ends(to.nblocks());
+    for(size_t j=0;j<to.nblocks();++j)
+    {
+        const Shape<R>& out=to.shape(j);
+        if(!out.size())continue;
+        starts[j]=*out.begin();
+        for(size_t k=0;k<R;++k)ends[j][k]=starts[j][k]+out.dims()[k];
+    }
+    auto contains=[&](size_t j,const std::array<size_t,R>& idx){
+        for(size_t k=0;k<R;++k)
+            if(idx[k]<starts[j][k] || idx[k]>=ends[j][k])return false;
+        return true;
+    };
+    //Consecutive indices are usually in the same block of to
+    size_t j=0;
+    for(size_t i=0;i<from.nblocks();++i)
+    {
+        const T* buffer=from.block(i);
+        size_t n=0;
+        for(auto itr=from.begin(i);itr!=from.end(i);++itr,++n)
+        {
+            const auto& idx=*itr;
+            if(j>=to.nblocks() || !contains(j,idx))
+            {
+                j=0;
+                while(j<to.nblocks() && !contains(j,idx))++j;
+                if(j==to.nblocks())continue;
+            }
+            const T x=buffer[from.offset(i,n,idx)];
+            T* target=to.block(j)+to.shape(j).offset(idx);
+            if(atomic)
+                atomic_add(target,x);
+            else
+                *target+=x;
+        }
+    }
+}
+
+/** \brief Adds the elements in \p mem to those of a tensor.
+ *
+ *  Unlike set_memory, this may be called from several threads at once, so
+ *  partial contributions (*e.g.* from batches of integrals) can be added in
+ *  place.  The generic version reads the elements this process holds with
+ *  get_memory, adds the contributions to them, and writes them back with
+ *  set_memory, holding a lock striped by the tensor's address throughout.
+ *  Backends overload this function (it is found by argument dependent lookup)
+ *  to do better, and distributed backends to reach remote elements.
+ */
+template<size_t R, typename T, TensorTypes TT, typename Tensor_t>
+void accumulate_memory(const TensorWrapperImpl<R,T,TT>& impl, Tensor_t& t,
+                       const MemoryBlock<R,T>& mem)
+{
+    std::lock_guard<std::mutex> lock(accumulate_lock(&t));
+    auto local=impl.get_memory(t);
+    add_blocks(local,mem,false);
+    impl.set_memory(t,local);
+}
+
 template<typename Tensor_t>
 struct TensorWrapperImplTraits;
 
@@ -1,6 +1,10 @@
 #pragma once
-#include "TensorWrapper/TensorImpl/TensorWrapperImpl.h"
+#include "TensorWrapper/TensorImpl/TensorWrapperImpl.hpp"
+#include "TensorWrapper/TensorImpl/BlockFetcher.hpp"
+#include "TensorWrapper/TensorImpl/Redistribute.hpp"
+#include "TensorWrapper/Tiling.hpp"
 #include <tiledarray.h>
+#include <unordered_map>
 
 namespace TWrapper {
 namespace detail_ {
@@ -50,6 +54,36 @@ std::tuple<std::array<size_t,R>,
 }
 
 
+/** \brief Returns packed buffers for this rank's tiles, in the order
+ *  set_memory expects.
+ *
+ *  Overloads local_memory (see Redistribute.hpp): the tiles of a newly
+ *  allocated array have no elements, so get_memory would wait on them.
+ */
+template<size_t R, typename T, typename Tensor_t>
+MemoryBlock<R,T> local_memory(
+        const TensorWrapperImpl<R,T,TensorTypes::TiledArray>&, Tensor_t& impl)
+{
+    MemoryBlock<R,T> rv;
+    for(auto tile=impl.begin(); tile!=impl.end(); ++tile)
+    {
+        auto range=impl.trange().make_tile_range(tile.ordinal());
+        std::array<size_t,R> start,end,sizes;
+        std::tie(start,end,sizes)=TA2TW<R,T>(range);
+        std::unique_ptr<T[]> mem(new T[range.volume()]);
+        rv.add_block(std::move(mem),Shape<R>(end,true,start));
+    }
+    return rv;
+}
+
+///The communicator of a TiledArray tensor's world (see Redistribute.hpp)
+template<size_t R, typename T, typename Tensor_t>
+MPI_Comm tensor_comm(const TensorWrapperImpl<R,T,TensorTypes::TiledArray>&,
+                     const Tensor_t& t)
+{
+    return t.world().mpi.comm().Get_mpi_comm();
+}
+
 template<size_t R,typename T>
 struct TensorWrapperImpl<R,T,TensorTypes::TiledArray> {
 
@@ -72,7 +106,7 @@ struct TensorWrapperImpl<R,T,TensorTypes::TiledArray> {
         {
             auto tile=x.get();
             array_t start,end,sizes;
-            std::tie(start,end,sizes)=TA2TW<R,T>(impl.range());
+            std::tie(start,end,sizes)=TA2TW<R,T>(tile.range());
             std::unique_ptr<T[]> mem(new T[tile.size()]);
             const T* origin=&tile[0];
             std::copy(origin,origin+tile.size(),mem.get());
@@ -144,12 +178,13 @@ struct TensorWrapperImpl<R,T,TensorTypes::TiledArray> {
         return _l*c;
     }
 
+    ///The result is retiled if the expression left it tiled differently
     template<typename Idx_t,typename Op_t>
-    type eval(const Op_t& op,const array_t&)const
+    type eval(const Op_t& op,const array_t& dims)const
     {
             type c;
             c(detail_::stringify(Idx_t()))=op;
-            return c;
+            return retile(std::move(c),dims);
     }
 
     template<typename Tensor_t>
@@ -161,33 +196,124 @@ struct TensorWrapperImpl<R,T,TensorTypes::TiledArray> {
             rv+=","+std::to_string(perm[i]);
         type c;
         c(rv)=t(idx);
-        return c;
+        array_t start,end,sizes;
+        std::tie(start,end,sizes)=TA2TW<R,T>(c.elements_range());
+        return retile(std::move(c),sizes);
     }
 
+    ///Makes a tensor tiled according to the RunTime's TilingPolicy
     type allocate(const array_t& dims)const{
-        TA::World& world = TA::get_default_world();
-        std::array<TiledArray::TiledRange1,R> ranges;
-        for(size_t i=0;i<R;++i)
-            ranges[i]=TiledArray::TiledRange1(0,dims[i]);
-        TiledArray::TiledRange trange(ranges.begin(),ranges.end());
-        type rv(world,trange);
+        return allocate(dims,TA::get_default_world());
+    }
+
+    ///Makes a tensor in \p world, tiled according to the TilingPolicy
+    type allocate(const array_t& dims,TA::World& world)const{
+        type rv(world,tiled_range(dims,world));
         return rv;
     }
 
+    /** \brief Only the elements of the slice are sent, straight to their new
+     *  tiles.
+     *
+     *  The slice lives in the same world as \p impl.
+     */
     template<typename Tensor_t>
     type slice(const Tensor_t& impl,const array_t& start,
                const array_t& end)const
     {
-       auto idx=make_an_index<R>();
-       type rv;
-       rv(idx)=impl(idx).block(start,end);
-       return rv;
+        array_t new_dims;
+        for(size_t i=0;i<R;++i)
+            new_dims[i]=end[i]-start[i];
+        type rv=allocate(new_dims,impl.world());
+        auto mem=local_memory(*this,rv);
+        redistribute(clip_blocks(get_memory(impl),start,end),mem,
+                     tensor_comm(*this,impl));
+        set_memory(rv,mem);
+        return rv;
+    }
+
+    /** \brief Returns the tiling the RunTime's TilingPolicy gives a tensor
+     *  distributed over \p world.
+     */
+    static TiledArray::TiledRange tiled_range(const array_t& dims,
+        TA::World& world=TA::get_default_world())
+    {
+        const int nprocs=static_cast<int>(world.size());
+        const TilingPolicy& policy=tiling_policy();
+        std::array<TiledArray::TiledRange1,R> ranges;
+        for(size_t i=0;i<R;++i)
+        {
+            const auto bounds=policy.tile_boundaries(i,dims[i],R,nprocs);
+            ranges[i]=TiledArray::TiledRange1(bounds.begin(),bounds.end());
+        }
+        return TiledArray::TiledRange(ranges.begin(),ranges.end());
     }
 
+    ///Returns \p t, redistributed in its world if not tiled by the policy
+    type retile(type t,const array_t& dims)const
+    {
+        if(t.trange()==tiled_range(dims,t.world()))return t;
+        type rv=allocate(dims,t.world());
+        auto mem=local_memory(*this,rv);
+        redistribute(get_memory(t),mem,tensor_comm(*this,t));
+        set_memory(rv,mem);
+        return rv;
+    }
 
  };
 
+/** \brief Fetches the tiles of a TiledArray tensor.
+ *
+ *  Starting a fetch asks for the tile's future, so remote tiles are sent
+ *  while the caller works on earlier ones.  Zero tiles are skipped.
+ */
+template<size_t R, typename T>
+class BlockFetcher<R,T,TensorTypes::TiledArray>{
+public:
+    using impl_type=TensorWrapperImpl<R,T,TensorTypes::TiledArray>;
+    using tensor_type=typename impl_type::type;
+
+    BlockFetcher(const impl_type&, tensor_type& t):
+        t_(&t)
+    {
+        const auto& trange=t.trange();
+        for(size_t ord=0;ord<trange.tiles_range().volume();++ord)
+        {
+            if(t.is_zero(ord))continue;
+            std::array<size_t,R> start,end,sizes;
+            std::tie(start,end,sizes)=TA2TW<R,T>(trange.make_tile_range(ord));
+            blocks_.emplace_back(end,true,start);
+            ordinals_.push_back(ord);
+        }
+    }
+
+    ///Returns the tiles, in the order of their ordinals
+    const std::vector<Shape<R>>& blocks()const noexcept{return blocks_;}
+
+    void start(size_t i, T*)
+    {
+        pending_[i]=t_->find(ordinals_[i]);
+    }
+
+    void wait(size_t i, T* buffer)
+    {
+        auto tile=pending_[i].get();
+        const T* origin=&tile[0];
+        std::copy(origin,origin+tile.size(),buffer);
+        pending_.erase(i);
+    }
+
+private:
+    const tensor_type* t_;
+    std::vector<Shape<R>> blocks_;
 
+    ///The ordinal of each block's tile
+    std::vector<size_t> ordinals_;
+
+    ///The tiles that have been asked for but not waited on
+    std::unordered_map<size_t,
+        madness::Future<typename tensor_type::value_type>> pending_;
+};
 
 //    template<typename My_t>
 //    auto self_adjoint_eigen_solver(const My_t& tensor)const
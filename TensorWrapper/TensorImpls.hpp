@@ -8,6 +8,10 @@
 #ifdef ENABLE_EIGEN
     #include "TensorWrapper/TensorImpl/EigenMatrixWrapper.hpp"
     #include "TensorWrapper/TensorImpl/EigenTensorWrapper.hpp"
+    #include "TensorWrapper/TensorImpl/EigenSparseWrapper.hpp"
+#endif
+#ifdef ENABLE_DISTRIBUTED
+    #include "TensorWrapper/TensorImpl/DistributedWrapper.hpp"
 #endif
 #ifdef ENABLE_GAXX
     #include "TensorWrapper/TensorImpl/GATensorWrapper.hpp"
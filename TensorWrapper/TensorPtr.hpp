@@ -2,6 +2,8 @@
 #include <utility>
 #include <memory>
 #include "TensorWrapper/Operations.hpp"
+#include "TensorWrapper/CompressedBuffer.hpp"
+#include "TensorWrapper/TensorImpl/Redistribute.hpp"
 namespace TWrapper {
 namespace detail_ {
 
@@ -14,6 +16,14 @@ namespace detail_ {
  *  that this is fully type safe because you need to know the data's type to
  *  get it back.
  *
+ *  Tensors that are not going to be used for a while (*e.g.* intermediates
+ *  that are only read once per iteration) can be compressed via compress().
+ *  The backend's instance is then released and the elements are held in a
+ *  CompressedBuffer.  The next call to cast() transparently decompresses the
+ *  tensor back into the backend's format.
+ *
+ *  \note Because decompression happens in the const version of cast(), two
+ *  threads should not concurrently cast a compressed TensorPtr.
  */
 template<size_t R, typename T>
 class TensorPtr{
@@ -22,15 +32,50 @@ private:
     ///Functor for calling the conversions
     template<TensorTypes T1>
     struct Convert{
+        ///Sets every element of a freshly allocated tensor to zero
+        template<typename Impl_t, typename Tensor_t>
+        static void zero_fill(const Impl_t& impl, Tensor_t& t)
+        {
+            auto mem=impl.get_memory(t);
+            for(size_t i=0;i<mem.nblocks();++i)
+            {
+                T* buffer=mem.block(i);
+                size_t counter=0;
+                for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+                    buffer[mem.offset(i,counter++,*idx)]=T{0};
+            }
+            impl.set_memory(t,mem);
+        }
+
         template<TensorTypes T2>
         TensorPtr<R,T> eval(const TensorPtr& ptr)
-        {              
+        {
+            constexpr bool can_hold=holds_rank(T1,R) && holds_rank(T2,R);
+            return convert<T2>(ptr,std::integral_constant<bool,can_hold>());
+        }
+
+        ///A tensor of rank R is never held by a backend that can't hold it
+        template<TensorTypes T2>
+        TensorPtr<R,T> convert(const TensorPtr&, std::false_type)
+        {
+            throw std::logic_error("Backend can't hold a tensor of this rank");
+        }
+
+        template<TensorTypes T2>
+        TensorPtr<R,T> convert(const TensorPtr& ptr, std::true_type)
+        {
+            TWRAPPER_PROFILE(profile,"Convert",T1,T2);
             const auto& temp=ptr.template cast<T2>();
             TensorWrapperImpl<R,T,T1> impl;
             TensorWrapperImpl<R,T,T2> impl2;
             auto& t=const_cast<typename TensorWrapperImpl<R,T,T2>::type&>(temp);
             auto rv=impl.allocate(impl2.dims(t).dims());
-            impl.set_memory(rv,impl2.get_memory(t));
+            TWRAPPER_PROFILE_BYTES(profile,
+                                   2*tensor_bytes<T>(impl2.dims(t).dims()));
+            //Sparse tensors only hand out their nonzero elements
+            if(T2==TensorTypes::EigenSparse)
+                zero_fill(impl,rv);
+            CopyElements<T1,T2>::eval(impl,rv,impl2,t);
             return TensorPtr<R,T>(T1,std::move(rv));
         }
 
@@ -69,12 +114,58 @@ private:
 
      };
 
-    ///The actual instance is wrapped in this member
-    std::unique_ptr<Placeholder> tensor_;
+    ///The state of a compressed tensor
+    struct Compressed{
+        ///The dimensions of the tensor
+        std::array<size_t,R> dims;
+
+        ///The elements of the tensor, in row-major order
+        CompressedBuffer<T> buffer;
+    };
+
+    ///The actual instance is wrapped in this member (null if compressed)
+    mutable std::unique_ptr<Placeholder> tensor_;
 
     ///The type of the instance wrapped in \p tensor_
     TensorTypes type_;
 
+    ///The instance in its compressed form (null unless compressed)
+    mutable std::unique_ptr<Compressed> compressed_;
+
+    ///Rebuilds the backend's instance from its compressed form
+    template<TensorTypes T1>
+    void decompress()const
+    {
+        using tensor_type=typename TensorWrapperImpl<R,T,T1>::type;
+        TensorWrapperImpl<R,T,T1> impl;
+        const Shape<R> shape(compressed_->dims);
+        std::unique_ptr<T[]> buffer(new T[shape.size()]);
+        compressed_->buffer.decompress(buffer.get());
+        auto rv=impl.allocate(compressed_->dims);
+        //Sparse tensors hand out no elements until they have nonzeros
+        if(T1==TensorTypes::EigenSparse)
+        {
+            MemoryBlock<R,T> mem;
+            mem.add_block(std::move(buffer),shape);
+            impl.set_memory(rv,mem);
+        }
+        else//Only touch our own elements; distributed ones live elsewhere
+        {
+            auto mem=impl.get_memory(rv);
+            for(size_t i=0;i<mem.nblocks();++i)
+            {
+                T* block=mem.block(i);
+                size_t counter=0;
+                for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+                    block[mem.offset(i,counter++,*idx)]=
+                        buffer[shape.flat_index(*idx)];
+            }
+            impl.set_memory(rv,mem);
+        }
+        tensor_=std::make_unique<Wrapper<tensor_type>>(std::move(rv));
+        compressed_.reset();
+    }
+
 
     ///Wraps the downcast to clean the code up a bit.
     template<typename Tensor_t>
@@ -146,7 +237,9 @@ public:
     TensorPtr(const TensorPtr& other):
       tensor_(other.tensor_?
               std::move(other.tensor_->clone()):nullptr),
-      type_(other.type_)
+      type_(other.type_),
+      compressed_(other.compressed_?
+                  std::make_unique<Compressed>(*other.compressed_):nullptr)
     {
     }
 
@@ -158,8 +251,8 @@ public:
      */
     TensorPtr& operator=(const TensorPtr& other)
     {
-        tensor_=std::move(other.tensor_->clone());
-        type_=other.type_;
+        TensorPtr temp(other);
+        *this=std::move(temp);
         return *this;
     }
 
@@ -170,7 +263,8 @@ public:
      */
     TensorPtr(TensorPtr&& other)noexcept:
         tensor_(std::move(other.tensor_)),
-        type_(std::move(other.type_))
+        type_(std::move(other.type_)),
+        compressed_(std::move(other.compressed_))
    {}
 
     /** \brief Takes ownership of other TensorPtr's tensor
@@ -182,6 +276,7 @@ public:
     {
         tensor_=std::move(other.tensor_);
         type_=std::move(other.type_);
+        compressed_=std::move(other.compressed_);
         return *this;
     }
 
@@ -213,6 +308,8 @@ public:
      *   time) then you can call this function to get the tensor back in the
      *   backend's native format.
      *
+     *   If the tensor is compressed it is decompressed first.
+     *
      *   \returns The instance inside this pointer
      *
      *   \throws std::bad_cast if the tensor inside of this pointer is not of
@@ -227,6 +324,7 @@ public:
         using tensor_type=typename TensorWrapperImpl<R,T,T1>::type;
         if(T1==type_)//Was the type in here already
         {
+            if(compressed_)decompress<T1>();
             //TODO: change to static cast when I know this works
             auto tensordown=downcast<tensor_type>();
             auto rv=tensordown->tensor.get();
@@ -241,6 +339,70 @@ public:
         return apply_TensorTypes<Convert<T1>>(type_,*this);
     }
 
+    /** \brief Compresses the wrapped tensor and releases the backend's
+     *   instance.
+     *
+     *   The elements are gathered, in row-major order, via the backend's
+     *   get_memory and then compressed block-by-block.  Like cast(), the type
+     *   of the wrapped tensor must be known at compile time.  Compressing an
+     *   already compressed instance is a no-op.
+     *
+     *   \param[in] mode Whether to compress losslessly or to truncate the
+     *                   mantissas of the elements.
+     *   \param[in] tolerance The maximum relative error of each element if
+     *                        \p mode is Compression::Truncated.
+     *
+     *   \throws std::bad_cast if the tensor inside of this pointer is not of
+     *    type T1.  Strong throw guarantee.
+     *   \throws std::bad_alloc if memory allocation fails.  Strong throw
+     *    guarantee.
+     *
+     *   \tparam T1 The type of the tensor contained in this pointer.
+     */
+    template<TensorTypes T1>
+    void compress(Compression mode=Compression::Lossless,
+                  double tolerance=0.0)
+    {
+        if(compressed_)return;
+        auto& t=cast<T1>();
+        TensorWrapperImpl<R,T,T1> impl;
+        const auto dims=impl.dims(t).dims();
+        const Shape<R> shape(dims);
+        std::vector<T> elements(shape.size(),T{0});
+        auto mem=impl.get_memory(t);
+        for(size_t i=0;i<mem.nblocks();++i)
+        {
+            const T* buffer=mem.block(i);
+            size_t counter=0;
+            for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+                elements[shape.flat_index(*idx)]=
+                    buffer[mem.offset(i,counter++,*idx)];
+        }
+        compressed_=std::make_unique<Compressed>(Compressed{dims,
+            CompressedBuffer<T>(elements.data(),elements.size(),mode,tolerance)
+        });
+        tensor_.reset();
+    }
+
+    /** \brief Returns true if the wrapped tensor is currently compressed.
+     *
+     *  \throws No throw guarantee.
+     */
+    bool is_compressed()const noexcept
+    {
+        return static_cast<bool>(compressed_);
+    }
+
+    /** \brief Returns the number of bytes the compressed elements occupy, or 0
+     *  if the wrapped tensor is not compressed.
+     *
+     *  \throws No throw guarantee.
+     */
+    size_t compressed_size()const noexcept
+    {
+        return compressed_ ? compressed_->buffer.nbytes() : 0;
+    }
+
 
     /** \brief Implicit conversion to boolean representing whether or not this
      *         pointer is holding something.
@@ -251,7 +413,7 @@ public:
      */
     operator bool()const noexcept
     {
-        return static_cast<bool>(tensor_);
+        return tensor_ || compressed_;
     }
 };
 
@@ -3,6 +3,8 @@
 #include "TensorWrapper/DisableUselessWarnings.hpp"
 #include "TensorWrapper/TensorWrapperBase.hpp"
 #include "TensorWrapper/RunTime.hpp"
+#include "TensorWrapper/PivotedCholesky.hpp"
+#include "TensorWrapper/ThreadPool.hpp"
 
 /** \file This is the main include file for the TensorWrapper library it defines
  *  our public API.
@@ -58,6 +60,40 @@ private:
         return this->tensor_;
     }
 
+    /** \brief Sets every element of a newly allocated tensor to \p value.
+     *
+     *  For backends holding the tensor in a single local buffer this is where
+     *  the pages are first touched, so it follows the RunTime's allocation
+     *  policy.
+     */
+    void initialize(T value)
+    {
+        if(TT==detail_::TensorTypes::EigenSparse)//Only hands out nonzeros
+        {
+            if(value==T{0})return;
+            MemoryBlock<R,T> mem;
+            T* buffer=mem.allocate_block(shape().dims());
+            std::fill(buffer,buffer+mem.shape(0).extent(),value);
+            set_memory(mem);
+            return;
+        }
+        auto mem=get_memory();
+        if(detail_::is_local_dense(TT))//The block is the tensor's own memory
+        {
+            detail_::first_touch(mem.block(0),shape().size(),value,
+                                 RunTime::allocation_policy());
+            return;
+        }
+        for(size_t i=0;i<mem.nblocks();++i)
+        {
+            T* buffer=mem.block(i);
+            size_t counter=0;
+            for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+                buffer[mem.offset(i,counter++,*idx)]=value;
+        }
+        set_memory(mem);
+    }
+
     ///Allows us to grab the tensor pointer from other TensorWrapper instances
     template<size_t R2, typename T2, detail_::TensorTypes TT2>
     friend class TensorWrapper;
@@ -72,6 +108,9 @@ public:
     ///The type of the backend's tensor class
     using wrapped_t=typename Impl_t::type;
 
+    ///The backend this tensor is held in
+    static constexpr detail_::TensorTypes tensor_type=TT;
+
     ///The type of an R element std::array of size_t s
     using index_t=typename base_type::index_t;
 
@@ -216,17 +255,39 @@ public:
     /** \brief Constructor for allocating the memory of the tensor
      *
      *  After calling this constructor the memory is allocated, but in an
-     *  undefined initialization state.
+     *  undefined initialization state unless the RunTime's allocation policy is
+     *  not AllocationPolicy::Local, in which case the tensor is zeroed in
+     *  parallel according to the policy.
      */
     TensorWrapper(index_t dims)
     {
+        TWRAPPER_PROFILE(profile,"allocate",TT);
+        TWRAPPER_PROFILE_BYTES(profile,detail_::tensor_bytes<T>(dims));
+        ptr_()=std::move(pTensor(TT,std::move(impl_.allocate(dims))));
+        if(RunTime::allocation_policy()!=AllocationPolicy::Local)
+            initialize(T{0});
+    }
+
+    /** \brief Constructor for allocating the memory of the tensor and setting
+     *  every element to \p value.
+     *
+     *  The elements are set according to the RunTime's allocation policy.
+     */
+    TensorWrapper(index_t dims, T value)
+    {
+        TWRAPPER_PROFILE(profile,"allocate",TT);
+        TWRAPPER_PROFILE_BYTES(profile,detail_::tensor_bytes<T>(dims));
         ptr_()=std::move(pTensor(TT,std::move(impl_.allocate(dims))));
+        initialize(value);
     }
 
     template<typename RHS_t>
     TensorWrapper(const detail_::OperationBase<RHS_t>& op)
     {
+        TWRAPPER_PROFILE(profile,"Evaluate",TT);
         const RHS_t& up_op=static_cast<const RHS_t&>(op);
+        TWRAPPER_PROFILE_BYTES(profile,cost(op).bytes);
+        TWRAPPER_PROFILE_FLOPS(profile,cost(op).flops);
         wrapped_t temp_tensor=impl_.template eval<typename RHS_t::indices>(
                     up_op.template eval<TT>(),up_op.dimensions());
         ptr_()=std::move(pTensor(TT,std::move(temp_tensor)));
@@ -264,7 +325,12 @@ public:
         for(size_t i=0;i<R;++i)p1[i]=idx[i]+1;
         auto slice_of_t=impl_.slice(data(),idx,p1);
         my_type temp(std::move(slice_of_t));
-        return temp.get_memory().block(0)[0];
+        //Distributed backends may hold the element on another process
+        auto mem=gather_memory(impl_,temp.data());
+        //Sparse backends hand back no elements if the element is zero
+        const bool has_element=mem.nblocks() &&
+                               (R==0 || mem.begin(0)!=mem.end(0));
+        return has_element ? mem.block(0)[0] : T{0};
     }
 
     wrapped_t slice(const index_t& start,const index_t& end)const
@@ -281,15 +347,48 @@ public:
     ///\copydoc TensorWrapperBase<R,T>::get_memory()
     MemoryBlock<R,T> get_memory() override
     {
-        return impl_.get_memory(data());
+        TWRAPPER_PROFILE(profile,"get_memory",TT);
+        auto rv=impl_.get_memory(data());
+        TWRAPPER_PROFILE_BYTES(profile,detail_::memory_bytes<T>(rv));
+        return rv;
     }
 
     ///\copydoc TensorWrapperBase<R,T>::set_memory()
     void set_memory(const MemoryBlock<R,T>& other)override
     {
+        TWRAPPER_PROFILE(profile,"set_memory",TT);
+        TWRAPPER_PROFILE_BYTES(profile,detail_::memory_bytes<T>(other));
         impl_.set_memory(data(),other);
     }
 
+    ///\copydoc TensorWrapperBase<R,T>::accumulate_memory()
+    void accumulate_memory(const MemoryBlock<R,T>& other)override
+    {
+        detail_::accumulate_memory(impl_,data(),other);
+    }
+
+    /** \brief Compresses the tensor until it is next used.
+     *
+     *  Intended for intermediates that will sit idle for a while.  The
+     *  backend's instance is released and the next call that needs it (*e.g.*
+     *  data(), get_memory(), or use in an expression) decompresses it.
+     *
+     *  \param[in] mode Whether to compress losslessly or to truncate the
+     *                  mantissas of the elements.
+     *  \param[in] tolerance The maximum relative error of each element if
+     *                       \p mode is Compression::Truncated.
+     */
+    void compress(Compression mode=Compression::Lossless,double tolerance=0.0)
+    {
+        ptr_().template compress<TT>(mode,tolerance);
+    }
+
+    ///Returns true if the tensor is currently compressed
+    bool is_compressed()const noexcept
+    {
+        return ptr_().is_compressed();
+    }
+
     /** \brief Allows us to compare for equality against a lazy evaluation
      *  expression.
      *
@@ -342,6 +441,137 @@ self_adjoint_eigen_solver(const TensorWrapper<2,T,TT>& tensor_in)
                           TensorWrapper<2,T,TT>(std::move(rv.second)));
 }
 
+namespace detail_ {
+
+///Evaluates an expression on the shared thread pool
+template<bool shared_memory>
+struct EvalAsync{
+    template<typename Result_t,typename Op_t>
+    static std::future<Result_t> eval(const Op_t& op)
+    {
+        return thread_pool().submit([op](){return Result_t(op);});
+    }
+};
+
+///Evaluates an expression right away for backends that schedule their own
+///work or need every process to take part
+template<>
+struct EvalAsync<false>{
+    template<typename Result_t,typename Op_t>
+    static std::future<Result_t> eval(const Op_t& op)
+    {
+        std::promise<Result_t> rv;
+        try{
+            rv.set_value(Result_t(op));
+        }
+        catch(...){
+            rv.set_exception(std::current_exception());
+        }
+        return rv.get_future();
+    }
+};
+
+}//End namespace detail_
+
+/** \brief Starts evaluating a tensor expression and returns without waiting
+ *  for it to finish.
+ *
+ *  This allows independent terms to be computed at the same time:
+ *
+ *  \code
+ *  auto A1=eval_async<EigenTensor<2,double>>(u(k,c,i,d)*G(a,d,k,c));
+ *  auto B1=eval_async<EigenTensor<2,double>>(u(k,a,l,c)*G(k,i,l,c));
+ *  EigenTensor<2,double> A1v=A1.get(),B1v=B1.get();
+ *  \endcode
+ *
+ *  Backends living in this process are evaluated on the shared thread pool.
+ *  The others are evaluated before this function returns, as they either
+ *  schedule their own work already or require every process to take part in
+ *  the same order.
+ *
+ *  \note The expression only refers to its tensors, so they must outlive the
+ *  call to get() and must not be modified (or compressed) until then.
+ *
+ *  \tparam Result_t The TensorWrapper type to evaluate \p op into.
+ *  \param[in] op The expression to evaluate.
+ *  \returns A future holding the result or the exception evaluation threw.
+ */
+template<typename Result_t,typename Op_t>
+std::future<Result_t> eval_async(const detail_::OperationBase<Op_t>& op)
+{
+    using helper_t=detail_::EvalAsync<
+        detail_::is_shared_memory(Result_t::tensor_type)>;
+    return helper_t::template eval<Result_t>(static_cast<const Op_t&>(op));
+}
+
+/** \brief Computes the low-rank, pivoted Cholesky factorization of a 4-index
+ *  tensor.
+ *
+ *  Treating \p tensor_in as the positive semi-definite matrix
+ *  \f$G_{(\mu\nu),(\lambda\sigma)}\f$ the result is the rank 3 tensor
+ *  \f$L\f$ such that:
+ *  \f[
+ *      G_{\mu\nu\lambda\sigma}\approx\sum_P L_{\mu\nu P}L_{\lambda\sigma P}
+ *  \f]
+ *  Storing \f$L\f$ requires \f$O(N^3)\f$ memory instead of \f$O(N^4)\f$ and
+ *  transformations of \f$G\f$ can instead be applied to \f$L\f$, *e.g.*:
+ *  \code
+ *  auto L=cholesky_decompose(G,1.0E-8);
+ *  EigenTensor<3,double> Ltilde=X(mu,p)*Y(nu,q)*L(mu,nu,P);
+ *  EigenTensor<4,double> Gtilde=Ltilde(p,q,P)*Ltilde(r,s,P);
+ *  \endcode
+ *
+ *  \note The elements of \p tensor_in are gathered into a local buffer so
+ *  for distributed backends the entire tensor must fit on one process.
+ *
+ *  \param[in] tensor_in The tensor to decompose.
+ *  \param[in] threshold The largest allowed error in a diagonal element of
+ *                       the reconstructed tensor.
+ *  \returns The Cholesky vectors.  The last dimension is the number of
+ *           vectors needed to reach \p threshold.
+ */
+template<typename T, detail_::TensorTypes TT>
+TensorWrapper<3,T,TT>
+cholesky_decompose(const TensorWrapper<4,T,TT>& tensor_in,T threshold)
+{
+    using wrapped_t=typename TensorWrapper<4,T,TT>::wrapped_t;
+    detail_::TensorWrapperImpl<4,T,TT> impl;
+    auto& t=const_cast<wrapped_t&>(tensor_in.data());
+    const Shape<4> shape(impl.dims(t).dims());
+    const auto& dims=shape.dims();
+    const size_t n=dims[0]*dims[1];
+    if(n!=dims[2]*dims[3])
+        throw std::logic_error("Tensor is not square in its index pairs");
+
+    //Gather the elements in row-major order, i.e. as the supermatrix
+    std::vector<T> G(n*n,T{0});
+    auto mem=gather_memory(impl,t);
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        const T* buffer=mem.block(i);
+        size_t counter=0;
+        for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+            G[shape.flat_index(*idx)]=buffer[mem.offset(i,counter++,*idx)];
+    }
+
+    const auto L=detail_::pivoted_cholesky(G.data(),n,threshold);
+    TensorWrapper<3,T,TT> rv(std::array<size_t,3>{dims[0],dims[1],L.size()});
+    if(L.empty())return rv;
+    auto rv_mem=rv.get_memory();
+    for(size_t i=0;i<rv_mem.nblocks();++i)
+    {
+        T* buffer=rv_mem.block(i);
+        size_t counter=0;
+        for(auto idx=rv_mem.begin(i);idx!=rv_mem.end(i);++idx)
+        {
+            const auto& x=*idx;
+            buffer[rv_mem.offset(i,counter++,x)]=L[x[2]][x[0]*dims[1]+x[1]];
+        }
+    }
+    rv.set_memory(rv_mem);
+    return rv;
+}
+
 
 
 namespace detail_ {
@@ -378,6 +608,12 @@ using EigenMatrix=TensorWrapper<2,T,detail_::TensorTypes::EigenMatrix>;
 template<size_t rank,typename T>
 using EigenTensor=TensorWrapper<rank,T,detail_::TensorTypes::EigenTensor>;
 template<size_t rank,typename T>
+using EigenSparse=TensorWrapper<rank,T,detail_::TensorTypes::EigenSparse>;
+#ifdef ENABLE_DISTRIBUTED
+template<size_t rank,typename T>
+using Distributed=TensorWrapper<rank,T,detail_::TensorTypes::Distributed>;
+#endif
+template<size_t rank,typename T>
 using GlobalArray=TensorWrapper<rank,T,detail_::TensorTypes::GlobalArrays>;
 template<size_t rank,typename T>
 using TATensor=TensorWrapper<rank,T,detail_::TensorTypes::TiledArray>;
@@ -400,6 +636,10 @@ bool operator!=(LHS&& lhs,const TWrapper::TensorWrapper<R,T,TT>& rhs)
     return rhs!=std::forward<LHS>(lhs);
 }
 
+#include "TensorWrapper/TaskGraph.hpp"
+#include "TensorWrapper/BatchContract.hpp"
+#include "TensorWrapper/BlockStream.hpp"
+
 #ifdef BUILD_TWRAPPER_LIBRARY
 #include "TensorWrapper/TensorWrapperExtern.hpp"
 #endif
@@ -4,10 +4,14 @@
 #include<random>
 
 namespace TWrapper {
+namespace detail_ {
+struct Operands;
+}
 
 template<typename...Args>
 struct IndexHelper{
-    static constexpr bool value=detail_::AllUnique<Args...>::value;
+    static constexpr bool value=
+        detail_::nsingle<detail_::Indices<Args...>>()==sizeof...(Args);
 };
 
 /** \brief  The common base class of all the various implementations.
@@ -107,6 +111,9 @@ protected:
     //For the moment I do not want to expose the TensorPtr class
     //this allows Convert to grab it
     friend class detail_::Convert<TensorWrapperBase<R,T>>;
+
+    //Lets the TaskGraph tell tensors apart
+    friend struct detail_::Operands;
 public:
 
     ///The type of a "rank"-dimensional vector of indices
@@ -211,6 +218,19 @@ public:
 
     virtual void set_memory(const MemoryBlock<R,T>& other)=0;
 
+    /** \brief Adds the elements in \p other to the tensor's.
+     *
+     *  Unlike set_memory this may be called by several threads at once, so
+     *  contributions computed in parallel can be added in place rather than
+     *  into private copies that are reduced at the end.  For the distributed
+     *  backends that are collective (native and CTF) it is collective and
+     *  threads must take turns.  A Global Arrays slice, or a copy still
+     *  sharing its array, must first be given an array of its own by a
+     *  collective call such as set_memory.  The tensor must not be compressed
+     *  while threads accumulate into it.
+     */
+    virtual void accumulate_memory(const MemoryBlock<R,T>& other)=0;
+
 
     /** \brief Starts the lazy evaluation chain when first operation is addition
      *
@@ -294,7 +314,7 @@ TensorWrapperBase<R,T>& fill_random(TensorWrapperBase<R,T>& tensor)
              T* buffer=mem.block(i);
              while(idx!=end)
              {
-                 buffer[counter++]=dis(gen);
+                 buffer[mem.offset(i,counter++,*idx)]=dis(gen);
                  ++idx;
              }
          }
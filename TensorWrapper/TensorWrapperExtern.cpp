@@ -8,6 +8,9 @@ template class TensorWrapper<1,double,detail_::TensorTypes::EigenTensor>;
 template class TensorWrapper<2,double,detail_::TensorTypes::EigenTensor>;
 template class TensorWrapper<3,double,detail_::TensorTypes::EigenTensor>;
 template class TensorWrapper<4,double,detail_::TensorTypes::EigenTensor>;
+template class TensorWrapper<1,double,detail_::TensorTypes::EigenSparse>;
+template class TensorWrapper<2,double,detail_::TensorTypes::EigenSparse>;
+template class TensorWrapper<3,double,detail_::TensorTypes::EigenSparse>;
 
 #ifdef ENABLE_CTF
 template class TensorWrapper<1,double,detail_::TensorTypes::CTF>;
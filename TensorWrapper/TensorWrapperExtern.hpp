@@ -8,6 +8,9 @@ extern template class TensorWrapper<1,double,detail_::TensorTypes::EigenTensor>;
 extern template class TensorWrapper<2,double,detail_::TensorTypes::EigenTensor>;
 extern template class TensorWrapper<3,double,detail_::TensorTypes::EigenTensor>;
 extern template class TensorWrapper<4,double,detail_::TensorTypes::EigenTensor>;
+extern template class TensorWrapper<1,double,detail_::TensorTypes::EigenSparse>;
+extern template class TensorWrapper<2,double,detail_::TensorTypes::EigenSparse>;
+extern template class TensorWrapper<3,double,detail_::TensorTypes::EigenSparse>;
 
 #ifdef ENABLE_CTF
 extern template class TensorWrapper<1,double,detail_::TensorTypes::CTF>;
@@ -0,0 +1,104 @@
+#pragma once
+#include "TensorWrapper/Execution.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <omp.h>
+
+namespace TWrapper {
+namespace detail_ {
+
+/** \brief A fixed set of threads that run submitted tasks in the order they
+ *  were submitted.
+ *
+ *  \note A task should not wait on the future of another task; if every
+ *  thread is waiting nothing is left to run the tasks they wait on.
+ */
+class ThreadPool{
+public:
+    ///Starts \p nthreads threads (at least one)
+    explicit ThreadPool(size_t nthreads)
+    {
+        nthreads=std::max<size_t>(1,nthreads);
+        for(size_t i=0;i<nthreads;++i)
+            threads_.emplace_back([this](){work();});
+    }
+
+    ThreadPool(const ThreadPool&)=delete;
+    ThreadPool& operator=(const ThreadPool&)=delete;
+
+    ///Runs the remaining tasks and then joins the threads
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_=true;
+        }
+        ready_.notify_all();
+        for(auto& x: threads_)x.join();
+    }
+
+    ///Returns the number of threads
+    size_t size()const noexcept{return threads_.size();}
+
+    /** \brief Queues \p fxn to be run by the next free thread.
+     *
+     *  \returns A future holding what \p fxn returns (or throws).
+     */
+    template<typename Fxn_t>
+    auto submit(Fxn_t&& fxn)
+    {
+        using result_t=decltype(fxn());
+        auto task=std::make_shared<std::packaged_task<result_t()>>(
+                    std::forward<Fxn_t>(fxn));
+        auto rv=task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([task](){(*task)();});
+        }
+        ready_.notify_one();
+        return rv;
+    }
+
+private:
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stop_=false;
+
+    void work()
+    {
+        while(true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock,[this](){return stop_ || !tasks_.empty();});
+                if(tasks_.empty())return;
+                task=std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/** \brief The pool shared by every asynchronous evaluation.
+ *
+ *  It has one thread per thread of the rank (see RunTime) and is started on
+ *  first use.
+ */
+inline ThreadPool& thread_pool()
+{
+    static ThreadPool pool(execution().nthreads);
+    return pool;
+}
+
+}}//End namespaces
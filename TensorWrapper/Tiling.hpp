@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+/** \file Contains the policy the blocked backends (currently TiledArray) use
+ *  to cut new tensors into tiles.
+ */
+
+namespace TWrapper {
+
+/** \brief Says where the tile boundaries of each mode of a new tensor go.
+ *
+ *  Tiles are what blocked backends spread over the ranks and work on in
+ *  parallel, so a tensor with a single tile is held by one rank and worked on
+ *  by one thread.  A policy is made with one of the static member functions
+ *  and is set process-wide with RunTime::set_tiling_policy.
+ */
+class TilingPolicy {
+public:
+    ///The ways tile boundaries can be chosen
+    enum class Kind {
+        Single,      //!< One tile per mode (the default)
+        FixedSize,   //!< Tiles of a given extent; the last may be smaller
+        TilesPerRank,//!< About a given number of tiles for each rank
+        Boundaries   //!< Boundaries given by the user
+    };
+
+    ///One tile per mode
+    static TilingPolicy single()
+    {
+        return TilingPolicy(Kind::Single,0);
+    }
+
+    /** \brief Tiles with \p tile_size indices along each mode.
+     *
+     *  \throws std::invalid_argument if \p tile_size is 0.
+     */
+    static TilingPolicy fixed_size(size_t tile_size)
+    {
+        if(!tile_size)
+            throw std::invalid_argument("Tile size must be positive");
+        return TilingPolicy(Kind::FixedSize,tile_size);
+    }
+
+    /** \brief About \p ntiles tiles per rank, shared evenly by the modes.
+     *
+     *  A rank R tensor spread over P ranks gets the R-th root of
+     *  \p ntiles times P tiles along each mode (at most one per index), all of
+     *  about the same extent.
+     *
+     *  \throws std::invalid_argument if \p ntiles is 0.
+     */
+    static TilingPolicy tiles_per_rank(size_t ntiles)
+    {
+        if(!ntiles)
+            throw std::invalid_argument("Number of tiles must be positive");
+        return TilingPolicy(Kind::TilesPerRank,ntiles);
+    }
+
+    /** \brief Tiles starting at the given indices.
+     *
+     *  \param[in] bounds The boundaries of each mode, starting with 0 and
+     *             increasing.  Mode i uses bounds[i], or the last entry if
+     *             there are fewer entries than modes.  Boundaries at or past
+     *             the extent of a mode are ignored, so the same boundaries can
+     *             be used for tensors of different sizes.
+     *  \throws std::invalid_argument if \p bounds is empty or an entry does
+     *          not start with 0 and increase.
+     */
+    static TilingPolicy boundaries(std::vector<std::vector<size_t>> bounds)
+    {
+        if(bounds.empty())
+            throw std::invalid_argument("No tile boundaries given");
+        for(const auto& mode : bounds)
+            if(mode.empty() || mode[0] ||
+               std::adjacent_find(mode.begin(),mode.end(),
+                                  std::greater_equal<size_t>())!=mode.end())
+                throw std::invalid_argument(
+                    "Tile boundaries must start at 0 and increase");
+        TilingPolicy rv(Kind::Boundaries,0);
+        rv.bounds_=std::move(bounds);
+        return rv;
+    }
+
+    ///Returns how this policy places boundaries
+    Kind kind()const noexcept{return kind_;}
+
+    /** \brief Returns the boundaries of a mode, starting with 0 and ending
+     *  with \p extent.
+     *
+     *  \param[in] mode Which mode of the tensor.
+     *  \param[in] extent The number of indices along the mode.
+     *  \param[in] rank The number of modes of the tensor.
+     *  \param[in] nprocs The number of ranks the tensor is spread over.
+     */
+    std::vector<size_t> tile_boundaries(size_t mode, size_t extent,
+                                        size_t rank, size_t nprocs)const
+    {
+        std::vector<size_t> rv(1,0);
+        switch(kind_)
+        {
+            case Kind::Single:
+                break;
+            case Kind::FixedSize:
+            {
+                for(size_t i=size_;i<extent;i+=size_)rv.push_back(i);
+                break;
+            }
+            case Kind::TilesPerRank:
+            {
+                const double total=static_cast<double>(size_*nprocs);
+                const double per_mode=
+                        std::pow(total,1.0/std::max<size_t>(1,rank));
+                //Keeps exact roots (e.g. 4^(1/2)) from rounding up
+                const size_t wanted=
+                        static_cast<size_t>(std::ceil(per_mode-1E-9));
+                const size_t ntiles=std::min(extent,std::max<size_t>(1,wanted));
+                //The first extent%ntiles tiles get one more index
+                for(size_t i=1;i<ntiles;++i)
+                    rv.push_back(i*(extent/ntiles)+std::min(i,extent%ntiles));
+                break;
+            }
+            case Kind::Boundaries:
+            {
+                const auto& mine=bounds_[std::min(mode,bounds_.size()-1)];
+                for(size_t i=1;i<mine.size() && mine[i]<extent;++i)
+                    rv.push_back(mine[i]);
+                break;
+            }
+        }
+        if(extent)rv.push_back(extent);
+        return rv;
+    }
+
+private:
+    TilingPolicy(Kind kind, size_t size):kind_(kind),size_(size){}
+
+    ///How boundaries are placed
+    Kind kind_;
+
+    ///The tile size, or number of tiles per rank
+    size_t size_;
+
+    ///The user's boundaries, if kind_ is Kind::Boundaries
+    std::vector<std::vector<size_t>> bounds_;
+};
+
+namespace detail_ {
+
+///Returns the process-wide tiling policy (set via RunTime)
+inline TilingPolicy& tiling_policy()
+{
+    static TilingPolicy policy=TilingPolicy::single();
+    return policy;
+}
+
+}}//End namespaces
@@ -0,0 +1,594 @@
+#pragma once
+#include <TensorWrapper/PerfCounters.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+/** \file Contains the machinery the benchmarks use to time operations,
+ *  record the timings as JSON, and compare them with a stored baseline.
+ *
+ *  A benchmark program makes a Benchmark from its command line and hands it
+ *  each case (an operation on a backend at a size) to time:
+ *
+ *  \code
+ *  Benchmark bench("Eigen operations",argc,argv);
+ *  for(size_t n : bench.options().sizes)
+ *      bench.run("A+B+C","EigenMatrix",n,[&](){D=A+B+C;});
+ *  return bench.finish();
+ *  \endcode
+ *
+ *  Each case is run options().warmup times untimed and then
+ *  options().repetitions times timed.  finish() prints a table, writes the
+ *  JSON file if one was asked for, and, given a baseline, returns the number
+ *  of cases whose median time grew by more than the threshold.  Cases given
+ *  the bytes they move also report their bandwidth, and every case records
+ *  the peak resident memory of the process while it ran.  Hardware events
+ *  asked for with `--counters` are counted on the calling thread (see
+ *  PerfCounters.hpp) and reported per run; events that can't be counted are
+ *  dropped with a note.  The options understood are:
+ *
+ *  - `--sizes 64,128,256` the sizes to sweep
+ *  - `--warmup N` untimed runs of each case (default 1)
+ *  - `--reps N` timed runs of each case (default 5)
+ *  - `--filter text` only run cases whose name contains text
+ *  - `--output file` where to write the results as JSON
+ *  - `--baseline file` results (from `--output`) to compare against
+ *  - `--threshold x` the allowed slow down, 0.1 being 10% (default 0.1)
+ *  - `--counters cycles,instructions` hardware events to count (names as in
+ *    perf(1), see perf_event_name)
+ */
+
+///Summary statistics of a set of timings, in seconds
+struct BenchmarkStats{
+    size_t n=0;
+    double min=0.0;
+    double max=0.0;
+    double mean=0.0;
+    double median=0.0;
+    double stddev=0.0;//!< Sample standard deviation (0 for one timing)
+
+    BenchmarkStats()=default;
+
+    explicit BenchmarkStats(std::vector<double> times):
+        n(times.size())
+    {
+        if(!n)return;
+        std::sort(times.begin(),times.end());
+        min=times.front();
+        max=times.back();
+        median=n%2 ? times[n/2] : (times[n/2-1]+times[n/2])/2.0;
+        for(double t : times)mean+=t;
+        mean/=n;
+        for(double t : times)stddev+=(t-mean)*(t-mean);
+        stddev=n>1 ? std::sqrt(stddev/(n-1)) : 0.0;
+    }
+};
+
+///The timings of one case
+struct BenchmarkResult{
+    std::string name;   //!< The operation, e.g. "A+B+C"
+    std::string backend;//!< What ran it, e.g. "EigenMatrix"
+    size_t size=0;      //!< The size swept over, e.g. the extent of each mode
+    std::vector<double> times;//!< The timed runs, in seconds
+    BenchmarkStats stats;
+    double bytes=0.0;      //!< Bytes read and written by one run (0 if unknown)
+    size_t peak_memory=0;  //!< Peak resident memory while it ran, in bytes
+    ///Hardware event counts of one run, by event name (see --counters)
+    std::map<std::string,double> counters;
+
+    ///The string identifying this case in a baseline
+    std::string key()const
+    {
+        return name+"/"+backend+"/"+std::to_string(size);
+    }
+
+    ///The bandwidth of the median run, in GB/s (0 if bytes is unknown)
+    double bandwidth()const noexcept
+    {
+        return stats.median>0.0 ? bytes/stats.median*1E-9 : 0.0;
+    }
+};
+
+///The command line options of a benchmark (see BenchmarkHelpers.hpp)
+struct BenchmarkOptions{
+    std::vector<size_t> sizes;
+    size_t warmup=1;
+    size_t repetitions=5;
+    std::string filter;
+    std::string output;
+    std::string baseline;
+    double threshold=0.1;
+    std::vector<TWrapper::PerfEvent> counters;
+
+    /** \brief Reads the options from the command line.
+     *
+     *  \param[in] default_sizes The sizes used if `--sizes` isn't given.
+     *  \throws std::invalid_argument if an option is unknown or lacks a value.
+     */
+    BenchmarkOptions(int argc, char** argv,
+                     std::vector<size_t> default_sizes={10}):
+        sizes(std::move(default_sizes))
+    {
+        for(int i=1;i<argc;++i)
+        {
+            const std::string opt(argv[i]);
+            if(i+1>=argc)
+                throw std::invalid_argument("Option "+opt+" needs a value");
+            const std::string value(argv[++i]);
+            if(opt=="--sizes")
+            {
+                sizes.clear();
+                std::stringstream ss(value);
+                std::string size;
+                while(std::getline(ss,size,','))
+                    sizes.push_back(std::stoul(size));
+            }
+            else if(opt=="--warmup")warmup=std::stoul(value);
+            else if(opt=="--reps")
+                repetitions=std::max<size_t>(1,std::stoul(value));
+            else if(opt=="--filter")filter=value;
+            else if(opt=="--output")output=value;
+            else if(opt=="--baseline")baseline=value;
+            else if(opt=="--threshold")threshold=std::stod(value);
+            else if(opt=="--counters")
+                counters=TWrapper::detail_::parse_perf_events(value);
+            else throw std::invalid_argument("Unknown option "+opt);
+        }
+    }
+};
+
+namespace bench_detail {
+
+///Escapes the characters JSON strings can't hold as they are
+inline std::string json_escape(const std::string& str)
+{
+    std::string rv;
+    for(char c : str)
+    {
+        if(c=='"' || c=='\\')rv+='\\';
+        rv+=c;
+    }
+    return rv;
+}
+
+/** \brief A JSON value, as much of one as is needed to read back the files
+ *  write_json makes.
+ */
+struct JSONValue{
+    enum class Type{Null,Bool,Number,String,Array,Object};
+    Type type=Type::Null;
+    bool boolean=false;
+    double number=0.0;
+    std::string string;
+    std::vector<JSONValue> array;
+    std::map<std::string,JSONValue> object;
+
+    ///Returns the member \p name of an object, throwing if there isn't one
+    const JSONValue& operator[](const std::string& name)const
+    {
+        auto itr=object.find(name);
+        if(type!=Type::Object || itr==object.end())
+            throw std::runtime_error("JSON value has no member "+name);
+        return itr->second;
+    }
+};
+
+///Reads JSON text into JSONValue instances
+class JSONParser{
+public:
+    explicit JSONParser(std::string text):text_(std::move(text)){}
+
+    ///Parses the text, which must hold exactly one value
+    JSONValue parse()
+    {
+        JSONValue rv=value();
+        skip();
+        if(pos_!=text_.size())error("trailing characters");
+        return rv;
+    }
+private:
+    std::string text_;
+    size_t pos_=0;
+
+    [[noreturn]] void error(const std::string& msg)const
+    {
+        throw std::runtime_error("Bad JSON at character "+
+                                 std::to_string(pos_)+": "+msg);
+    }
+
+    void skip()
+    {
+        while(pos_<text_.size() && std::isspace(text_[pos_]))++pos_;
+    }
+
+    char peek()
+    {
+        skip();
+        if(pos_==text_.size())error("unexpected end");
+        return text_[pos_];
+    }
+
+    void expect(char c)
+    {
+        if(peek()!=c)error(std::string("expected ")+c);
+        ++pos_;
+    }
+
+    bool literal(const std::string& word)
+    {
+        if(text_.compare(pos_,word.size(),word))return false;
+        pos_+=word.size();
+        return true;
+    }
+
+    std::string string()
+    {
+        expect('"');
+        std::string rv;
+        while(pos_<text_.size() && text_[pos_]!='"')
+        {
+            if(text_[pos_]=='\\' && ++pos_==text_.size())break;
+            rv+=text_[pos_++];
+        }
+        if(pos_==text_.size())error("unterminated string");
+        ++pos_;
+        return rv;
+    }
+
+    JSONValue value()
+    {
+        JSONValue rv;
+        const char c=peek();
+        if(c=='{')
+        {
+            rv.type=JSONValue::Type::Object;
+            ++pos_;
+            if(peek()=='}'){++pos_;return rv;}
+            do{
+                std::string name=string();
+                expect(':');
+                rv.object[name]=value();
+            }while(peek()==',' && ++pos_);
+            expect('}');
+        }
+        else if(c=='[')
+        {
+            rv.type=JSONValue::Type::Array;
+            ++pos_;
+            if(peek()==']'){++pos_;return rv;}
+            do{
+                rv.array.push_back(value());
+            }while(peek()==',' && ++pos_);
+            expect(']');
+        }
+        else if(c=='"')
+        {
+            rv.type=JSONValue::Type::String;
+            rv.string=string();
+        }
+        else if(literal("true") || literal("false"))
+        {
+            rv.type=JSONValue::Type::Bool;
+            rv.boolean=(text_[pos_-4]=='t');
+        }
+        else if(literal("null"))
+            rv.type=JSONValue::Type::Null;
+        else
+        {
+            const char* begin=text_.c_str()+pos_;
+            char* end;
+            rv.type=JSONValue::Type::Number;
+            rv.number=std::strtod(begin,&end);
+            if(end==begin)error("unexpected character");
+            pos_+=end-begin;
+        }
+        return rv;
+    }
+};
+
+/** \brief Resets the peak resident memory of the process to its current
+ *  resident memory.
+ *
+ *  Only Linux can do this; elsewhere peak_memory() keeps the peak of the
+ *  whole run.
+ */
+inline void reset_peak_memory()
+{
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs")<<"5";
+#endif
+}
+
+///The peak resident memory of the process, in bytes
+inline size_t peak_memory()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status,line))
+        if(line.compare(0,6,"VmHWM:")==0)
+            return std::stoul(line.substr(6))*1024;//Given in kB
+#endif
+    rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss*1024;
+#endif
+}
+
+}//End namespace bench_detail
+
+///The dimensions of a rank R tensor with about \p n elements
+template<size_t R>
+std::array<size_t,R> make_dims(size_t n)
+{
+    std::array<size_t,R> dims;
+    const double extent=std::round(std::pow(n,1.0/R));
+    dims.fill(std::max<size_t>(1,static_cast<size_t>(extent)));
+    return dims;
+}
+
+///Writes \p results as JSON (the format read_json reads)
+inline void write_json(std::ostream& os,
+                       const std::vector<BenchmarkResult>& results,
+                       const std::map<std::string,std::string>& context={})
+{
+    using bench_detail::json_escape;
+    os<<std::setprecision(9)<<"{\n  \"context\": {";
+    std::string sep="\n";
+    for(const auto& entry : context)
+    {
+        os<<sep<<"    \""<<json_escape(entry.first)<<"\": \""
+          <<json_escape(entry.second)<<"\"";
+        sep=",\n";
+    }
+    os<<"\n  },\n  \"results\": [";
+    sep="\n";
+    for(const auto& result : results)
+    {
+        const auto& s=result.stats;
+        os<<sep<<"    {\"name\": \""<<json_escape(result.name)<<"\", "
+          <<"\"backend\": \""<<json_escape(result.backend)<<"\", "
+          <<"\"size\": "<<result.size<<",\n     "
+          <<"\"min\": "<<s.min<<", \"max\": "<<s.max<<", \"mean\": "<<s.mean
+          <<", \"median\": "<<s.median<<", \"stddev\": "<<s.stddev
+          <<",\n     \"bytes\": "<<result.bytes<<", \"peak_memory\": "
+          <<result.peak_memory<<",\n     \"counters\": {";
+        std::string csep;
+        for(const auto& count : result.counters)
+        {
+            os<<csep<<"\""<<json_escape(count.first)<<"\": "<<count.second;
+            csep=", ";
+        }
+        os<<"},\n     \"times\": [";
+        for(size_t i=0;i<result.times.size();++i)
+            os<<(i ? ", " : "")<<result.times[i];
+        os<<"]}";
+        sep=",\n";
+    }
+    os<<"\n  ]\n}\n";
+}
+
+/** \brief Reads results written by write_json.
+ *
+ *  \throws std::runtime_error if the text isn't JSON in that format.
+ */
+inline std::vector<BenchmarkResult> read_json(std::istream& is)
+{
+    std::stringstream ss;
+    ss<<is.rdbuf();
+    const auto root=bench_detail::JSONParser(ss.str()).parse();
+    std::vector<BenchmarkResult> rv;
+    for(const auto& entry : root["results"].array)
+    {
+        BenchmarkResult result;
+        result.name=entry["name"].string;
+        result.backend=entry["backend"].string;
+        result.size=static_cast<size_t>(entry["size"].number);
+        for(const auto& t : entry["times"].array)
+            result.times.push_back(t.number);
+        //Results written before these were recorded lack them
+        if(entry.object.count("bytes"))result.bytes=entry["bytes"].number;
+        if(entry.object.count("peak_memory"))
+            result.peak_memory=
+                static_cast<size_t>(entry["peak_memory"].number);
+        if(entry.object.count("counters"))
+            for(const auto& count : entry["counters"].object)
+                result.counters[count.first]=count.second.number;
+        result.stats=BenchmarkStats(result.times);
+        rv.push_back(std::move(result));
+    }
+    return rv;
+}
+
+///How a case's median time compares with the baseline's
+struct BenchmarkComparison{
+    std::string key;
+    double baseline=0.0;//!< The baseline's median time
+    double current=0.0; //!< This run's median time
+    double change=0.0;  //!< current/baseline-1, so 0.1 is 10% slower
+
+    bool is_regression(double threshold)const{return change>threshold;}
+};
+
+///Compares the cases of \p current that are also in \p baseline
+inline std::vector<BenchmarkComparison>
+compare(const std::vector<BenchmarkResult>& current,
+        const std::vector<BenchmarkResult>& baseline)
+{
+    std::map<std::string,const BenchmarkResult*> old;
+    for(const auto& result : baseline)old[result.key()]=&result;
+    std::vector<BenchmarkComparison> rv;
+    for(const auto& result : current)
+    {
+        auto itr=old.find(result.key());
+        if(itr==old.end())continue;
+        BenchmarkComparison cmp;
+        cmp.key=result.key();
+        cmp.baseline=itr->second->stats.median;
+        cmp.current=result.stats.median;
+        cmp.change=cmp.baseline>0.0 ? cmp.current/cmp.baseline-1.0 : 0.0;
+        rv.push_back(cmp);
+    }
+    return rv;
+}
+
+/** \brief Runs and records the cases of a benchmark program.
+ *
+ *  If \p report is false (e.g. on all but one MPI rank) the cases are still
+ *  run, so collective operations line up, but nothing is printed or written.
+ */
+class Benchmark{
+public:
+    using clock_t=std::chrono::steady_clock;
+
+    Benchmark(const std::string& title, int argc, char** argv,
+              std::vector<size_t> default_sizes={10}, bool report=true):
+        options_(argc,argv,std::move(default_sizes)),
+        report_(report)
+    {
+        if(report_)
+            std::cout<<std::string(80,'=')<<std::endl<<title<<std::endl
+                     <<std::string(80,'=')<<std::endl;
+        if(options_.counters.empty())return;
+        counters_.reset(new TWrapper::detail_::PerfCounters(options_.counters));
+        std::string names;
+        for(auto event : counters_->events())
+            names+=(names.empty() ? "" : ",")+
+                   std::string(TWrapper::detail_::perf_event_name(event));
+        add_context("counters",names);
+        if(report_ && counters_->events().size()!=options_.counters.size())
+            std::cout<<"Only these hardware events can be counted: "
+                     <<(names.empty() ? "none" : names)<<std::endl;
+    }
+
+    const BenchmarkOptions& options()const noexcept{return options_;}
+
+    const std::vector<BenchmarkResult>& results()const noexcept
+    {
+        return results_;
+    }
+
+    ///Adds \p value to the context written with the results (e.g. threads)
+    void add_context(const std::string& name, const std::string& value)
+    {
+        context_[name]=value;
+    }
+
+    /** \brief Times \p fxn, unless the filter excludes \p name.
+     *
+     *  \p fxn is called warmup+repetitions times and should do the same work
+     *  each time.  If \p bytes, the bytes one call reads and writes, is given
+     *  the bandwidth is reported too.
+     */
+    void run(const std::string& name, const std::string& backend, size_t size,
+             const std::function<void()>& fxn, double bytes=0.0)
+    {
+        if(name.find(options_.filter)==std::string::npos)return;
+        bench_detail::reset_peak_memory();
+        for(size_t i=0;i<options_.warmup;++i)fxn();
+        BenchmarkResult result;
+        result.name=name;
+        result.backend=backend;
+        result.size=size;
+        result.bytes=bytes;
+        const auto start_counts=read_counters();
+        for(size_t i=0;i<options_.repetitions;++i)
+        {
+            const auto start=clock_t::now();
+            fxn();
+            const std::chrono::duration<double> time=clock_t::now()-start;
+            result.times.push_back(time.count());
+        }
+        const auto counts=read_counters();
+        for(size_t i=0;i<counts.size() && i<start_counts.size();++i)
+            result.counters[TWrapper::detail_::perf_event_name(
+                counters_->events()[i])]=
+                (counts[i]-start_counts[i])/options_.repetitions;
+        result.stats=BenchmarkStats(result.times);
+        result.peak_memory=bench_detail::peak_memory();
+        if(report_)print(result);
+        results_.push_back(std::move(result));
+    }
+
+    /** \brief Writes the results and compares them with the baseline.
+     *
+     *  \returns The number of regressions (for use as the exit code).
+     */
+    int finish()const
+    {
+        if(!report_)return 0;
+        if(!options_.output.empty())
+        {
+            std::ofstream file(options_.output);
+            write_json(file,results_,context_);
+            std::cout<<"Results written to "<<options_.output<<std::endl;
+        }
+        if(options_.baseline.empty())return 0;
+        std::ifstream file(options_.baseline);
+        if(!file)
+        {
+            std::cout<<"Can't open baseline "<<options_.baseline<<std::endl;
+            return 1;
+        }
+        int nregressions=0;
+        for(const auto& cmp : compare(results_,read_json(file)))
+        {
+            const bool slower=cmp.is_regression(options_.threshold);
+            nregressions+=slower;
+            std::ostringstream line;
+            line<<std::left<<std::setw(40)<<cmp.key<<std::right<<std::showpos
+                <<std::fixed<<std::setprecision(1)<<std::setw(8)
+                <<100.0*cmp.change<<"%"<<(slower ? "  REGRESSION" : "");
+            std::cout<<line.str()<<std::endl;
+        }
+        std::cout<<nregressions<<" regressions beyond "
+                 <<100.0*options_.threshold<<"%"<<std::endl;
+        return nregressions;
+    }
+
+private:
+    BenchmarkOptions options_;
+    bool report_;
+    std::vector<BenchmarkResult> results_;
+    std::map<std::string,std::string> context_;
+    std::unique_ptr<TWrapper::detail_::PerfCounters> counters_;
+
+    std::vector<double> read_counters()const
+    {
+        return counters_ ? counters_->read() : std::vector<double>();
+    }
+
+    static void print(const BenchmarkResult& result)
+    {
+        const auto& s=result.stats;
+        std::ostringstream line;
+        line<<std::left<<std::setw(40)<<result.key()<<std::right
+            <<std::scientific<<std::setprecision(3)<<" median "<<s.median
+            <<" s  min "<<s.min<<" s  stddev "<<s.stddev<<" s";
+        if(result.bytes>0.0)
+            line<<std::fixed<<std::setprecision(2)<<"  "<<result.bandwidth()
+                <<" GB/s";
+        line<<"  peak "<<result.peak_memory/1048576<<" MB";
+        line<<std::scientific<<std::setprecision(3);
+        for(const auto& count : result.counters)
+            line<<"  "<<count.first<<" "<<count.second;
+        std::cout<<line.str()<<std::endl;
+    }
+};
@@ -0,0 +1,68 @@
+#include "BenchmarkHelpers.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sys/resource.h>
+
+/** \file Times how long the compiler takes on CCSD.cpp, whose terms
+ *  instantiate most of the index and expression templates, and records the
+ *  compiler's peak memory in the context of the results.
+ *
+ *  The compile command is the one CMake uses, read from the
+ *  compile_commands.json of the build (COMPILE_COMMANDS).  Use `--filter` to
+ *  time another source file of the tests instead.
+ */
+
+using namespace bench_detail;
+
+//The peak resident memory, in MB, of the children that have finished
+double compiler_peak_memory()
+{
+    rusage usage;
+    getrusage(RUSAGE_CHILDREN,&usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss/1048576.0;//Bytes
+#else
+    return usage.ru_maxrss/1024.0;//KB
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark bench("Benchmarking the compile time of the tests",argc,argv,
+                    {1});
+    const std::string file=bench.options().filter.empty() ?
+                           "CCSD.cpp" : bench.options().filter;
+    std::ifstream commands(COMPILE_COMMANDS);
+    if(!commands)
+    {
+        std::cout<<"Can't open "<<COMPILE_COMMANDS<<std::endl;
+        return 1;
+    }
+    std::stringstream ss;
+    ss<<commands.rdbuf();
+    for(const auto& entry : JSONParser(ss.str()).parse().array)
+    {
+        const std::string& path=entry["file"].string;
+        if(path.size()<file.size()+1 ||
+           path.compare(path.size()-file.size(),file.size(),file)!=0 ||
+           path[path.size()-file.size()-1]!='/')continue;
+        const std::string command="cd \""+entry["directory"].string+"\" && "+
+                                  entry["command"].string;
+        bool failed=false;
+        bench.run(file,"compiler",1,[&](){
+            failed=failed || std::system(command.c_str())!=0;
+        });
+        if(failed)
+        {
+            std::cout<<"Compiling "<<path<<" failed"<<std::endl;
+            return 1;
+        }
+        std::ostringstream memory;
+        memory<<compiler_peak_memory();
+        bench.add_context("peak memory (MB)",memory.str());
+        std::cout<<"Peak memory: "<<memory.str()<<" MB"<<std::endl;
+        return bench.finish();
+    }
+    std::cout<<"No compile command for "<<file<<std::endl;
+    return 1;
+}
@@ -0,0 +1,106 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "BenchmarkHelpers.hpp"
+
+/** \file Times converting a tensor from each enabled backend to each other
+ *  one (what happens implicitly when tensors of two backends meet), for
+ *  tensors of rank 1 to 4.  Each size given with `--sizes` is the number of
+ *  elements of the tensor, whose modes all have (about) the same extent.  The
+ *  bandwidth counts every element as read once and written once.
+ *
+ *  Run it under mpiexec to include the distributed backends; the bandwidth is
+ *  then that of all ranks together.  See BenchmarkHelpers.hpp for the
+ *  options.
+ */
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+//Times converting a rank R tensor of backend From to backend To
+template<size_t R, TensorTypes From, TensorTypes To>
+void bench_pair(Benchmark& bench, size_t n, std::true_type)
+{
+    if(From==To)return;
+    const auto dims=make_dims<R>(n);
+    const TensorWrapper<R,double,From> A(dims,1.0);
+    TensorWrapper<R,double,To> B;
+    const double bytes=2.0*tensor_bytes<double>(dims);
+    bench.run("rank "+std::to_string(R),
+              std::string(backend_name(From))+"->"+backend_name(To),n,
+              [&](){B=A;},bytes);
+}
+
+//One of the backends can't hold a rank R tensor (e.g. EigenMatrix)
+template<size_t R, TensorTypes From, TensorTypes To>
+void bench_pair(Benchmark&, size_t, std::false_type)
+{}
+
+template<size_t R, TensorTypes From, TensorTypes To>
+void bench_pair(Benchmark& bench, size_t n)
+{
+    constexpr bool can_hold=holds_rank(From,R) && holds_rank(To,R);
+    bench_pair<R,From,To>(bench,n,std::integral_constant<bool,can_hold>());
+}
+
+//Times converting from backend From to each enabled backend
+template<size_t R, TensorTypes From>
+void bench_from(Benchmark& bench, size_t n)
+{
+    bench_pair<R,From,TensorTypes::EigenMatrix>(bench,n);
+    bench_pair<R,From,TensorTypes::EigenTensor>(bench,n);
+    bench_pair<R,From,TensorTypes::EigenSparse>(bench,n);
+#ifdef ENABLE_GAXX
+    bench_pair<R,From,TensorTypes::GlobalArrays>(bench,n);
+#endif
+#ifdef ENABLE_TILEDARRAY
+    bench_pair<R,From,TensorTypes::TiledArray>(bench,n);
+#endif
+#ifdef ENABLE_CTF
+    bench_pair<R,From,TensorTypes::CTF>(bench,n);
+#endif
+#ifdef ENABLE_DISTRIBUTED
+    bench_pair<R,From,TensorTypes::Distributed>(bench,n);
+#endif
+}
+
+//Times every pair of enabled backends for rank R tensors
+template<size_t R>
+void bench_rank(Benchmark& bench, size_t n)
+{
+    bench_from<R,TensorTypes::EigenMatrix>(bench,n);
+    bench_from<R,TensorTypes::EigenTensor>(bench,n);
+    bench_from<R,TensorTypes::EigenSparse>(bench,n);
+#ifdef ENABLE_GAXX
+    bench_from<R,TensorTypes::GlobalArrays>(bench,n);
+#endif
+#ifdef ENABLE_TILEDARRAY
+    bench_from<R,TensorTypes::TiledArray>(bench,n);
+#endif
+#ifdef ENABLE_CTF
+    bench_from<R,TensorTypes::CTF>(bench,n);
+#endif
+#ifdef ENABLE_DISTRIBUTED
+    bench_from<R,TensorTypes::Distributed>(bench,n);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    RunTime rt(argc,argv);
+    int me=0,nprocs=1;
+#ifdef ENABLE_DISTRIBUTED
+    MPI_Comm_rank(MPI_COMM_WORLD,&me);
+    MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+#endif
+    Benchmark bench("Benchmarking conversions between backends",argc,argv,
+                    {4096},!me);
+    bench.add_context("threads",std::to_string(RunTime::num_threads()));
+    bench.add_context("ranks",std::to_string(nprocs));
+    for(size_t n : bench.options().sizes)
+    {
+        bench_rank<1>(bench,n);
+        bench_rank<2>(bench,n);
+        bench_rank<3>(bench,n);
+        bench_rank<4>(bench,n);
+    }
+    return bench.finish();
+}
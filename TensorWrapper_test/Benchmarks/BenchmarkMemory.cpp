@@ -0,0 +1,225 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "BenchmarkHelpers.hpp"
+#include <cstring>
+
+/** \file Times filling and reading tensors through MemoryBlock, the path the
+ *  MemoryBlock docs prescribe, and the pieces of it, against memcpy.
+ *
+ *  For tensors of rank 1 to 4 it times:
+ *
+ *  - "memcpy" copying the elements of the tensor from one buffer to another
+ *  - on a MemoryBlock buffer of each layout (row or column major, packed or
+ *    padded, see RunTime::set_padding):
+ *    - "IndexItr" walking the indices of the block without touching memory
+ *    - "flat_index" writing each element at Shape::flat_index of its index
+ *    - "offset" writing each element at MemoryBlock::offset, as the docs do
+ *  - on each enabled backend:
+ *    - "get_memory" on its own
+ *    - "set_memory" from a separately allocated MemoryBlock with the
+ *      tensor's blocks, so the backend's copy path is timed
+ *    - "fill" setting every element of a separate MemoryBlock with the loop
+ *      of the docs, and set_memory from it
+ *    - "read" get_memory and summing every element with that loop
+ *
+ *  Every case's bytes are the tensor's elements read once and written once,
+ *  as memcpy moves them, so their GB/s compare directly.  A table at the end
+ *  gives each case's time per element and its overhead over memcpy.  Each
+ *  size given with `--sizes` is the number of elements of the tensor.  Run
+ *  it under mpiexec to include the distributed backends.  See
+ *  BenchmarkHelpers.hpp for the options.
+ */
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+//Keeps the compiler from dropping loops whose results are otherwise unused
+volatile double sink;
+
+//Times the index-level pieces on a block of each layout
+template<size_t R>
+void bench_layouts(Benchmark& bench, size_t n)
+{
+    const auto dims=make_dims<R>(n);
+    const size_t size=Shape<R>(dims).size();
+    const double bytes=2.0*tensor_bytes<double>(dims);
+    const std::string name="rank "+std::to_string(R);
+    std::vector<double> from(size,1.0),to(size);
+    bench.run(name+" memcpy","raw",n,[&](){
+        std::memcpy(to.data(),from.data(),size*sizeof(double));
+    },bytes);
+    const bool padding=RunTime::padding();
+    for(bool pad : {false,true})
+        for(bool row_major : {true,false})
+        {
+            RunTime::set_padding(pad);
+            MemoryBlock<R,double> mem;
+            double* buffer=mem.allocate_block(dims,row_major);
+            const Shape<R>& shape=mem.shape(0);
+            const std::string layout=std::string(row_major ? "row" : "col")+
+                                     (pad ? " padded" : " packed");
+            bench.run(name+" IndexItr",layout,n,[&](){
+                size_t total=0;
+                for(const auto& idx : shape)total+=idx[0];
+                sink=total;
+            },bytes);
+            bench.run(name+" flat_index",layout,n,[&](){
+                for(const auto& idx : shape)buffer[shape.flat_index(idx)]=1.0;
+            },bytes);
+            bench.run(name+" offset",layout,n,[&](){
+                size_t counter=0;
+                for(auto itr=mem.begin(0);itr!=mem.end(0);++itr)
+                    buffer[mem.offset(0,counter++,*itr)]=1.0;
+            },bytes);
+        }
+    RunTime::set_padding(padding);
+}
+
+//Calls fxn(buffer,offset) for every element of mem, as the docs do
+template<size_t R, typename Fxn_t>
+void for_each_element(MemoryBlock<R,double>& mem, Fxn_t&& fxn)
+{
+    for(size_t blocki=0;blocki<mem.nblocks();++blocki)
+    {
+        double* buffer=mem.block(blocki);
+        size_t counter=0;
+        for(auto itr=mem.begin(blocki);itr!=mem.end(blocki);++itr)
+            fxn(buffer,mem.offset(blocki,counter++,*itr));
+    }
+}
+
+/** \brief Allocates a buffer for each of the blocks in \p mem, filled with
+ *  \p value.
+ *
+ *  The blocks get_memory hands out may point into the tensor, and setting a
+ *  tensor from its own memory is skipped, so set_memory is timed from these.
+ *  Copying the blocks (rather than making one block of the whole tensor)
+ *  keeps each rank writing only the elements it holds.
+ */
+template<size_t R>
+MemoryBlock<R,double> separate_blocks(const MemoryBlock<R,double>& mem,
+                                      double value)
+{
+    MemoryBlock<R,double> rv;
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        const Shape<R>& shape=mem.shape(i);
+        if(!shape.size())continue;
+        const std::array<size_t,R> start=*shape.begin();
+        std::array<size_t,R> end;
+        for(size_t j=0;j<R;++j)end[j]=start[j]+shape.dims()[j];
+        double* buffer=rv.allocate_block(end,shape.is_row_major(),start);
+        std::fill(buffer,buffer+rv.shape(rv.nblocks()-1).extent(),value);
+    }
+    return rv;
+}
+
+//Times the MemoryBlock paths of backend TT for rank R tensors
+template<size_t R, TensorTypes TT>
+void bench_backend(Benchmark& bench, size_t n, std::true_type)
+{
+    const auto dims=make_dims<R>(n);
+    const double bytes=2.0*tensor_bytes<double>(dims);
+    const std::string name="rank "+std::to_string(R);
+    const std::string backend=backend_name(TT);
+    TensorWrapper<R,double,TT> A(dims,1.0);
+    bench.run(name+" get_memory",backend,n,[&](){
+        auto mem=A.get_memory();
+    },bytes);
+    auto mem=separate_blocks(A.get_memory(),2.0);
+    bench.run(name+" set_memory",backend,n,[&](){A.set_memory(mem);},bytes);
+    bench.run(name+" fill",backend,n,[&](){
+        for_each_element(mem,[](double* buffer, size_t i){buffer[i]=2.0;});
+        A.set_memory(mem);
+    },bytes);
+    bench.run(name+" read",backend,n,[&](){
+        auto mem=A.get_memory();
+        double total=0.0;
+        for_each_element(mem,[&](double* buffer, size_t i){
+            total+=buffer[i];
+        });
+        sink=total;
+    },bytes);
+}
+
+//The backend can't hold a rank R tensor (e.g. EigenMatrix)
+template<size_t R, TensorTypes TT>
+void bench_backend(Benchmark&, size_t, std::false_type)
+{}
+
+template<size_t R, TensorTypes TT>
+void bench_backend(Benchmark& bench, size_t n)
+{
+    bench_backend<R,TT>(bench,n,
+                        std::integral_constant<bool,holds_rank(TT,R)>());
+}
+
+template<size_t R>
+void bench_rank(Benchmark& bench, size_t n)
+{
+    bench_layouts<R>(bench,n);
+    bench_backend<R,TensorTypes::EigenMatrix>(bench,n);
+    bench_backend<R,TensorTypes::EigenTensor>(bench,n);
+    bench_backend<R,TensorTypes::EigenSparse>(bench,n);
+#ifdef ENABLE_GAXX
+    bench_backend<R,TensorTypes::GlobalArrays>(bench,n);
+#endif
+#ifdef ENABLE_TILEDARRAY
+    bench_backend<R,TensorTypes::TiledArray>(bench,n);
+#endif
+#ifdef ENABLE_CTF
+    bench_backend<R,TensorTypes::CTF>(bench,n);
+#endif
+#ifdef ENABLE_DISTRIBUTED
+    bench_backend<R,TensorTypes::Distributed>(bench,n);
+#endif
+}
+
+//Prints the time per element of each case and its overhead over memcpy
+void print_overheads(const std::vector<BenchmarkResult>& results)
+{
+    std::map<std::string,double> memcpy_times;
+    for(const auto& result : results)
+        if(result.backend=="raw")
+            memcpy_times[result.name.substr(0,6)+std::to_string(result.size)]=
+                result.stats.median;
+    std::cout<<std::endl<<std::left<<std::setw(40)<<"Case"<<std::right
+             <<std::setw(14)<<"ns/element"<<std::setw(14)<<"overhead (ns)"
+             <<std::setw(12)<<"x memcpy"<<std::endl;
+    for(const auto& result : results)
+    {
+        const double elements=result.bytes/(2.0*sizeof(double));
+        const double time=result.stats.median;
+        const double base=memcpy_times[result.name.substr(0,6)+
+                                       std::to_string(result.size)];
+        std::ostringstream line;
+        line<<std::left<<std::setw(40)<<result.key()<<std::right
+            <<std::fixed<<std::setprecision(3)<<std::setw(14)
+            <<time/elements*1E9<<std::setw(14)<<(time-base)/elements*1E9
+            <<std::setprecision(2)<<std::setw(12)
+            <<(base>0.0 ? time/base : 0.0);
+        std::cout<<line.str()<<std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    RunTime rt(argc,argv);
+    int me=0,nprocs=1;
+#ifdef ENABLE_DISTRIBUTED
+    MPI_Comm_rank(MPI_COMM_WORLD,&me);
+    MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+#endif
+    Benchmark bench("Benchmarking get_memory/set_memory",argc,argv,{4096},
+                    !me);
+    bench.add_context("threads",std::to_string(RunTime::num_threads()));
+    bench.add_context("ranks",std::to_string(nprocs));
+    for(size_t n : bench.options().sizes)
+    {
+        bench_rank<1>(bench,n);
+        bench_rank<2>(bench,n);
+        bench_rank<3>(bench,n);
+        bench_rank<4>(bench,n);
+    }
+    if(!me)print_overheads(bench.results());
+    return bench.finish();
+}
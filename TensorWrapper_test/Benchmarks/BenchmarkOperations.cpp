@@ -0,0 +1,92 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include <TensorWrapper/MathLibs.hpp>
+#include "BenchmarkHelpers.hpp"
+
+/** \file Times the operations of the stress tests (A+B+C, A-B-C, A*B*C and
+ *  A^T*B*C on n by n matrices) for BLAS and each enabled backend, over the
+ *  sizes given with `--sizes`.  See BenchmarkHelpers.hpp for the options.
+ */
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+using eigen_matrix=Eigen::MatrixXd;
+
+//The BLAS calls of BLASBaseLine, which the backends can't beat
+void bench_blas(Benchmark& bench, size_t n)
+{
+    const int dim=static_cast<int>(n);
+    const int dim2=dim*dim;
+    std::vector<double> A(dim2),B(dim2),C(dim2),D(dim2),E(dim2);
+    for(int i=0;i<dim2;++i)
+    {
+        A[i]=std::sin(i);
+        B[i]=std::cos(i);
+        C[i]=std::sin(2.0*i);
+    }
+    bench.run("A+B+C","BLAS",n,[&](){
+        D=A;
+        cblas_daxpy(dim2,1.0,B.data(),1,D.data(),1);
+        cblas_daxpy(dim2,1.0,C.data(),1,D.data(),1);
+    });
+    bench.run("A-B-C","BLAS",n,[&](){
+        D=A;
+        cblas_daxpy(dim2,-1.0,B.data(),1,D.data(),1);
+        cblas_daxpy(dim2,-1.0,C.data(),1,D.data(),1);
+    });
+    bench.run("A*B*C","BLAS",n,[&](){
+        cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasNoTrans,dim,dim,dim,
+                    1.0,A.data(),dim,B.data(),dim,0.0,E.data(),dim);
+        cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasNoTrans,dim,dim,dim,
+                    1.0,E.data(),dim,C.data(),dim,0.0,D.data(),dim);
+    });
+    bench.run("A^T*B*C","BLAS",n,[&](){
+        cblas_dgemm(CblasRowMajor,CblasTrans,CblasNoTrans,dim,dim,dim,
+                    1.0,A.data(),dim,B.data(),dim,0.0,E.data(),dim);
+        cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasNoTrans,dim,dim,dim,
+                    1.0,E.data(),dim,C.data(),dim,0.0,D.data(),dim);
+    });
+}
+
+//The same operations through the public API of backend TT
+template<TensorTypes TT>
+void bench_backend(Benchmark& bench, const std::string& backend, size_t n)
+{
+    using tensor_type=TensorWrapper<2,double,TT>;
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    auto l=make_index("l");
+    //Every rank makes the same elements
+    const eigen_matrix dA=eigen_matrix::NullaryExpr(n,n,[n](long p,long q){
+        return std::sin(p+n*q);});
+    const eigen_matrix dB=dA.transpose(),dC=dA.cwiseAbs();
+    const EigenMatrix<double> eA(dA),eB(dB),eC(dC);
+    tensor_type A(eA),B(eB),C(eC),D;
+    bench.run("A+B+C",backend,n,[&](){D=A+B+C;});
+    bench.run("A-B-C",backend,n,[&](){D=A-B-C;});
+    bench.run("A*B*C",backend,n,[&](){D=A(i,k)*B(k,l)*C(l,j);});
+    bench.run("A^T*B*C",backend,n,[&](){D=A(k,i)*B(k,l)*C(l,j);});
+}
+
+int main(int argc, char** argv)
+{
+    RunTime rt(argc,argv);
+    int me=0,nprocs=1;
+#ifdef ENABLE_DISTRIBUTED
+    MPI_Comm_rank(MPI_COMM_WORLD,&me);
+    MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+#endif
+    Benchmark bench("Benchmarking matrix operations",argc,argv,{10,50},!me);
+    bench.add_context("threads",std::to_string(RunTime::num_threads()));
+    bench.add_context("ranks",std::to_string(nprocs));
+    for(size_t n : bench.options().sizes)
+    {
+        bench_blas(bench,n);
+        bench_backend<TensorTypes::EigenMatrix>(bench,"EigenMatrix",n);
+        bench_backend<TensorTypes::EigenTensor>(bench,"EigenTensor",n);
+    #ifdef ENABLE_DISTRIBUTED
+        bench_backend<TensorTypes::Distributed>(bench,"Distributed",n);
+    #endif
+    }
+    return bench.finish();
+}
@@ -0,0 +1,339 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "BenchmarkHelpers.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/** \file Measures how add, permute, contraction, and eigensolve scale with
+ *  the number of workers (threads or MPI ranks).
+ *
+ *  Run with `--threads 1,2,4,8` and/or `--ranks 1,2,4` the program is a
+ *  driver: it reruns itself once per count, with OMP_NUM_THREADS set to each
+ *  thread count (at one rank) and under mpiexec with each rank count (at one
+ *  thread per rank), and prints tables of the parallel efficiency.  The thread
+ *  sweep covers every enabled backend; the rank sweep covers the distributed
+ *  ones (Global Arrays, TiledArray, CTF, and the native one), which need
+ *  TensorWrapper built with MPI.  `--output` writes every run
+ *  as JSON, the backend suffixed with its count (e.g. "EigenTensor x4
+ *  threads").
+ *
+ *  With `--scaling strong` (the default) each size is the extent of the n by
+ *  n matrices whatever the count, and the efficiency of w workers is
+ *  T(1)/(w T(w)).  With `--scaling weak` each size is the extent at one
+ *  worker, and grows with the count so the work per worker stays constant
+ *  (as w^(1/2) for add and permute, whose work is quadratic, and w^(1/3) for
+ *  contraction and eigensolve); the efficiency is then T(1)/T(w).
+ *
+ *  Run without those options the program times the operations with the
+ *  threads and ranks it was started with, which is what the driver runs.
+ *  The other options are those of BenchmarkHelpers.hpp and are passed on.
+ */
+
+//How the rank sweep starts MPI programs (set by CMake)
+#ifndef MPIEXEC
+    #define MPIEXEC "mpiexec"
+#endif
+#ifndef MPIEXEC_NUMPROC_FLAG
+    #define MPIEXEC_NUMPROC_FLAG "-n"
+#endif
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+using eigen_matrix=Eigen::MatrixXd;
+
+//The options of the driver, which the benchmark harness doesn't know
+struct ScalingOptions{
+    std::vector<size_t> threads;
+    std::vector<size_t> ranks;
+    bool weak=false;
+    //The command line without the options above
+    std::vector<std::string> args;
+
+    ScalingOptions(int argc, char** argv)
+    {
+        auto list=[](const std::string& value){
+            std::vector<size_t> rv;
+            std::stringstream ss(value);
+            std::string x;
+            while(std::getline(ss,x,','))rv.push_back(std::stoul(x));
+            return rv;
+        };
+        args.push_back(argv[0]);
+        for(int i=1;i<argc;++i)
+        {
+            const std::string opt(argv[i]);
+            const std::string value(i+1<argc ? argv[i+1] : "");
+            if(opt=="--threads")threads=list(value);
+            else if(opt=="--ranks")ranks=list(value);
+            else if(opt=="--scaling")
+            {
+                if(value!="strong" && value!="weak")
+                    throw std::invalid_argument("--scaling is strong or weak");
+                weak=(value=="weak");
+            }
+            else
+            {
+                args.push_back(opt);
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    bool is_driver()const noexcept{return !threads.empty() || !ranks.empty();}
+};
+
+//The extent of the matrices for w workers, whose work grows as n^degree
+size_t extent(size_t n, size_t workers, bool weak, double degree)
+{
+    if(!weak)return n;
+    return static_cast<size_t>(std::round(n*std::pow(workers,1.0/degree)));
+}
+
+//An n by n matrix that every rank makes the same; symmetric if requested
+template<TensorTypes TT>
+TensorWrapper<2,double,TT> make_matrix(size_t n, bool symmetric=false)
+{
+    const eigen_matrix A=eigen_matrix::NullaryExpr(n,n,[n](long p,long q){
+        return std::sin(p+n*q);});
+    const eigen_matrix S=symmetric ? eigen_matrix(A+A.transpose()) : A;
+    return TensorWrapper<2,double,TT>(EigenMatrix<double>(S));
+}
+
+//Backends whose wrapper can diagonalize a matrix
+constexpr bool has_eigensolver(TensorTypes TT)
+{
+    return TT==TensorTypes::EigenMatrix || TT==TensorTypes::EigenTensor ||
+           TT==TensorTypes::EigenSparse || TT==TensorTypes::Distributed;
+}
+
+template<TensorTypes TT>
+void bench_eigensolve(Benchmark& bench, size_t n, size_t m, std::true_type)
+{
+    const auto S=make_matrix<TT>(m,true);
+    bench.run("eigensolve",backend_name(TT),n,[&](){
+        auto eigen_sys=self_adjoint_eigen_solver(S);
+    });
+}
+
+template<TensorTypes TT>
+void bench_eigensolve(Benchmark&, size_t, size_t, std::false_type)
+{}
+
+//Times the operations on backend TT with \p workers workers
+template<TensorTypes TT>
+void bench_backend(Benchmark& bench, size_t n, size_t workers, bool weak)
+{
+    using tensor_type=TensorWrapper<2,double,TT>;
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    const std::string backend=backend_name(TT);
+    {
+        const size_t m=extent(n,workers,weak,2.0);
+        const tensor_type A=make_matrix<TT>(m),B=make_matrix<TT>(m);
+        tensor_type C;
+        bench.run("add",backend,n,[&](){C=A+B;});
+        //C=A(j,i) would evaluate in A's own order, so permute explicitly
+        using idx_ij=Indices<decltype(i),decltype(j)>;
+        using idx_ji=Indices<decltype(j),decltype(i)>;
+        const Permutation<idx_ij,idx_ji,std::decay_t<decltype(A(j,i))>>
+            transpose(A(j,i));
+        bench.run("permute",backend,n,[&](){C=transpose;});
+    }
+    const size_t m=extent(n,workers,weak,3.0);
+    const tensor_type A=make_matrix<TT>(m),B=make_matrix<TT>(m);
+    tensor_type C;
+    bench.run("contraction",backend,n,[&](){C=A(i,k)*B(k,j);});
+    bench_eigensolve<TT>(bench,n,m,
+        std::integral_constant<bool,has_eigensolver(TT)>());
+}
+
+//Times the operations with the threads and ranks the program has
+int run_worker(const ScalingOptions& scaling)
+{
+    std::vector<char*> argv;
+    for(const auto& arg : scaling.args)argv.push_back(const_cast<char*>(
+                                                      arg.c_str()));
+    //MPI_Init expects argv[argc] to be null
+    argv.push_back(nullptr);
+    int argc=static_cast<int>(argv.size())-1;
+    RunTime rt(argc,argv.data());
+    int me=0,nprocs=1;
+#ifdef ENABLE_DISTRIBUTED
+    MPI_Comm_rank(MPI_COMM_WORLD,&me);
+    MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+#endif
+    Benchmark bench("Benchmarking scaling",argc,argv.data(),{200},!me);
+    const size_t nthreads=RunTime::num_threads();
+    bench.add_context("threads",std::to_string(nthreads));
+    bench.add_context("ranks",std::to_string(nprocs));
+    const size_t workers=nthreads*nprocs;
+    for(size_t n : bench.options().sizes)
+    {
+        //The shared-memory backends don't use the other ranks
+        if(nprocs==1)
+        {
+            bench_backend<TensorTypes::EigenMatrix>(bench,n,workers,
+                                                    scaling.weak);
+            bench_backend<TensorTypes::EigenTensor>(bench,n,workers,
+                                                    scaling.weak);
+            bench_backend<TensorTypes::EigenSparse>(bench,n,workers,
+                                                    scaling.weak);
+        }
+    #ifdef ENABLE_GAXX
+        bench_backend<TensorTypes::GlobalArrays>(bench,n,workers,
+                                                 scaling.weak);
+    #endif
+    #ifdef ENABLE_TILEDARRAY
+        bench_backend<TensorTypes::TiledArray>(bench,n,workers,
+                                               scaling.weak);
+    #endif
+    #ifdef ENABLE_CTF
+        bench_backend<TensorTypes::CTF>(bench,n,workers,scaling.weak);
+    #endif
+    #ifdef ENABLE_DISTRIBUTED
+        bench_backend<TensorTypes::Distributed>(bench,n,workers,
+                                                scaling.weak);
+    #endif
+    }
+    return bench.finish();
+}
+
+//The results of one worker count
+struct ScalingRun{
+    size_t workers;
+    std::vector<BenchmarkResult> results;
+};
+
+/** \brief Runs the worker as \p launcher prefixes it and reads its results.
+ *
+ *  \returns false if it failed.
+ */
+bool launch(const ScalingOptions& scaling, const std::string& launcher,
+            size_t workers, std::vector<ScalingRun>& runs)
+{
+    char file[]="/tmp/BenchmarkScalingXXXXXX";
+    const int fd=mkstemp(file);
+    if(fd<0)return false;
+    close(fd);
+    std::string command=launcher;
+    for(size_t i=0;i<scaling.args.size();++i)
+    {
+        //The driver writes the output itself
+        if(scaling.args[i]=="--output" && ++i)continue;
+        command+=" \""+scaling.args[i]+"\"";
+    }
+    command+=std::string(" --scaling ")+(scaling.weak ? "weak" : "strong")+
+             " --output "+file+" > /dev/null";
+    const bool ok=std::system(command.c_str())==0;
+    std::ifstream is(file);
+    if(ok && is)runs.push_back(ScalingRun{workers,read_json(is)});
+    std::remove(file);
+    return ok && is;
+}
+
+//Prints the time and efficiency of each case at each worker count
+void print_efficiency(const std::string& title,
+                      const std::vector<ScalingRun>& runs, bool weak)
+{
+    if(runs.empty())return;
+    std::cout<<std::endl<<title<<std::endl<<std::left<<std::setw(32)
+             <<"Case (time in s, efficiency)"<<std::right;
+    for(const auto& run : runs)
+        std::cout<<std::setw(20)<<std::to_string(run.workers);
+    std::cout<<std::endl;
+    for(const auto& first : runs.front().results)
+    {
+        std::ostringstream line;
+        line<<std::left<<std::setw(32)<<first.key()<<std::right;
+        const double t1=first.stats.median*runs.front().workers;
+        for(const auto& run : runs)
+        {
+            auto itr=std::find_if(run.results.begin(),run.results.end(),
+                [&](const BenchmarkResult& r){return r.key()==first.key();});
+            if(itr==run.results.end())
+            {
+                line<<std::setw(20)<<"-";
+                continue;
+            }
+            const double t=itr->stats.median;
+            const double efficiency=weak ? t1/(runs.front().workers*t) :
+                                           t1/(run.workers*t);
+            std::ostringstream cell;
+            cell<<std::scientific<<std::setprecision(2)<<t<<" ("
+                <<std::fixed<<std::setprecision(0)<<100.0*efficiency<<"%)";
+            line<<std::setw(20)<<cell.str();
+        }
+        std::cout<<line.str()<<std::endl;
+    }
+}
+
+//Runs the worker at each count and prints the tables
+int run_driver(const ScalingOptions& scaling)
+{
+    std::vector<char*> argv;
+    for(const auto& arg : scaling.args)argv.push_back(const_cast<char*>(
+                                                      arg.c_str()));
+    //MPI_Init expects argv[argc] to be null
+    argv.push_back(nullptr);
+    Benchmark bench("Benchmarking scaling",static_cast<int>(argv.size())-1,
+                    argv.data());
+    const std::string mode=scaling.weak ? "weak" : "strong";
+    std::vector<BenchmarkResult> all;
+    int nfailed=0;
+    auto sweep=[&](const std::vector<size_t>& counts, bool ranks){
+        std::vector<ScalingRun> runs;
+        for(size_t count : counts)
+        {
+            const std::string n=std::to_string(count);
+            const std::string launcher=ranks ?
+                "OMP_NUM_THREADS=1 " MPIEXEC " " MPIEXEC_NUMPROC_FLAG " "+n :
+                "OMP_NUM_THREADS="+n;
+            if(!launch(scaling,launcher,count,runs))
+            {
+                std::cout<<"Running with "<<n<<(ranks ? " ranks" : " threads")
+                         <<" failed"<<std::endl;
+                ++nfailed;
+                continue;
+            }
+            //The one-rank run also times the shared-memory backends
+            auto& results=runs.back().results;
+            if(ranks)
+                results.erase(std::remove_if(results.begin(),results.end(),
+                    [](const BenchmarkResult& r){
+                        return r.backend==backend_name(TensorTypes::EigenMatrix)
+                          || r.backend==backend_name(TensorTypes::EigenTensor)
+                          || r.backend==backend_name(TensorTypes::EigenSparse);
+                    }),results.end());
+            for(auto result : results)
+            {
+                result.backend+=" x"+n+(ranks ? " ranks" : " threads");
+                all.push_back(std::move(result));
+            }
+        }
+        print_efficiency("Parallel efficiency ("+mode+" scaling) over "+
+                         (ranks ? "ranks" : "threads"),runs,scaling.weak);
+    };
+    if(!scaling.threads.empty())sweep(scaling.threads,false);
+#ifdef ENABLE_DISTRIBUTED
+    if(!scaling.ranks.empty())sweep(scaling.ranks,true);
+#else
+    if(!scaling.ranks.empty())
+        std::cout<<"No distributed backend is enabled; --ranks is ignored"
+                 <<std::endl;
+#endif
+    if(!bench.options().output.empty())
+    {
+        std::ofstream file(bench.options().output);
+        write_json(file,all,{{"scaling",mode}});
+        std::cout<<"Results written to "<<bench.options().output<<std::endl;
+    }
+    return nfailed;
+}
+
+int main(int argc, char** argv)
+{
+    const ScalingOptions scaling(argc,argv);
+    return scaling.is_driver() ? run_driver(scaling) : run_worker(scaling);
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <TensorWrapper/MathLibs.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** \file Contains the machinery the stress tests use to put their timings in
+ *  context: a roofline of this machine, measured once at startup, and a report
+ *  of each operation's rates against it and against the raw libraries.
+ *
+ *  The roofline has two ceilings: the FLOP/s of a large BLAS matrix multiply
+ *  (about the best any backend will do) and the bandwidth of a STREAM-like
+ *  triad from main memory.  An operation doing I FLOPs per byte (its
+ *  arithmetic intensity) can at best run at min(peak FLOP/s, I * bandwidth);
+ *  it is memory-bound if the second is the smaller.  Operations whose tensors
+ *  fit in cache can beat the bandwidth ceiling.
+ */
+
+///Returns the shortest of \p reps timings of \p fxn, in seconds
+inline double best_time(const std::function<void()>& fxn, size_t reps=3)
+{
+    using clock_t=std::chrono::steady_clock;
+    double rv=std::numeric_limits<double>::max();
+    for(size_t i=0;i<reps;++i)
+    {
+        const auto start=clock_t::now();
+        fxn();
+        const std::chrono::duration<double> time=clock_t::now()-start;
+        rv=std::min(rv,time.count());
+    }
+    return rv;
+}
+
+///The ceilings on the rates of this machine
+struct Roofline{
+    double gflops=0.0;   //!< Peak rate, in GFLOP/s
+    double bandwidth=0.0;//!< Peak bandwidth from main memory, in GB/s
+
+    /** \brief Measures the ceilings.
+     *
+     *  \param[in] gemm_dim The extent of the matrices multiplied.
+     *  \param[in] stream_size The length of the triad's vectors, which should
+     *             be several times larger than the last level cache.
+     */
+    static Roofline measure(size_t gemm_dim=1024, size_t stream_size=1<<23)
+    {
+        Roofline rv;
+        const int n=static_cast<int>(gemm_dim);
+        const std::vector<double> A(n*n,1.0),B(n*n,2.0);
+        std::vector<double> C(n*n);
+        const double gemm_time=best_time([&](){
+            cblas_dgemm(CblasColMajor,CblasNoTrans,CblasNoTrans,n,n,n,1.0,
+                        A.data(),n,B.data(),n,0.0,C.data(),n);
+        });
+        rv.gflops=2.0*n*n*n/gemm_time*1E-9;
+
+        const long m=static_cast<long>(stream_size);
+        std::unique_ptr<double[]> a(new double[m]),b(new double[m]),
+                                  c(new double[m]);
+        //Touched by the threads that use them
+        #pragma omp parallel for
+        for(long i=0;i<m;++i)
+        {
+            a[i]=0.0;
+            b[i]=1.0;
+            c[i]=2.0;
+        }
+        const double s=3.0;
+        const double triad_time=best_time([&](){
+            #pragma omp parallel for
+            for(long i=0;i<m;++i)a[i]=b[i]+s*c[i];
+        },5);
+        rv.bandwidth=3.0*sizeof(double)*m/triad_time*1E-9;
+        return rv;
+    }
+
+    ///The best rate, in GFLOP/s, at arithmetic intensity \p intensity
+    double attainable(double intensity)const noexcept
+    {
+        return std::min(gflops,intensity*bandwidth);
+    }
+
+    ///True if an operation of intensity \p intensity is limited by bandwidth
+    bool memory_bound(double intensity)const noexcept
+    {
+        return intensity*bandwidth<gflops;
+    }
+
+    void print(std::ostream& os=std::cout)const
+    {
+        std::ostringstream ss;
+        ss<<std::fixed<<std::setprecision(2)<<"Roofline: peak "<<gflops
+          <<" GFLOP/s (dgemm), "<<bandwidth<<" GB/s (triad), ridge at "
+          <<gflops/bandwidth<<" FLOP/byte";
+        os<<ss.str()<<std::endl;
+    }
+};
+
+///The time one implementation (e.g. "BLAS") took for an operation
+struct Timing{
+    std::string name;
+    double time;
+};
+
+/** \brief Prints the rates of \p timings of an operation that does \p flops
+ *  FLOPs and moves \p bytes bytes, their percent of \p roof, and the ratio
+ *  of the first timing to each of the others.
+ *
+ *  The first timing is the one being assessed (TensorWrapper's), the others
+ *  are what it is compared to (raw Eigen, BLAS).  A ratio above 1 is the
+ *  overhead of the first.
+ */
+inline void print_roofline(const std::string& op, double flops, double bytes,
+                           const std::vector<Timing>& timings,
+                           const Roofline& roof, std::ostream& os=std::cout)
+{
+    const double intensity=bytes>0.0 ? flops/bytes : 0.0;
+    std::ostringstream ss;
+    ss<<std::setprecision(3)<<op<<": "<<flops<<" FLOPs, "<<bytes
+      <<" bytes, "<<intensity<<" FLOP/byte ("
+      <<(roof.memory_bound(intensity) ? "memory" : "compute")<<"-bound, "
+      <<roof.attainable(intensity)<<" GFLOP/s attainable)"<<std::endl;
+    for(const auto& timing : timings)
+    {
+        const double gflops=flops/timing.time*1E-9;
+        const double attainable=roof.attainable(intensity);
+        ss<<"  "<<std::left<<std::setw(14)<<timing.name<<std::right
+          <<std::scientific<<std::setprecision(3)<<timing.time<<" s"
+          <<std::fixed<<std::setprecision(2)<<std::setw(10)<<gflops
+          <<" GFLOP/s"<<std::setw(10)<<bytes/timing.time*1E-9<<" GB/s"
+          <<std::setw(8)<<(attainable>0.0 ? 100.0*gflops/attainable : 0.0)
+          <<"% of roofline";
+        if(&timing!=&timings.front())
+            ss<<std::setw(8)<<timings.front().time/timing.time<<"x";
+        ss<<std::endl;
+    }
+    os<<ss.str();
+}
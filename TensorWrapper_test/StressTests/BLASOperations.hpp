@@ -0,0 +1,28 @@
+#pragma once
+#include <TensorWrapper/MathLibs.hpp>
+#include <algorithm>
+
+/** \file The operations of the stress tests done with raw BLAS calls, on
+ *  column-major n by n matrices, so each stress test can put its timings
+ *  next to BLAS's.  Only the result D is written; work is an n by n scratch
+ *  matrix for the intermediate of a chain of products.
+ */
+
+///D=A+alpha*B+alpha*C
+inline void blas_add(int n, double alpha, const double* A, const double* B,
+                     const double* C, double* D)
+{
+    std::copy(A,A+n*n,D);
+    cblas_daxpy(n*n,alpha,B,1,D,1);
+    cblas_daxpy(n*n,alpha,C,1,D,1);
+}
+
+///D=op(A)*B*C, where op(A) is A^T if \p trans_A is true
+inline void blas_abc(int n, bool trans_A, const double* A, const double* B,
+                     const double* C, double* work, double* D)
+{
+    cblas_dgemm(CblasColMajor,trans_A ? CblasTrans : CblasNoTrans,
+                CblasNoTrans,n,n,n,1.0,A,n,B,n,0.0,work,n);
+    cblas_dgemm(CblasColMajor,CblasNoTrans,CblasNoTrans,n,n,n,1.0,work,n,
+                C,n,0.0,D,n);
+}
@@ -27,8 +27,7 @@ int main()
     auto s=make_index("s");
     auto mu=make_index("mu");
     auto nu=make_index("nu");
-    auto rho=make_index("rho");
-    auto sigma=make_index("sigma");
+    auto P=make_index("P");
 
     const size_t dims=2;
     const std::array<size_t,2> dims2{dims,dims};
@@ -44,19 +43,23 @@ int main()
     EigenTensor<2,double> X=Ones-T1;
     EigenTensor<2,double> Y=Ones+T1;
     EigenTensor<2,double> Htilde=X(mu,p)*Y(nu,q)*H(mu,nu);
-    EigenTensor<4,double> Gtilde=
-            X(mu,p)*Y(nu,q)*X(rho,r)*Y(sigma,s)*G(mu,nu,rho,sigma);
+    //Transform the Cholesky vectors of G rather than G itself
+    EigenTensor<3,double> B=cholesky_decompose(G,1.0E-8);
+    EigenTensor<3,double> Btilde=X(mu,p)*Y(nu,q)*B(mu,nu,P);
+    EigenTensor<4,double> Gtilde=Btilde(p,q,P)*Btilde(r,s,P);
     EigenTensor<4,double> Ltilde=
             Gtilde(p,q,r,s)*2.0-Gtilde(p,s,r,q);
     EigenTensor<2,double> Ftilde=Htilde(p,q);//+Gtilde(p,q,i,i)*2.0-Gtilde(p,i,i,q);
 
     //Singles residuals
     EigenTensor<4,double> u=T2(i,a,j,b)*2.0-T2(j,a,i,b);
-    auto OmegaA1=u(k,c,i,d)*Gtilde(a,d,k,c);
-    auto OmegaB1=u(k,a,l,c)*Gtilde(k,i,l,c)*-1.0;
-    auto OmegaC1=u(i,a,k,c)*Ftilde(k,c);
-    auto OmegaD1=Ftilde(i,a);
-    EigenTensor<2,double> Omega1=OmegaA1+OmegaB1+OmegaC1+OmegaD1;
+    //The terms are independent, so they are computed at the same time
+    auto OmegaA1=eval_async<EigenTensor<2,double>>(u(k,c,i,d)*Gtilde(a,d,k,c));
+    auto OmegaB1=eval_async<EigenTensor<2,double>>(
+                u(k,a,l,c)*Gtilde(k,i,l,c)*-1.0);
+    auto OmegaC1=eval_async<EigenTensor<2,double>>(u(i,a,k,c)*Ftilde(k,c));
+    EigenTensor<2,double> A1=OmegaA1.get(),B1=OmegaB1.get(),C1=OmegaC1.get();
+    EigenTensor<2,double> Omega1=A1(i,a)+B1(a,i)+C1(i,a)+Ftilde(i,a);
 
     //Doubles residuals
     EigenTensor<4,double> OmegaA2=Gtilde(i,a,j,b)+T2(i,c,j,d)*Gtilde(a,c,b,d);
@@ -1,5 +1,7 @@
 #include <TensorWrapper/TensorWrapper.hpp>
 #include "TestHelpers.hpp"
+#include "RooflineHelpers.hpp"
+#include "BLASOperations.hpp"
 
 using namespace TWrapper;
 using namespace Eigen;
@@ -8,17 +10,13 @@ using idx_t=Eigen::IndexPair<int>;
 template<size_t n>
 using idx_array=std::array<idx_t,n>;
 
-void print_times(const std::string& msg, double eigen_time, double twtime)
-{
-    std::cout<<msg<<" Eigen time (s): "<<eigen_time<<std::endl;
-    std::cout<<msg<<" TensorWrapper time (s): "<<twtime<<std::endl;
-}
-
-
 int main(int argc, char** argv)
 {
     Tester tester("Stress Testing Eigen Tensor Wrapping");
     const size_t dim=argc>1?atoi(argv[1]):10;
+    const int n=static_cast<int>(dim);
+    const Roofline roof=Roofline::measure();
+    roof.print();
     const int nthreads=omp_get_max_threads();
     Eigen::ThreadPool pool(nthreads);
     Eigen::ThreadPoolDevice my_device(&pool,nthreads);
@@ -29,76 +27,83 @@ int main(int argc, char** argv)
     {
 
     const std::array<size_t,2> dims({dim,dim});
-    tensor_type _A(dims),_B(dims),_C(dims);
+    tensor_type _A(dims),_B(dims),_C(dims),_D;
     fill_random(_A);
     fill_random(_B);
     fill_random(_C);
 
     Tensor<double,2> A=_A.data(),B=_B.data(),C=_C.data();
-
-    Timer timer;
-    Tensor<double,2> D(dim,dim);
-    D.device(my_device)=A+B+C;
-    double eigen_time=timer.get_time();
-    timer.reset();
-    tensor_type _D=_A+_B+_C;
-    double wrapper_time=timer.get_time();
-    print_times("A+B+C",eigen_time,wrapper_time);
+    Tensor<double,2> D(dim,dim),E(dim,dim),work(dim,dim);
+
+    OperationCost c=cost(_A+_B+_C);
+    double eigen_time=best_time([&](){D.device(my_device)=A+B+C;});
+    double blas_time=best_time([&](){
+        blas_add(n,1.0,A.data(),B.data(),C.data(),E.data());
+    });
+    double wrapper_time=best_time([&](){_D=_A+_B+_C;});
+    print_roofline("A+B+C",c.flops,c.bytes,{{"TensorWrapper",wrapper_time},
+                   {"Eigen",eigen_time},{"BLAS",blas_time}},roof);
     tester.test("A+B+C",D==_D);
 
-    timer.reset();
-    D.device(my_device)=A-B-C;
-    eigen_time=timer.get_time();
-    timer.reset();
-    _D=_A-_B-_C;
-    wrapper_time=timer.get_time();
-    print_times("A-B-C",eigen_time,wrapper_time);
+    c=cost(_A-_B-_C);
+    eigen_time=best_time([&](){D.device(my_device)=A-B-C;});
+    blas_time=best_time([&](){
+        blas_add(n,-1.0,A.data(),B.data(),C.data(),E.data());
+    });
+    wrapper_time=best_time([&](){_D=_A-_B-_C;});
+    print_roofline("A-B-C",c.flops,c.bytes,{{"TensorWrapper",wrapper_time},
+                   {"Eigen",eigen_time},{"BLAS",blas_time}},roof);
     tester.test("A-B-C",D==_D);
 
-    timer.reset();
-    auto contract1=A.contract(B,idx_array<1>{idx_t{1,0}});
-    D.device(my_device)=contract1.contract(C,idx_array<1>{idx_t{1,0}});
-    eigen_time=timer.get_time();
-
-
-    timer.reset();
-    _D=_A(i,k)*_B(k,l)*_C(l,j);
-    wrapper_time=timer.get_time();
-    print_times("A*B*C",eigen_time,wrapper_time);
+    c=cost(_A(i,k)*_B(k,l)*_C(l,j));
+    eigen_time=best_time([&](){
+        auto contract1=A.contract(B,idx_array<1>{idx_t{1,0}});
+        D.device(my_device)=contract1.contract(C,idx_array<1>{idx_t{1,0}});
+    });
+    blas_time=best_time([&](){
+        blas_abc(n,false,A.data(),B.data(),C.data(),work.data(),E.data());
+    });
+    wrapper_time=best_time([&](){_D=_A(i,k)*_B(k,l)*_C(l,j);});
+    print_roofline("A*B*C",c.flops,c.bytes,{{"TensorWrapper",wrapper_time},
+                   {"Eigen",eigen_time},{"BLAS",blas_time}},roof);
     tester.test("A*B*C",_D==D);
 
-    timer.reset();
-    auto contract2=A.contract(B,idx_array<1>{idx_t{0,0}});
-    D.device(my_device)=contract2.contract(C,idx_array<1>{idx_t{1,0}});
-    eigen_time=timer.get_time();
-
-    timer.reset();
-    _D=_A(k,i)*_B(k,l)*_C(l,j);
-    wrapper_time=timer.get_time();
-    print_times("A^T*B*C",eigen_time,wrapper_time);
+    c=cost(_A(k,i)*_B(k,l)*_C(l,j));
+    eigen_time=best_time([&](){
+        auto contract2=A.contract(B,idx_array<1>{idx_t{0,0}});
+        D.device(my_device)=contract2.contract(C,idx_array<1>{idx_t{1,0}});
+    });
+    blas_time=best_time([&](){
+        blas_abc(n,true,A.data(),B.data(),C.data(),work.data(),E.data());
+    });
+    wrapper_time=best_time([&](){_D=_A(k,i)*_B(k,l)*_C(l,j);});
+    print_roofline("A^T*B*C",c.flops,c.bytes,{{"TensorWrapper",wrapper_time},
+                   {"Eigen",eigen_time},{"BLAS",blas_time}},roof);
     tester.test("A^T*B*C",D==_D);
     }
 
     std::array<size_t,3> dims({dim,dim,dim});
-    EigenTensor<3,double> _A(dims),_B(dims),_C(dims);
+    EigenTensor<3,double> _A(dims),_B(dims),_C(dims),_D;
     fill_random(_A);
     fill_random(_B);
     fill_random(_C);
     Tensor<double,3> A=_A.data(),B=_B.data(),C=_C.data(),D(dim,dim,dim);
 
-    Timer timer;
-    //A(i,j,k)*B(i,k,l)=Temp(j,l)
-    auto contract1=A.contract(B,idx_array<2>{idx_t{0,0},idx_t{2,1}});
-    //Temp(j,l)*C(m,l,n)=D(j,m,n)
-    D.device(my_device)=contract1.contract(C,idx_array<1>{idx_t{1,1}});
-    double eigen_time=timer.get_time();
-
     auto m=make_index("m");
-    auto n=make_index("n");
-    timer.reset();
-    EigenTensor<3,double> _D=_A(i,j,k)*_B(i,k,l)*_C(m,l,n);
-    double wrapper_time=timer.get_time();
-    print_times("A(i,j,k)*B(i,k,l)*C(m,l,n)",eigen_time,wrapper_time);
+    auto o=make_index("n");
+    const OperationCost c=cost(_A(i,j,k)*_B(i,k,l)*_C(m,l,o));
+    const double eigen_time=best_time([&](){
+        //A(i,j,k)*B(i,k,l)=Temp(j,l)
+        auto contract1=A.contract(B,idx_array<2>{idx_t{0,0},idx_t{2,1}});
+        //Temp(j,l)*C(m,l,n)=D(j,m,n)
+        D.device(my_device)=contract1.contract(C,idx_array<1>{idx_t{1,1}});
+    });
+    const double wrapper_time=best_time([&](){
+        _D=_A(i,j,k)*_B(i,k,l)*_C(m,l,o);
+    });
+    //No single BLAS call does this contraction without permuting first
+    print_roofline("A(i,j,k)*B(i,k,l)*C(m,l,n)",c.flops,c.bytes,
+                   {{"TensorWrapper",wrapper_time},{"Eigen",eigen_time}},roof);
     tester.test("A(i,j,k)*B(i,k,l)*C(m,l,n)",_D==D);
 
 
@@ -25,7 +25,8 @@ int main(int argc, char** argv)
     fill_random(_B);
     fill_random(_C);
 
-    wrapped_type A(_A.data()),B(_B.data()),C(_C.data());
+    wrapped_type A(_A.data().tensor()),B(_B.data().tensor()),
+                 C(_C.data().tensor());
 
     Timer timer;
     wrapped_type D=A+B+C;
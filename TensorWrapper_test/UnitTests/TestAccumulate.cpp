@@ -0,0 +1,74 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+using namespace TWrapper;
+
+//Each of n contributions adds 1 to every element of the box [start,end)
+template<size_t R>
+MemoryBlock<R,double> ones(const std::array<size_t,R>& start,
+                           const std::array<size_t,R>& end)
+{
+    MemoryBlock<R,double> rv;
+    double* buffer=rv.allocate_block(end,true,start);
+    std::fill(buffer,buffer+rv.shape(0).extent(),1.0);
+    return rv;
+}
+
+//Accumulates n contributions from all threads and checks every element
+template<size_t R, detail_::TensorTypes TT>
+bool check(TensorWrapper<R,double,TT>& t, const std::array<size_t,R>& start,
+           const std::array<size_t,R>& end, size_t n)
+{
+    const auto mem=ones(start,end);
+    #pragma omp parallel for num_threads(4)
+    for(size_t i=0;i<n;++i)t.accumulate_memory(mem);
+    bool all_good=true;
+    for(const auto& idx : t.shape())
+    {
+        bool inside=true;
+        for(size_t i=0;i<R;++i)
+            inside=inside && idx[i]>=start[i] && idx[i]<end[i];
+        all_good=all_good && t(idx)==(inside ? 1.0+n : 1.0);
+    }
+    return all_good;
+}
+
+int main()
+{
+    Tester tester("Testing concurrent accumulation");
+    using idx2=std::array<size_t,2>;
+    using idx3=std::array<size_t,3>;
+
+    EigenMatrix<double> A(idx2{9,7},1.0);
+    tester.test("Matrix",check(A,idx2{2,1},idx2{8,7},100));
+    EigenTensor<3,double> B(idx3{5,4,6},1.0);
+    tester.test("Rank 3 tensor",check(B,idx3{0,1,2},idx3{5,3,6},100));
+    EigenSparse<2,double> C(idx2{6,6},1.0);
+    tester.test("Sparse matrix",check(C,idx2{1,1},idx2{3,4},50));
+
+    //Contributions to the same element within one block are all kept
+    EigenMatrix<double> D(idx2{3,3},0.0);
+    MemoryBlock<2,double> twice;
+    double* buffer=twice.allocate_block(idx2{1,1});
+    buffer[0]=2.5;
+    D.accumulate_memory(twice);
+    D.accumulate_memory(twice);
+    tester.test("Repeated accumulation",D(0,0)==5.0 && D(1,1)==0.0);
+
+    //Blocks are read through their own iterators and strides
+    EigenMatrix<double> E(idx2{4,4},0.0);
+    double partial[]={1.0,2.0,3.0,4.0};
+    MemoryBlock<2,double> sub;
+    sub.add_block(partial,Shape<2>(idx2{4,4},true,idx2{},
+                  IndexItr<2>(idx2{3,4},true,true,idx2{1,2}),
+                  IndexItr<2>(idx2{3,4},false,true,idx2{1,2})));
+    E.accumulate_memory(sub);
+    tester.test("Partial block",E(1,2)==1.0 && E(1,3)==2.0 && E(2,2)==3.0 &&
+                                E(2,3)==4.0 && E(0,0)==0.0 && E(3,3)==0.0);
+    double strided[]={1.0,2.0,-1.0,3.0,4.0,-1.0};
+    MemoryBlock<2,double> gaps;
+    gaps.add_block(strided,Shape<2>(idx2{2,2},true,idx2{},idx2{3,1}));
+    E.accumulate_memory(gaps);
+    tester.test("Strided block",E(0,0)==1.0 && E(0,1)==2.0 && E(1,0)==3.0 &&
+                                E(1,1)==4.0 && E(1,2)==1.0);
+    return tester.results();
+}
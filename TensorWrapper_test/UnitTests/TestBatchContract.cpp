@@ -0,0 +1,118 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <stdexcept>
+#include <vector>
+using namespace TWrapper;
+
+template<size_t R, typename T, detail_::TensorTypes TT>
+bool same(const TensorWrapper<R,T,TT>& lhs, const TensorWrapper<R,T,TT>& rhs)
+{
+    if(lhs.shape().dims()!=rhs.shape().dims())return false;
+    auto lmem=const_cast<TensorWrapper<R,T,TT>&>(lhs).get_memory();
+    auto rmem=const_cast<TensorWrapper<R,T,TT>&>(rhs).get_memory();
+    for(const auto& idx : lmem.shape(0))
+    {
+        const T l=lmem.block(0)[lmem.shape(0).offset(idx)];
+        const T r=rmem.block(0)[rmem.shape(0).offset(idx)];
+        if(std::fabs(l-r)>1E-10*std::max<T>(1.0,std::fabs(r)))return false;
+    }
+    return true;
+}
+
+template<typename Tensor_t>
+std::vector<Tensor_t> make_batch(const std::vector<typename Tensor_t::index_t>&
+                                 dims)
+{
+    std::vector<Tensor_t> rv;
+    for(const auto& x : dims)
+    {
+        rv.emplace_back(x);
+        fill_random(rv.back());
+    }
+    return rv;
+}
+
+int main()
+{
+    Tester tester("Testing batched contractions");
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    auto l=make_index("l");
+
+    //Matrices of different sizes
+    using matrix_t=EigenMatrix<double>;
+    const std::vector<std::array<size_t,2>> adims{{3,4},{7,2},{1,5},{12,9}};
+    const std::vector<std::array<size_t,2>> bdims{{4,6},{2,2},{5,1},{9,11}};
+    const std::vector<std::array<size_t,2>> btdims{{6,4},{2,2},{1,5},{11,9}};
+    auto A=make_batch<matrix_t>(adims);
+    auto B=make_batch<matrix_t>(bdims);
+    auto Bt=make_batch<matrix_t>(btdims);
+
+    auto C=batch_contract(A,B,[&](auto& a, auto& b){return a(i,k)*b(k,j);});
+    bool all_good=C.size()==A.size();
+    for(size_t p=0;p<A.size();++p)
+    {
+        matrix_t corr=A[p](i,k)*B[p](k,j);
+        all_good=all_good && same(C[p],corr);
+    }
+    tester.test("A(i,k)*B(k,j)",all_good);
+
+    C=batch_contract(A,Bt,[&](auto& a, auto& b){return a(i,k)*b(j,k);});
+    all_good=true;
+    for(size_t p=0;p<A.size();++p)
+    {
+        matrix_t corr=A[p](i,k)*Bt[p](j,k);
+        all_good=all_good && same(C[p],corr);
+    }
+    tester.test("A(i,k)*B(j,k)",all_good);
+
+    C=batch_contract(A,A,[&](auto& a, auto& b){return a(k,i)*b(k,j);});
+    all_good=true;
+    for(size_t p=0;p<A.size();++p)
+    {
+        matrix_t corr=A[p](k,i)*A[p](k,j);
+        all_good=all_good && same(C[p],corr);
+    }
+    tester.test("A(k,i)*A(k,j)",all_good);
+
+    //Rank 3 blocks, including ones needing a copy to be seen as a matrix
+    using tensor3_t=EigenTensor<3,double>;
+    using tensor2_t=EigenTensor<2,double>;
+    const std::vector<std::array<size_t,3>> tdims{{3,4,5},{2,6,3},{5,1,4}};
+    const std::vector<std::array<size_t,2>> mdims{{5,2},{3,7},{4,4}};
+    const std::vector<std::array<size_t,2>> ndims{{4,5},{6,3},{1,4}};
+    auto T=make_batch<tensor3_t>(tdims);
+    auto M=make_batch<tensor2_t>(mdims);
+    auto N=make_batch<tensor2_t>(ndims);
+    auto D=batch_contract(T,M,[&](auto& t, auto& m){return t(i,j,k)*m(k,l);});
+    all_good=true;
+    for(size_t p=0;p<T.size();++p)
+    {
+        tensor3_t corr=T[p](i,j,k)*M[p](k,l);
+        all_good=all_good && same(D[p],corr);
+    }
+    tester.test("T(i,j,k)*M(k,l)",all_good);
+
+    auto v=batch_contract(T,N,[&](auto& t, auto& n){return t(i,j,k)*n(j,k);});
+    all_good=true;
+    for(size_t p=0;p<T.size();++p)
+    {
+        EigenTensor<1,double> corr=T[p](i,j,k)*N[p](j,k);
+        all_good=all_good && same(v[p],corr);
+    }
+    tester.test("T(i,j,k)*N(j,k)",all_good);
+
+    //Errors
+    bool caught=false;
+    try{batch_contract(A,Bt,[&](auto& a, auto& b){return a(i,k)*b(k,j);});}
+    catch(const std::invalid_argument&){caught=true;}
+    tester.test("Mismatched contracted dimensions",caught);
+    caught=false;
+    B.pop_back();
+    try{batch_contract(A,B,[&](auto& a, auto& b){return a(i,k)*b(k,j);});}
+    catch(const std::invalid_argument&){caught=true;}
+    tester.test("Mismatched batch sizes",caught);
+
+    return tester.results();
+}
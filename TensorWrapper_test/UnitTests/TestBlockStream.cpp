@@ -0,0 +1,41 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+using namespace TWrapper;
+
+//Streams t and checks each block against get_memory
+template<size_t R, detail_::TensorTypes TT>
+bool stream_matches(TensorWrapper<R,double,TT>& t, size_t depth)
+{
+    auto mem=t.get_memory();
+    size_t nseen=0;
+    bool all_good=true;
+    BlockStream<R,double,TT> stream(t,depth);
+    for(auto block : stream)
+        for(const auto& idx : block.shape)
+        {
+            ++nseen;
+            all_good=all_good && block.data[block.shape.offset(idx)]==
+                                 mem.block(0)[mem.shape(0).offset(idx)];
+        }
+    return all_good && nseen==t.shape().size();
+}
+
+int main()
+{
+    Tester tester("Testing streaming of tensor blocks");
+    EigenMatrix<double> A(std::array<size_t,2>{7,5});
+    fill_random(A);
+    tester.test("Matrix",stream_matches(A,2));
+    tester.test("Matrix, no prefetching",stream_matches(A,0));
+    EigenTensor<3,double> B(std::array<size_t,3>{4,3,6});
+    fill_random(B);
+    tester.test("Rank 3 tensor",stream_matches(B,4));
+
+    BlockStream<2,double,detail_::TensorTypes::EigenMatrix> stream(A);
+    tester.test("One block",stream.blocks().size()==1);
+    auto first=stream.begin();
+    tester.test("Block shape",(*first).shape.dims()==
+                              std::array<size_t,2>({7,5}));
+    tester.test("Stream ends",++first==stream.end());
+    return tester.results();
+}
@@ -0,0 +1,68 @@
+#include <TensorWrapper/CompressedBuffer.hpp>
+#include "TestHelpers.hpp"
+#include <random>
+#include <vector>
+using namespace TWrapper;
+using detail_::CompressedBuffer;
+
+template<typename T>
+std::vector<T> round_trip(const CompressedBuffer<T>& buffer)
+{
+    std::vector<T> rv(buffer.size());
+    buffer.decompress(rv.data());
+    return rv;
+}
+
+int main()
+{
+    Tester tester("Testing CompressedBuffer class");
+
+    //More than one block and not a multiple of the block size
+    const size_t n=2*CompressedBuffer<double>::block_size+17;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> dis(-10,10);
+    std::vector<double> random(n);
+    for(auto& x: random)x=dis(gen);
+
+    CompressedBuffer<double> lossless(random.data(),n);
+    tester.test("Size",lossless.size()==n);
+    tester.test("Lossless round trip",round_trip(lossless)==random);
+
+    std::vector<double> zeros(n,0.0);
+    CompressedBuffer<double> zero_buffer(zeros.data(),n);
+    tester.test("Zero round trip",round_trip(zero_buffer)==zeros);
+    tester.test("Zero runs are encoded",zero_buffer.nbytes()<n/10);
+
+    std::vector<double> smooth(n);
+    for(size_t i=0;i<n;++i)smooth[i]=1.0+i/double(n);
+    CompressedBuffer<double> smooth_buffer(smooth.data(),n);
+    tester.test("Smooth round trip",round_trip(smooth_buffer)==smooth);
+    tester.test("Smooth data compresses",
+                smooth_buffer.nbytes()<n*sizeof(double));
+
+    const double tol=1.0E-4;
+    CompressedBuffer<double> truncated(random.data(),n,
+                                       Compression::Truncated,tol);
+    auto approx=round_trip(truncated);
+    bool bounded=true;
+    for(size_t i=0;i<n;++i)
+        bounded=bounded && std::fabs(approx[i]-random[i])<=
+                           tol*std::fabs(random[i]);
+    tester.test("Truncation error bounded",bounded);
+    tester.test("Truncation shrinks",truncated.nbytes()<lossless.nbytes());
+
+    CompressedBuffer<double> ignored(random.data(),n,
+                                     Compression::Lossless,tol);
+    tester.test("Tolerance ignored when lossless",
+                round_trip(ignored)==random);
+
+    std::vector<float> floats(100);
+    for(auto& x: floats)x=static_cast<float>(dis(gen));
+    CompressedBuffer<float> float_buffer(floats.data(),floats.size());
+    tester.test("Float round trip",round_trip(float_buffer)==floats);
+
+    CompressedBuffer<double> empty(nullptr,0);
+    tester.test("Empty buffer",empty.size()==0 && empty.nbytes()==0);
+
+    return tester.results();
+}
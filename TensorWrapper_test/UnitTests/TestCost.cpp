@@ -0,0 +1,74 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+
+using namespace TWrapper;
+
+int main()
+{
+    Tester tester("Testing the cost estimates of expressions");
+    const size_t m=3,n=4,p=5;
+    const double w=sizeof(double);
+    EigenMatrix<double> A(std::array<size_t,2>{m,p},1.0),
+                        B(std::array<size_t,2>{p,n},1.0),
+                        C(std::array<size_t,2>{m,n},1.0),
+                        D(std::array<size_t,2>{n,m},1.0),
+                        S(std::array<size_t,2>{n,n},1.0);
+    EigenTensor<3,double> T(std::array<size_t,3>{n,n,m},1.0);
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+
+    const auto contract=A(i,k)*B(k,j);
+    tester.test("Contraction FLOPs",contract.flops()==2.0*m*n*p);
+    tester.test("Contraction bytes",contract.bytes()==w*(m*p+p*n+m*n));
+
+    const auto add=C(i,j)+C(i,j);
+    tester.test("Addition FLOPs",add.flops()==m*n);
+    tester.test("Addition bytes",add.bytes()==3*w*m*n);
+
+    const auto subtract=C(i,j)-C(i,j);
+    tester.test("Subtraction FLOPs",subtract.flops()==m*n);
+    tester.test("Subtraction bytes",subtract.bytes()==3*w*m*n);
+
+    const auto scale=C(i,j)*2.0;
+    tester.test("Scale FLOPs",scale.flops()==m*n);
+    tester.test("Scale bytes",scale.bytes()==2*w*m*n);
+
+    const auto trace=S(i,i);
+    tester.test("Trace FLOPs",trace.flops()==n);
+    tester.test("Trace bytes",trace.bytes()==w*(n+1));
+    const auto partial=T(i,i,j);
+    tester.test("Partial trace FLOPs",partial.flops()==n*m);
+
+    //Named tensors cost nothing
+    tester.test("Indexed tensor",C(i,j).flops()==0.0 && C(i,j).bytes()==0.0);
+
+    //Adding a transposed tensor permutes inside the backend
+    auto c=cost(C(i,j)+D(j,i));
+    tester.test("Transposed operand",c.flops==m*n && c.bytes==3*w*m*n &&
+                                     c.noperations==1);
+
+    //A permutation moves elements without FLOPs
+    using idx_ij=decltype(C(i,j))::indices;
+    using idx_ji=decltype(D(j,i))::indices;
+    using dji_t=decltype(D(j,i));
+    const detail_::Permutation<idx_ij,idx_ji,dji_t> permute(D(j,i));
+    c=cost(permute);
+    tester.test("Permutation",c.flops==0.0 && c.bytes==2*w*m*n &&
+                              c.noperations==1);
+    const detail_::Permutation<idx_ji,idx_ji,dji_t> same(D(j,i));
+    tester.test("Null permutation",cost(same).bytes==0.0 &&
+                                   cost(same).noperations==0);
+
+    c=cost(A(i,k)*B(k,j)+C(i,j));
+    tester.test("Expression FLOPs",c.flops==2.0*m*n*p+m*n);
+    tester.test("Expression bytes",
+                c.bytes==w*(m*p+p*n+m*n)+3*w*m*n);
+    tester.test("Expression operations",c.noperations==2);
+    tester.test("Arithmetic intensity",
+                std::fabs(c.intensity()-c.flops/c.bytes)<1E-12);
+
+    tester.test("No operations",cost(C(i,j)).noperations==0 &&
+                                cost(C(i,j)).intensity()==0.0);
+    return tester.results();
+}
@@ -0,0 +1,323 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+
+//The distributed backend only exists when TensorWrapper is built with MPI
+#ifdef ENABLE_DISTRIBUTED
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+using eigen_matrix=Eigen::MatrixXd;
+using row_major=Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,
+                              Eigen::RowMajor>;
+
+template<size_t R>
+using dist_t=DistributedTensor<R,double>;
+
+template<size_t R>
+using impl_t=TensorWrapperImpl<R,double,TensorTypes::Distributed>;
+
+//Elements are made from their indices so every rank agrees on them
+template<size_t R>
+double value(const std::array<size_t,R>& idx)
+{
+    double rv=0.0;
+    for(size_t x : idx)rv=rv*7.0+x+1.0;
+    return std::sin(rv);
+}
+
+template<size_t R>
+void fill(dist_t<R>& t)
+{
+    t.for_each_local([](const std::array<size_t,R>& idx,double& x){
+        x=value(idx);
+    });
+}
+
+//Gathers a distributed matrix into an Eigen matrix on every rank
+eigen_matrix to_eigen(const dist_t<2>& t)
+{
+    const auto elements=t.gather();
+    return Eigen::Map<const row_major>(elements.data(),t.dims()[0],
+                                       t.dims()[1]);
+}
+
+int main(int argc, char** argv)
+{
+    RunTime rt(argc,argv);
+    int nprocs;
+    MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+    Tester tester("Testing native distributed backend on "+
+                  std::to_string(nprocs)+" processes");
+    const size_t dim=13;
+    const std::array<size_t,2> shape{dim,dim};
+    const std::array<size_t,3> tshape{dim,dim-4,dim-2};
+    impl_t<2> impl;
+    impl_t<3> timpl;
+
+    //Layout
+    dist_t<2> A=impl.allocate(shape);
+    tester.test("Matrix shape",impl.dims(A)==Shape<2>(shape,true));
+    unsigned long nlocal=A.local_size(),ntotal=0;
+    MPI_Allreduce(&nlocal,&ntotal,1,MPI_UNSIGNED_LONG,MPI_SUM,MPI_COMM_WORLD);
+    tester.test("Every element is held once",ntotal==dim*dim);
+
+    //Get/Set Memory
+    auto mem=impl.get_memory(A);
+    size_t counter=0;
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        size_t n=0;
+        for(auto idx=mem.begin(i);idx!=mem.end(i);++idx,++counter)
+            mem.block(i)[mem.offset(i,n++,*idx)]=value(*idx);
+    }
+    impl.set_memory(A,mem);
+    tester.test("Get memory covers local elements",counter==A.local_size());
+    eigen_matrix dA(dim,dim);
+    for(size_t i=0;i<dim;++i)
+        for(size_t j=0;j<dim;++j)dA(i,j)=value(std::array<size_t,2>{i,j});
+    tester.test("Set memory",to_eigen(A)==dA);
+
+    //Only rank 0 writes, so nearly every element is a remote write
+    int me;
+    MPI_Comm_rank(MPI_COMM_WORLD,&me);
+    dist_t<2> B=impl.allocate(shape);
+    MemoryBlock<2,double> remote;
+    if(me==0)
+    {
+        double* buffer=remote.allocate_block(shape);
+        size_t n=0;
+        for(auto idx=remote.begin(0);idx!=remote.end(0);++idx)
+            buffer[remote.offset(0,n++,*idx)]=2.0*value(*idx);
+    }
+    impl.set_memory(B,remote);
+    const eigen_matrix dB=to_eigen(B);
+    tester.test("Remote set memory",dB==2.0*dA);
+
+    //Every rank writes every element
+    dist_t<2> C=impl.allocate(shape);
+    MemoryBlock<2,double> everything;
+    everything.add_block(const_cast<double*>(dB.data()),
+                         Shape<2>(shape,false));
+    impl.set_memory(C,everything);
+    tester.test("Replicated set memory",to_eigen(C)==dB);
+    dist_t<2> sum=impl.allocate(shape);
+    accumulate_memory(impl,sum,everything);
+    accumulate_memory(impl,sum,everything);
+    tester.test("Accumulate memory",
+                to_eigen(sum).isApprox(2.0*nprocs*dB));
+
+    //Redistribution between layouts, as done between distributed backends
+    dist_t<2> cols({dim,dim},{1,static_cast<size_t>(nprocs)},{5,2});
+    auto from=impl.get_memory(A);
+    auto to=local_memory(impl,cols);
+    redistribute(from,to,MPI_COMM_WORLD);
+    impl.set_memory(cols,to);
+    tester.test("Redistribute",to_eigen(cols)==dA);
+    MemoryBlock<2,double> tile;
+    if(me==nprocs-1)//One rank holds all of the source
+        tile.add_block(const_cast<double*>(dB.data()),Shape<2>(shape,false));
+    auto to2=impl.get_memory(cols);
+    redistribute(tile,to2,MPI_COMM_WORLD);
+    impl.set_memory(cols,to2);
+    tester.test("Redistribute from one rank",to_eigen(cols)==dB);
+    dist_t<2> part=impl.allocate({7,2});
+    auto to3=local_memory(impl,part);
+    redistribute(clip_blocks(impl.get_memory(A),{2,3},{9,5}),to3,
+                 MPI_COMM_WORLD);
+    impl.set_memory(part,to3);
+    tester.test("Redistribute part",to_eigen(part)==dA.block(2,3,7,2));
+    dist_t<2> copy=impl.allocate(shape);
+    CopyElements<TensorTypes::Distributed,TensorTypes::Distributed,
+                 CopyStrategy::Redistribute>::eval(impl,copy,impl,A);
+    tester.test("Copy elements",to_eigen(copy)==dA);
+    //Tensors over different ranks can't exchange elements
+    MPI_Comm halves;
+    MPI_Comm_split(MPI_COMM_WORLD,me%2,me,&halves);
+    {
+        dist_t<2> half(shape,halves);
+        bool threw=false;
+        try{common_comm(impl,half,impl,A);}
+        catch(const std::invalid_argument&){threw=true;}
+        tester.test("Different communicators",threw==(nprocs>1));
+    }
+    MPI_Comm_free(&halves);
+
+    //Permutations and slices
+    dist_t<3> T3=timpl.allocate(tshape);
+    fill(T3);
+    dist_t<3> T4=timpl.permute(T3,{2,0,1});
+    bool all_good=T4.dims()==std::array<size_t,3>{dim-4,dim-2,dim};
+    const auto T4_elements=T4.gather();
+    const Shape<3> T4_shape(T4.dims());
+    for(const auto& idx : T4_shape)
+        all_good=all_good && T4_elements[T4_shape.flat_index(idx)]==
+                value(std::array<size_t,3>{idx[2],idx[0],idx[1]});
+    tester.test("Rank 3 permute",all_good);
+    dist_t<2> D=impl.slice(A,{2,3},{9,5});
+    tester.test("Slice",to_eigen(D)==dA.block(2,3,7,2));
+    const Distributed<2,double> wA(A);
+    tester.test("Element access",wA(7,11)==dA(7,11));
+
+    //Streaming every tile, fetching the next three ahead
+    Distributed<2,double> sA(A);
+    size_t nseen=0;
+    all_good=true;
+    {
+        BlockStream<2,double,TensorTypes::Distributed> stream(sA,3);
+        for(auto block : stream)
+            for(const auto& idx : block.shape)
+            {
+                ++nseen;
+                all_good=all_good &&
+                         block.data[block.shape.offset(idx)]==value(idx);
+            }
+    }
+    tester.test("Block stream",all_good && nseen==dim*dim);
+
+    //Equality
+    tester.test("A==A",impl.are_equal(A,A));
+    tester.test("A!=B",!impl.are_equal(A,B));
+    dist_t<2> odd({dim,dim},{static_cast<size_t>(nprocs),1},{1,3});
+    fill(odd);
+    tester.test("Equal with different layouts",impl.are_equal(A,odd));
+
+    //Addition, subtraction, and scaling
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    auto l=make_index("l");
+    using idx_i=make_indices<decltype(i)>;
+    using idx_j=make_indices<decltype(j)>;
+    using idx_ii=make_indices<decltype(i),decltype(i)>;
+    using idx_ij=make_indices<decltype(i),decltype(j)>;
+    using idx_ji=make_indices<decltype(j),decltype(i)>;
+    using idx_jk=make_indices<decltype(j),decltype(k)>;
+    using idx_kj=make_indices<decltype(k),decltype(j)>;
+    using idx_ijk=make_indices<decltype(i),decltype(j),decltype(k)>;
+    using idx_kl=make_indices<decltype(k),decltype(l)>;
+    dist_t<2> E=impl.eval<idx_ij>(impl.add<idx_ij,idx_ij>(A,B),shape);
+    tester.test("A+B",to_eigen(E)==dA+dB);
+    E=impl.add<idx_ij,idx_ij>(A,odd);
+    tester.test("A+B with different layouts",to_eigen(E)==2.0*dA);
+    E=impl.add<idx_ij,idx_ji>(A,B);
+    tester.test("A+B^T",to_eigen(E)==dA+dB.transpose());
+    E=impl.subtract<idx_ij,idx_ji>(A,B);
+    tester.test("A-B^T",to_eigen(E)==dA-dB.transpose());
+    E=impl.scale<idx_ij>(A,0.5);
+    tester.test("Scale",to_eigen(E)==0.5*dA);
+    tester.test("Trace",std::fabs(impl.trace<idx_ii>(A)-dA.trace())<1E-10);
+
+    //Contractions
+    E=impl.contraction<idx_ij,idx_jk>(A,B);
+    tester.test("A * B",to_eigen(E).isApprox(dA*dB));
+    E=impl.contraction<idx_ij,idx_kj>(A,B);
+    tester.test("A * B^T",to_eigen(E).isApprox(dA*dB.transpose()));
+    E=impl.contraction<idx_ji,idx_jk>(A,B);
+    tester.test("A^T * B",to_eigen(E).isApprox(dA.transpose()*dB));
+    dist_t<1> x({dim}),y({5});
+    fill(x);
+    fill(y);
+    E=impl_t<1>().contraction<idx_i,idx_j>(x,y);
+    eigen_matrix outer(dim,5);
+    for(size_t p=0;p<dim;++p)
+        for(size_t q=0;q<5;++q)
+            outer(p,q)=value(std::array<size_t,1>{p})*
+                       value(std::array<size_t,1>{q});
+    tester.test("x(i) * y(j)",to_eigen(E).isApprox(outer));
+    double s=impl.contraction<idx_ij,idx_ij>(A,B);
+    tester.test("A(i,j) * B(i,j)",
+                std::fabs(s-dA.cwiseProduct(dB).sum())<1E-10);
+    s=impl.contraction<idx_ij,idx_ji>(A,B);
+    tester.test("A(i,j) * B(j,i)",
+                std::fabs(s-dA.cwiseProduct(dB.transpose()).sum())<1E-10);
+
+    //T(i,j,k) * C(k,l) -> D(i,j,l) and T(i,j,k) * C(j,k) -> v(i)
+    const auto T3_elements=T3.gather();
+    const Shape<3> T3_shape(tshape);
+    auto t3=[&](size_t p, size_t q, size_t r){
+        return T3_elements[T3_shape.flat_index(std::array<size_t,3>{p,q,r})];
+    };
+    dist_t<2> M=impl.allocate({tshape[2],5});
+    fill(M);
+    const eigen_matrix dM=to_eigen(M);
+    dist_t<3> T5=timpl.contraction<idx_ijk,idx_kl>(T3,M);
+    const auto T5_elements=T5.gather();
+    all_good=T5.dims()==std::array<size_t,3>{tshape[0],tshape[1],5};
+    for(size_t p=0;p<tshape[0];++p)
+        for(size_t q=0;q<tshape[1];++q)
+            for(size_t r=0;r<5;++r)
+            {
+                double corr=0.0;
+                for(size_t m=0;m<tshape[2];++m)corr+=t3(p,q,m)*dM(m,r);
+                all_good=all_good &&
+                    std::fabs(T5_elements[(p*tshape[1]+q)*5+r]-corr)<1E-10;
+            }
+    tester.test("T(i,j,k) * C(k,l)",all_good);
+    dist_t<2> N=impl.allocate({tshape[1],tshape[2]});
+    fill(N);
+    const eigen_matrix dN=to_eigen(N);
+    dist_t<1> v=timpl.contraction<idx_ijk,idx_jk>(T3,N);
+    const auto v_elements=v.gather();
+    all_good=true;
+    for(size_t p=0;p<tshape[0];++p)
+    {
+        double corr=0.0;
+        for(size_t q=0;q<tshape[1];++q)
+            for(size_t r=0;r<tshape[2];++r)corr+=t3(p,q,r)*dN(q,r);
+        all_good=all_good && std::fabs(v_elements[p]-corr)<1E-10;
+    }
+    tester.test("T(i,j,k) * C(j,k)",all_good);
+
+    //Public API and conversions
+    EigenMatrix<double> eA(dA),eB(dB);
+    Distributed<2,double> pA(eA),pB(eB);
+    tester.test("Eigen to distributed",impl.are_equal(pA.data(),A));
+    EigenMatrix<double> back(pA);
+    tester.test("Distributed to Eigen",back.data()==dA);
+    Distributed<2,double> pC=pA(i,j)*pB(j,k);
+    tester.test("Public API A*B",to_eigen(pC.data()).isApprox(dA*dB));
+    pC=pA(i,j)+pB(j,i);
+    tester.test("Public API A+B^T",to_eigen(pC.data())==dA+dB.transpose());
+    Distributed<2,double> filled(shape,3.0);
+    tester.test("Value constructor",to_eigen(filled.data())==
+                                    eigen_matrix::Constant(dim,dim,3.0));
+
+    Distributed<2,double> compressed(pA);
+    compressed.compress();
+    tester.test("Compression",impl.are_equal(compressed.data(),A));
+
+    //Self-adjoint Eigen solver
+    eigen_matrix L=dA+dA.transpose();
+    Eigen::SelfAdjointEigenSolver<eigen_matrix> solver(L);
+    Distributed<2,double> pL=pA(i,j)+pA(j,i);
+    auto eigen_sys=self_adjoint_eigen_solver(pL);
+    const auto evals=eigen_sys.first.data().gather();
+    tester.test("Eigenvalues",are_same(evals,solver.eigenvalues()));
+
+    //Padded, aligned local arrays
+    RunTime::set_padding(true);
+    Distributed<2,double> qA(eA),qB(eB);
+    RunTime::set_padding(false);
+    const dist_t<2>& padded=qA.data();
+    tester.test("Padded local array",padded.padded() &&
+                (!padded.local_size() || padded.local_strides()[0]==
+                    padded_length<double>(padded.local_dims()[1])));
+    tester.test("Aligned local array",
+                reinterpret_cast<std::uintptr_t>(padded.data())%
+                RunTime::alignment()==0);
+    tester.test("Padded set memory",to_eigen(padded)==dA);
+    pC=qA(i,j)*qB(j,k);
+    tester.test("Padded A*B",to_eigen(pC.data()).isApprox(dA*dB));
+    pC=qA(i,j)+pB(j,i);
+    tester.test("Padded A+B^T",to_eigen(pC.data())==dA+dB.transpose());
+    tester.test("Padded equality",impl.are_equal(qA.data(),A));
+
+    return tester.results();
+}
+#else
+int main()
+{
+    Tester tester("Testing native distributed backend");
+    return tester.results();
+}
+#endif
@@ -62,6 +62,20 @@ int main()
     simpl.set_memory(sA,smem);
     tester.test("Scalar Set Memory",sA==999.0);
 
+    //Set Memory from a padded, row-major block
+    detail_::buffer_options().pad=true;
+    MemoryBlock<2,double> padded;
+    double* buffer=padded.allocate_block(shape);
+    for(size_t r=0;r<dim;++r)
+        for(size_t c=0;c<dim;++c)
+            buffer[padded.shape(0).offset(std::array<size_t,2>{r,c})]=r*dim+c;
+    detail_::buffer_options().pad=false;
+    eigen_matrix from_padded=impl.allocate(shape);
+    impl.set_memory(from_padded,padded);
+    tester.test("Block is padded",!padded.shape(0).is_contiguous());
+    tester.test("Padded Set Memory",
+                from_padded(3,7)==37.0 && from_padded(9,0)==90.0);
+
     //Slice
     eigen_matrix slice=impl.slice(A,{2,1},{3,3});
     tester.test("Matrix slice",slice(0,0)==A(2,1));
@@ -0,0 +1,260 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+using eigen_matrix=Eigen::MatrixXd;
+using eigen_vector=Eigen::VectorXd;
+using sparse_matrix=Eigen::SparseMatrix<double,Eigen::RowMajor>;
+using sparse_vector=Eigen::SparseVector<double>;
+using sparse_tensor=EigenSparseTensor<3,double>;
+
+template<size_t R>
+using impl_t=TensorWrapperImpl<R,double,TensorTypes::EigenSparse>;
+
+//Makes a random matrix with roughly 30% of its elements nonzero
+eigen_matrix random_sparse(size_t rows, size_t cols)
+{
+    eigen_matrix rv=eigen_matrix::Random(rows,cols);
+    return rv.unaryExpr([](double x){return std::fabs(x)<0.7 ? 0.0 : x;});
+}
+
+int main()
+{
+    Tester tester("Testing wrapping of Eigen's sparse matrices");
+    const size_t dim=10;
+    const std::array<size_t,2> shape({dim,dim});
+    const std::array<size_t,1> vshape({dim});
+    const std::array<size_t,3> tshape({dim,dim,dim});
+    eigen_matrix dA=random_sparse(dim,dim),
+                 dB=random_sparse(dim,dim),
+                 dC=random_sparse(dim,dim);
+    eigen_vector dvA=random_sparse(dim,1),
+                 dvB=random_sparse(dim,1);
+    sparse_matrix A=dA.sparseView(),B=dB.sparseView(),C=dC.sparseView();
+    sparse_vector vA=dvA.sparseView(),vB=dvB.sparseView();
+    impl_t<2> impl;
+    impl_t<1> vimpl;
+    impl_t<3> timpl;
+
+    //Dimensions
+    tester.test("Matrix shape",impl.dims(A)==Shape<2>(shape,true));
+    tester.test("Vector shape",vimpl.dims(vA)==Shape<1>(vshape,true));
+
+    //Get Memory
+    auto mem=impl.get_memory(A);
+    tester.test("Matrix NBlocks",mem.nblocks()==1);
+    tester.test("Matrix pointer",mem.block(0)==A.valuePtr());
+    size_t counter=0;
+    bool all_good=true;
+    for(auto idx=mem.begin(0);idx!=mem.end(0);++idx)
+        all_good=all_good && dA((*idx)[0],(*idx)[1])==mem.block(0)[counter++];
+    tester.test("Matrix nonzero indices",all_good);
+    tester.test("Matrix number of nonzeros",counter==(size_t)A.nonZeros());
+    auto vmem=vimpl.get_memory(vA);
+    tester.test("Vector pointer",vmem.block(0)==vA.valuePtr());
+    counter=0;
+    for(auto idx=vmem.begin(0);idx!=vmem.end(0);++idx)++counter;
+    tester.test("Vector number of nonzeros",counter==(size_t)vA.nonZeros());
+
+    //Set Memory
+    const auto first=*mem.begin(0);
+    mem.block(0)[0]=999.0;
+    impl.set_memory(A,mem);
+    tester.test("Matrix Set Memory",A.coeff(first[0],first[1])==999.0);
+    dA(first[0],first[1])=999.0;
+    sparse_matrix from_dense=impl.allocate(shape);
+    TensorWrapperImpl<2,double,TensorTypes::EigenMatrix> dense_impl;
+    impl.set_memory(from_dense,dense_impl.get_memory(dA));
+    tester.test("Set Memory from dense",impl.are_equal(from_dense,A));
+    tester.test("Set Memory keeps sparsity",
+                from_dense.nonZeros()==A.nonZeros());
+
+    //Slice
+    sparse_matrix slice=impl.slice(A,{2,1},{5,4});
+    tester.test("Matrix slice",
+                eigen_matrix(slice)==dA.block(2,1,3,3));
+    sparse_vector vslice=vimpl.slice(vA,{2},{6});
+    tester.test("Vector slice",eigen_vector(vslice)==dvA.segment(2,4));
+
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    auto l=make_index("l");
+    using idx_i=make_indices<decltype(i)>;
+    using idx_ii=make_indices<decltype(i),decltype(i)>;
+    using idx_j=make_indices<decltype(j)>;
+    using idx_ij=make_indices<decltype(i),decltype(j)>;
+    using idx_ji=make_indices<decltype(j),decltype(i)>;
+    using idx_jk=make_indices<decltype(j),decltype(k)>;
+    using idx_ik=make_indices<decltype(i),decltype(k)>;
+    using idx_kj=make_indices<decltype(k),decltype(j)>;
+    using idx_ijk=make_indices<decltype(i),decltype(j),decltype(k)>;
+    using idx_ikj=make_indices<decltype(i),decltype(k),decltype(j)>;
+    using idx_kl=make_indices<decltype(k),decltype(l)>;
+    using idx_jkl=make_indices<decltype(j),decltype(k),decltype(l)>;
+
+    //Addition and subtraction
+    sparse_matrix D=impl.eval<idx_ij>(impl.add<idx_ij,idx_ij>(A,B),shape);
+    tester.test("Matrix A+B",eigen_matrix(D)==dA+dB);
+    D=impl.eval<idx_ij>(impl.add<idx_ij,idx_ji>(A,B),shape);
+    tester.test("Matrix A+B^T",eigen_matrix(D)==dA+dB.transpose());
+    D=impl.eval<idx_ij>(impl.subtract<idx_ij,idx_ji>(A,B),shape);
+    tester.test("Matrix A-B^T",eigen_matrix(D)==dA-dB.transpose());
+    sparse_vector vD=vimpl.eval<idx_i>(vimpl.add<idx_i,idx_i>(vA,vB),vshape);
+    tester.test("Vector A+B",eigen_vector(vD)==dvA+dvB);
+
+    //Scaling
+    D=impl.eval<idx_ij>(impl.scale<idx_ij>(A,0.5),shape);
+    tester.test("Matrix scale",eigen_matrix(D)==dA*0.5);
+
+    //Trace
+    tester.test("Trace of A",impl.trace<idx_ii>(A)==dA.trace());
+
+    //SpGEMM
+    D=impl.eval<idx_ik>(impl.contraction<idx_ij,idx_jk>(A,B),shape);
+    tester.test("Matrix A * B",eigen_matrix(D).isApprox(dA*dB));
+    D=impl.eval<idx_ik>(impl.contraction<idx_ij,idx_kj>(A,B),shape);
+    tester.test("Matrix A * B^T",eigen_matrix(D).isApprox(dA*dB.transpose()));
+    D=impl.eval<idx_ik>(impl.contraction<idx_ji,idx_jk>(A,B),shape);
+    tester.test("Matrix A^T * B",eigen_matrix(D).isApprox(dA.transpose()*dB));
+    D=impl.eval<idx_ik>(impl.contraction<idx_ji,idx_kj>(A,B),shape);
+    tester.test("Matrix A^T * B^T",
+                eigen_matrix(D).isApprox(dA.transpose()*dB.transpose()));
+    D=impl.eval<idx_kl>(impl.contraction<idx_ik,idx_kl>(
+                        impl.contraction<idx_ji,idx_jk>(A,B),C),shape);
+    tester.test("Matrix A^T * B * C",
+                eigen_matrix(D).isApprox(dA.transpose()*dB*dC));
+    double s=impl.contraction<idx_ij,idx_ij>(A,B);
+    tester.test("A(i,j) * B(i,j)",
+                std::fabs(s-dA.cwiseProduct(dB).sum())<1E-10);
+    s=impl.contraction<idx_ij,idx_ji>(A,B);
+    tester.test("A(i,j) * B(j,i)",
+         std::fabs(s-dA.cwiseProduct(dB.transpose()).sum())<1E-10);
+
+    //SpMM (sparse-dense)
+    D=impl.eval<idx_ik>(impl.contraction<idx_ij,idx_jk>(A,dB),shape);
+    tester.test("Sparse A * dense B",eigen_matrix(D).isApprox(dA*dB));
+    D=impl.eval<idx_ik>(impl.contraction<idx_ij,idx_jk>(dA,B),shape);
+    tester.test("Dense A * sparse B",eigen_matrix(D).isApprox(dA*dB));
+
+    //Matrix/vector
+    vD=vimpl.eval<idx_i>(impl.contraction<idx_ij,idx_j>(A,vB),vshape);
+    tester.test("A(i,j) * B(j)",eigen_vector(vD).isApprox(dA*dvB));
+    vD=vimpl.eval<idx_i>(impl.contraction<idx_ji,idx_j>(A,vB),vshape);
+    tester.test("A(j,i) * B(j)",
+                eigen_vector(vD).isApprox(dA.transpose()*dvB));
+    vD=vimpl.eval<idx_j>(vimpl.contraction<idx_i,idx_ij>(vA,B),vshape);
+    tester.test("A(i) * B(i,j)",
+                eigen_vector(vD).isApprox(dB.transpose()*dvA));
+    s=vimpl.contraction<idx_i,idx_i>(vA,vB);
+    tester.test("Vector A^T * B",std::fabs(s-dvA.dot(dvB))<1E-10);
+    D=impl.eval<idx_ij>(vimpl.contraction<idx_i,idx_j>(vA,vB),shape);
+    tester.test("Vector A * B^T",
+                eigen_matrix(D).isApprox(dvA*dvB.transpose()));
+
+    //Rank 3 tensors
+    sparse_tensor T3=timpl.allocate(tshape);
+    MemoryBlock<3,double> tmem;
+    std::unique_ptr<double[]> buffer(new double[dim*dim*dim]);
+    Shape<3> full_shape(tshape);
+    counter=0;
+    for(const auto& idx : full_shape)
+    {
+        const bool nonzero=(idx[0]+2*idx[1]+idx[2])%5==0;
+        buffer[counter++]=(nonzero ? 1.0+idx[0]-0.5*idx[1]+0.1*idx[2] : 0.0);
+    }
+    tmem.add_block(std::move(buffer),full_shape);
+    timpl.set_memory(T3,tmem);
+    tester.test("Rank 3 shape",timpl.dims(T3)==Shape<3>(tshape,true));
+    counter=0;
+    all_good=true;
+    auto T3mem=timpl.get_memory(T3);
+    for(auto idx=T3mem.begin(0);idx!=T3mem.end(0);++idx)
+        all_good=all_good && T3mem.block(0)[counter++]==
+                        tmem.block(0)[full_shape.flat_index(*idx)];
+    tester.test("Rank 3 nonzeros",
+                all_good && counter==(size_t)T3.matrix.nonZeros());
+
+    auto value=[&](size_t p, size_t q, size_t r){
+        return tmem.block(0)[full_shape.flat_index(std::array<size_t,3>{p,q,r})];
+    };
+
+    //B(i,j,k) * C(k,l) -> D(i,j,l) with C sparse and dense
+    sparse_tensor T4=timpl.eval<idx_ijk>(
+                timpl.contraction<idx_ijk,idx_kl>(T3,C),tshape);
+    sparse_tensor T5=timpl.eval<idx_ijk>(
+                timpl.contraction<idx_ijk,idx_kl>(T3,dC),tshape);
+    all_good=true;
+    for(size_t p=0;p<dim;++p)
+        for(size_t q=0;q<dim;++q)
+            for(size_t r=0;r<dim;++r)
+            {
+                double corr=0.0;
+                for(size_t x=0;x<dim;++x)corr+=value(p,q,x)*dC(x,r);
+                const size_t flat=p*dim*dim+q*dim+r;
+                all_good=all_good &&
+                        std::fabs(T4.matrix.coeff(p,flat%(dim*dim))-corr)<1E-10;
+                all_good=all_good &&
+                        std::fabs(T5.matrix.coeff(p,flat%(dim*dim))-corr)<1E-10;
+            }
+    tester.test("B(i,j,k) * C(k,l)",all_good);
+
+    //B(i,j,k) * C(j,k) -> v(i)
+    vD=timpl.contraction<idx_ijk,idx_jk>(T3,C);
+    all_good=true;
+    for(size_t p=0;p<dim;++p)
+    {
+        double corr=0.0;
+        for(size_t q=0;q<dim;++q)
+            for(size_t r=0;r<dim;++r)corr+=value(p,q,r)*dC(q,r);
+        all_good=all_good && std::fabs(vD.coeff(p)-corr)<1E-10;
+    }
+    tester.test("B(i,j,k) * C(j,k)",all_good);
+
+    //B(i,j,k) * B(j,k,l) -> D(i,l)
+    D=timpl.contraction<idx_ijk,idx_jkl>(T3,T3);
+    all_good=true;
+    for(size_t p=0;p<dim;++p)
+        for(size_t r=0;r<dim;++r)
+        {
+            double corr=0.0;
+            for(size_t x=0;x<dim;++x)
+                for(size_t y=0;y<dim;++y)corr+=value(p,x,y)*value(x,y,r);
+            all_good=all_good && std::fabs(D.coeff(p,r)-corr)<1E-10;
+        }
+    tester.test("B(i,j,k) * B(j,k,l)",all_good);
+
+    //Permutation and addition of rank 3 tensors
+    sparse_tensor T6=timpl.permute(T3,idx_ijk::get_map(idx_ikj()));
+    tester.test("Rank 3 permute",T6.matrix.coeff(0,3*dim+1)==value(0,1,3));
+    sparse_tensor T7=timpl.add<idx_ijk,idx_ikj>(T3,T6);
+    tester.test("Rank 3 A(i,j,k)+B(i,k,j)",
+                timpl.are_equal(T7,timpl.scale<idx_ijk>(T3,2.0)));
+    sparse_tensor T8=timpl.slice(T3,{0,1,3},{1,2,4});
+    tester.test("Rank 3 slice",
+                T8.matrix.coeff(0,0)==value(0,1,3) && T8.dims[2]==1);
+
+    //Conversions to and from dense backends
+    EigenMatrix<double> dense_A(dA);
+    EigenSparse<2,double> sparse_A(dense_A);
+    tester.test("Dense to sparse",impl.are_equal(sparse_A.data(),A));
+    EigenMatrix<double> dense_again(sparse_A);
+    tester.test("Sparse to dense",dense_again.data()==dA);
+    tester.test("Element access",sparse_A(first[0],first[1])==999.0);
+
+    //Public API
+    EigenSparse<2,double> sparse_B(B);
+    EigenSparse<2,double> sparse_D=sparse_A(i,j)*sparse_B(j,k);
+    tester.test("Public API A*B",eigen_matrix(sparse_D.data()).isApprox(dA*dB));
+
+    //Self-adjoint Eigen solver
+    eigen_matrix L(2,2);
+    L<<1, 2, 2, 3;
+    Eigen::SelfAdjointEigenSolver<eigen_matrix> solver(L);
+    auto eigen_sys=impl.self_adjoint_eigen_solver(sparse_matrix(L.sparseView()));
+    tester.test("Eigenvalues",
+                eigen_vector(eigen_sys.first).isApprox(solver.eigenvalues()));
+
+    return tester.results();
+}
@@ -0,0 +1,65 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <stdexcept>
+#include <vector>
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+template<size_t R, TensorTypes TT>
+bool same(const TensorWrapper<R,double,TT>& lhs,
+          const TensorWrapper<R,double,TT>& rhs)
+{
+    return TensorWrapperImpl<R,double,TT>().are_equal(lhs.data(),rhs.data());
+}
+
+int main()
+{
+    Tester tester("Testing asynchronous evaluation");
+
+    //The pool itself
+    ThreadPool pool(3);
+    tester.test("Pool size",pool.size()==3);
+    std::vector<std::future<size_t>> squares;
+    for(size_t i=0;i<20;++i)
+        squares.push_back(pool.submit([i](){return i*i;}));
+    bool all_good=true;
+    for(size_t i=0;i<20;++i)all_good=all_good && squares[i].get()==i*i;
+    tester.test("Pool runs every task",all_good);
+    auto bad=pool.submit([]()->int{throw std::runtime_error("Bad task");});
+    bool caught=false;
+    try{bad.get();}
+    catch(const std::runtime_error&){caught=true;}
+    tester.test("Pool forwards exceptions",caught);
+    tester.test("Shared pool has threads",thread_pool().size()>=1);
+
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    auto l=make_index("l");
+    auto m=make_index("m");
+
+    //Matrices
+    EigenMatrix<double> A({10,10}),B({10,10});
+    fill_random(A);
+    fill_random(B);
+    auto fAB=eval_async<EigenMatrix<double>>(A(i,k)*B(k,j));
+    auto fApB=eval_async<EigenMatrix<double>>(A(i,j)+B(j,i));
+    EigenMatrix<double> AB=A(i,k)*B(k,j),ApB=A(i,j)+B(j,i);
+    tester.test("Async A*B",fAB.get().data().isApprox(AB.data()));
+    tester.test("Async A+B^T",same(fApB.get(),ApB));
+
+    //Rank 4 tensors, as in the CCSD residual
+    EigenTensor<4,double> u({4,4,4,4}),G({4,4,4,4});
+    fill_random(u);
+    fill_random(G);
+    std::vector<std::future<EigenTensor<2,double>>> terms;
+    for(size_t n=0;n<4;++n)
+        terms.push_back(eval_async<EigenTensor<2,double>>(
+                            u(k,l,i,m)*G(j,m,k,l)));
+    EigenTensor<2,double> corr=u(k,l,i,m)*G(j,m,k,l);
+    all_good=true;
+    for(auto& x : terms)all_good=all_good && same(x.get(),corr);
+    tester.test("Concurrent tensor contractions",all_good);
+
+    return tester.results();
+}
@@ -0,0 +1,62 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <vector>
+using namespace TWrapper;
+
+template<size_t R, typename T, detail_::TensorTypes TT>
+bool all_equal(TensorWrapper<R,T,TT>& t, T value)
+{
+    auto mem=t.get_memory();
+    bool rv=true;
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        const T* buffer=mem.block(i);
+        for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+            rv=rv && *buffer++==value;
+    }
+    return rv;
+}
+
+int main()
+{
+    Tester tester("Testing NUMA-aware first touch");
+
+    const std::vector<AllocationPolicy> policies{AllocationPolicy::Local,
+                                                 AllocationPolicy::Interleave,
+                                                 AllocationPolicy::Partitioned};
+    const std::vector<std::string> names{"Local","Interleave","Partitioned"};
+
+    //Not a whole number of pages
+    const size_t n=3*4096+5;
+    for(size_t p=0;p<policies.size();++p)
+    {
+        std::vector<double> buffer(n,1.0);
+        detail_::first_touch(buffer.data(),n,2.0,policies[p]);
+        tester.test(names[p]+" sets every element",
+                    std::all_of(buffer.begin(),buffer.end(),
+                                [](double x){return x==2.0;}));
+    }
+
+    tester.test("Default policy",
+                RunTime::allocation_policy()==AllocationPolicy::Local);
+    RunTime::set_allocation_policy(AllocationPolicy::Partitioned);
+    tester.test("Set policy",
+                RunTime::allocation_policy()==AllocationPolicy::Partitioned);
+
+    EigenTensor<3,double> zeroed(std::array<size_t,3>{10,20,30});
+    tester.test("Dims constructor zeroes",all_equal(zeroed,0.0));
+
+    EigenMatrix<double> filled(std::array<size_t,2>{10,20},3.0);
+    tester.test("Value constructor",all_equal(filled,3.0));
+
+    EigenSparse<2,double> sparse(std::array<size_t,2>{3,4},1.5);
+    tester.test("Value constructor for sparse",
+                all_equal(sparse,1.5) && sparse(2,3)==1.5);
+
+    RunTime::set_allocation_policy(AllocationPolicy::Local);
+    EigenTensor<2,double> local(std::array<size_t,2>{5,5},4.0);
+    tester.test("Local value constructor",all_equal(local,4.0));
+
+    return tester.results();
+}
@@ -20,7 +20,7 @@ int main()
     fill_random(_B);
     fill_random(_C);
 
-    wrapped_type A=_A.data(),B=_B.data(),C=_C.data();
+    wrapped_type A=_A.data().tensor(),B=_B.data().tensor(),C=_C.data().tensor();
 
     //Dimensions
     Shape<2> corr_shape(dims,true);
@@ -40,11 +40,39 @@ int main()
     tester.test("Matrix Set Memory",corr_elem==999.0);
 
     //Slice
-    wrapped_type slice=impl.slice(A,{2,1},{3,3});
-    auto corr_vals=A.get_values(std::array<size_t,2>{2,1},
-                      std::array<size_t,2>{3,3});
-    vals=slice.get_values(zeros,std::array<size_t,2>{1,2});
+    const index_t start({2,1}),end({3,3}),slice_dims({1,2});
+    auto slice=impl.slice(_B.data(),start,end);
+    tester.test("Slice is a view",slice.is_view());
+    auto corr_vals=B.get_values(start,end);
+    vals=slice.get_values(zeros,slice_dims);
     tester.test("Matrix slice",corr_vals==vals);
+    auto subslice=impl.slice(slice,{0,1},slice_dims);
+    vals=subslice.get_values(zeros,std::array<size_t,2>{1,1});
+    tester.test("Slice of slice",vals[0]==corr_vals[1]);
+    tester.test("Slice equality",impl.are_equal(slice,
+                                 impl.slice(_B.data(),start,end)));
+    const double new_vals[]={-1.0,-2.0};
+    slice.set_values(zeros,slice_dims,new_vals);
+    tester.test("Written slice is materialized",!slice.is_view());
+    tester.test("Writing slice leaves parent",
+                _B.data().get_values(start,end)==corr_vals);
+    tester.test("Write to slice",slice.get_values(zeros,slice_dims)==
+                std::vector<double>({-1.0,-2.0}));
+    //Processes without part of the patch still take part in materializing
+    auto view=impl.slice(_C.data(),start,end);
+    impl.set_memory(view,impl.get_memory(view));
+    tester.test("View round trip",!view.is_view() &&
+                view.get_values(zeros,slice_dims)==C.get_values(start,end));
+    //Accumulating isn't collective, so it can't materialize a view
+    auto acc_view=impl.slice(_C.data(),start,end);
+    const auto contribution=impl.get_memory(acc_view);
+    bool threw=false;
+    try{accumulate_memory(impl,acc_view,contribution);}
+    catch(const std::logic_error&){threw=true;}
+    tester.test("Accumulating into view throws",threw && acc_view.is_view());
+    impl.set_memory(acc_view,impl.get_memory(acc_view));
+    accumulate_memory(impl,acc_view,contribution);
+    tester.test("Accumulate after set",acc_view.owns_array());
 
     auto i=make_index("i");
     auto j=make_index("j");
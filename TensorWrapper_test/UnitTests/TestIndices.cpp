@@ -260,6 +260,33 @@ int main()
      static_assert(are_equal(Idx2.get_map(Idx3),map23),"Idx2 map to Idx3");
      static_assert(are_equal(Idx3.get_map(Idx2),map32),"Idx3 map to Idx2");
 
+     using Traced3=typename TracedIndices<decltype(Idx3)>::type;
+     static_assert(Traced3::size()==2,"Traced indices");
+     static_assert(Traced3::get<0>()==k,"Traced index1");
+     static_assert(Traced3::get<1>()==j,"Traced index2");
+     static_assert(TracedIndices<decltype(Idx1)>::type::size()==3,
+                   "Nothing to trace");
+
+     constexpr std::array<size_t,4> ids3{0,0,2,3};
+     static_assert(are_equal(Idx3.ids(),ids3),"Idx3 ids");
+
+     //Different indices whose strings hash the same are still different
+     auto uo=make_index("uo");
+     auto Ab=make_index("Ab");
+     auto nuj=make_index("nuj");
+     auto pci=make_index("pci");
+     static_assert(decltype(uo)::hash_value==decltype(Ab)::hash_value &&
+                   decltype(nuj)::hash_value==decltype(pci)::hash_value,
+                   "Colliding hashes");
+     auto Idx4=test_fxn(i,uo,nuj);
+     auto Idx5=test_fxn(j,Ab,pci);
+     static_assert(Idx4.ncommon(Idx5)==0,"Colliding indices are not common");
+     static_assert(Idx4.count(Ab)==0,"Colliding index count");
+     constexpr std::array<size_t,3> map45{3,3,3};
+     static_assert(are_equal(Idx4.get_map(Idx5),map45),"Colliding index map");
+     static_assert(FreeIndices<decltype(Idx4),decltype(Idx5)>::type::size()==6,
+                   "Colliding indices are free");
+
      using generic_idx=make_indices<C_String<static_cast<char>(2),'\0'>,
                                     C_String<static_cast<char>(1),'\0'>,
                                     C_String<static_cast<char>(0),'\0'>>;
@@ -1,5 +1,7 @@
 #include <TensorWrapper/MemoryBlock.hpp>
 #include "TestHelpers.hpp"
+#include <cstdint>
+#include <numeric>
 
 using namespace TWrapper;
 
@@ -22,5 +24,35 @@ int main()
         ++counter;
         ++blocki;
     }
+    tester.test("Shape",block.shape(0)==Shape<1>(end,true,start));
+    tester.test("Packed offset",block.offset(0,3,std::array<size_t,1>{23})==3);
+
+    //Blocks we allocate
+    MemoryBlock<2,double> owned;
+    std::array<size_t,2> dims{10,64};
+    double* buffer=owned.allocate_block(dims);
+    tester.test("Allocated block",owned.nblocks()==1 && owned.block(0)==buffer);
+    tester.test("Cache line aligned",
+                reinterpret_cast<std::uintptr_t>(buffer)%64==0);
+    tester.test("Not padded by default",owned.shape(0).is_contiguous());
+
+    detail_::buffer_options().pad=true;
+    detail_::buffer_options().alignment=huge_page_alignment;
+    buffer=owned.allocate_block(dims);
+    const auto address=reinterpret_cast<std::uintptr_t>(buffer);
+    tester.test("Huge page aligned",address%huge_page_alignment==0);
+    const auto& padded=owned.shape(1);
+    tester.test("Padded",!padded.is_contiguous());
+    tester.test("Power of 2 avoided",padded.strides()[0]==72);
+    tester.test("Padded offset",
+                owned.offset(1,64,std::array<size_t,2>{1,0})==72);
+    std::fill(buffer,buffer+padded.extent(),1.0);
+    tester.test("Extent is writable",padded.extent()==9*72+64);
+
+    std::array<size_t,1> vec{64};
+    MemoryBlock<1,double> vector_block;
+    vector_block.allocate_block(vec);
+    tester.test("Vectors are not padded",
+                vector_block.shape(0).is_contiguous());
     return tester.results();
 }
@@ -0,0 +1,82 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+//Returns the entry for operation on backend, or one with no calls
+ProfileEntry find(const std::string& operation, const std::string& backend)
+{
+    for(const auto& entry : RunTime::profile())
+        if(entry.operation==operation && entry.backend==backend)return entry;
+    return ProfileEntry();
+}
+
+//Work for the counters to count
+double work(size_t n)
+{
+    volatile double rv=0.0;
+    for(size_t i=0;i<n;++i)rv=rv+1.0/(i+1);
+    return rv;
+}
+
+int main()
+{
+    Tester tester("Testing the hardware performance counters");
+
+    const auto events=parse_perf_events("cycles,instructions,LLC-load-misses");
+    tester.test("Parse names",events.size()==3 &&
+                              events[0]==PerfEvent::Cycles &&
+                              events[1]==PerfEvent::Instructions &&
+                              events[2]==PerfEvent::LLCReadMisses);
+    tester.test("Parse empty",parse_perf_events("").empty());
+    bool threw=false;
+    try{parse_perf_events("cycles,not-an-event");}
+    catch(const std::invalid_argument&){threw=true;}
+    tester.test("Unknown name throws",threw);
+
+    //Whatever the machine allows, asking must not fail
+    PerfCounters counters({PerfEvent::Instructions,PerfEvent::Cycles});
+    const auto before=counters.read();
+    work(1000000);
+    const auto after=counters.read();
+    tester.test("One count per event",
+                before.size()==counters.events().size() &&
+                after.size()==counters.events().size());
+    if(!counters.available())
+    {
+        std::cout<<"Hardware counters are unavailable here"<<std::endl;
+        tester.test("Unavailable counters read nothing",before.empty());
+        tester.test("Nothing to count",
+                    RunTime::set_perf_events({PerfEvent::Instructions})
+                        .empty());
+        RunTime::set_perf_events({});
+        return tester.results();
+    }
+    bool increased=true;
+    for(size_t i=0;i<after.size();++i)increased=increased && after[i]>before[i];
+    tester.test("Counts increase",increased);
+    if(counters.events().front()==PerfEvent::Instructions)
+        tester.test("Counts the work",after[0]-before[0]>1000000);
+
+    const auto counted=RunTime::set_perf_events({PerfEvent::Instructions});
+    tester.test("Selected events",counted==RunTime::perf_events());
+    const size_t dim=50;
+    const std::array<size_t,2> dims{dim,dim};
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    EigenMatrix<double> A(dims,1.0),B(dims,2.0);
+    EigenMatrix<double> C=A(i,k)*B(k,j);
+    RunTime::set_perf_events({});
+    if(RunTime::profiling_enabled())
+    {
+        const auto evaluate=find("Evaluate","EigenMatrix");
+        const auto itr=evaluate.counters.find("instructions");
+        tester.test("Profiled steps count events",
+                    itr!=evaluate.counters.end() && itr->second>dim*dim*dim);
+    }
+    else
+        tester.test("Hooks compiled out",RunTime::profile().empty());
+    return tester.results();
+}
@@ -0,0 +1,77 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <random>
+#include <vector>
+using namespace TWrapper;
+
+int main()
+{
+    Tester tester("Testing pivoted Cholesky decomposition");
+
+    //Builds G(mu,nu,rho,sigma)=sum_Q B(mu,nu,Q)B(rho,sigma,Q) with rank 3
+    const size_t n=4,nvecs=3;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<> dis(-1,1);
+    std::vector<double> B(n*n*nvecs);
+    for(auto& x: B)x=dis(gen);
+    std::vector<double> M(n*n*n*n,0.0);
+    for(size_t i=0;i<n*n;++i)
+        for(size_t j=0;j<n*n;++j)
+            for(size_t Q=0;Q<nvecs;++Q)
+                M[i*n*n+j]+=B[i*nvecs+Q]*B[j*nvecs+Q];
+
+    auto L=detail_::pivoted_cholesky(M.data(),n*n,1.0E-10);
+    tester.test("Numerical rank",L.size()==nvecs);
+    double error=0.0;
+    for(size_t i=0;i<n*n;++i)
+        for(size_t j=0;j<n*n;++j)
+        {
+            double value=0.0;
+            for(const auto& Lp: L)value+=Lp[i]*Lp[j];
+            error=std::max(error,std::fabs(value-M[i*n*n+j]));
+        }
+    tester.test("Reconstructs matrix",error<1.0E-10);
+
+    std::vector<double> zero(n*n,0.0);
+    tester.test("Zero matrix",detail_::pivoted_cholesky(zero.data(),n,1.0E-10)
+                                .empty());
+
+    //Identity needs every vector
+    std::vector<double> eye(n*n,0.0);
+    for(size_t i=0;i<n;++i)eye[i*n+i]=1.0;
+    tester.test("Full rank",
+                detail_::pivoted_cholesky(eye.data(),n,1.0E-10).size()==n);
+
+    //Now through the public API
+    EigenTensor<4,double> G(std::array<size_t,4>{n,n,n,n});
+    auto mem=G.get_memory();
+    for(size_t i=0;i<mem.nblocks();++i)
+    {
+        double* buffer=mem.block(i);
+        for(auto idx=mem.begin(i);idx!=mem.end(i);++idx)
+        {
+            const auto& x=*idx;
+            *buffer++=M[((x[0]*n+x[1])*n+x[2])*n+x[3]];
+        }
+    }
+    G.set_memory(mem);
+    auto Lt=cholesky_decompose(G,1.0E-10);
+    const auto dims=Lt.shape().dims();
+    tester.test("Factor dimensions",dims[0]==n && dims[1]==n &&
+                                    dims[2]==nvecs);
+    auto mu=make_index("mu");
+    auto nu=make_index("nu");
+    auto rho=make_index("rho");
+    auto sigma=make_index("sigma");
+    auto P=make_index("P");
+    EigenTensor<4,double> G2=Lt(mu,nu,P)*Lt(rho,sigma,P);
+    error=0.0;
+    for(size_t i=0;i<n;++i)
+        for(size_t j=0;j<n;++j)
+            for(size_t k=0;k<n;++k)
+                for(size_t l=0;l<n;++l)
+                    error=std::max(error,std::fabs(G2(i,j,k,l)-G(i,j,k,l)));
+    tester.test("Factor reconstructs tensor",error<1.0E-10);
+
+    return tester.results();
+}
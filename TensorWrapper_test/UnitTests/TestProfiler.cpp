@@ -0,0 +1,130 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <thread>
+
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+//Returns the entry for operation on backend, or one with no calls
+ProfileEntry find(const std::string& operation, const std::string& backend)
+{
+    for(const auto& entry : RunTime::profile())
+        if(entry.operation==operation && entry.backend==backend)return entry;
+    return ProfileEntry();
+}
+
+int main()
+{
+    Tester tester("Testing the profiling hooks");
+    const size_t dim=20;
+    const size_t bytes=dim*dim*sizeof(double);
+
+    //Scopes themselves work whether or not the hooks are compiled in
+    tester.test("Not tracing",!RunTime::tracing());
+    RunTime::start_trace();
+    tester.test("Tracing",RunTime::tracing());
+    {
+        ProfileScope outer("Outer",TensorTypes::EigenMatrix);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        {
+            ProfileScope inner("Inner",TensorTypes::EigenMatrix);
+            inner.add_bytes(100);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    const auto outer=find("Outer","EigenMatrix");
+    const auto inner=find("Inner","EigenMatrix");
+    tester.test("Calls counted",outer.calls==1 && inner.calls==1);
+    tester.test("Bytes counted",inner.bytes==100 && outer.bytes==0);
+    tester.test("Total includes nested",outer.total_time>=inner.total_time);
+    tester.test("Self excludes nested",
+                std::fabs(outer.self_time-(outer.total_time-inner.total_time))<
+                1E-9 && outer.self_time<inner.total_time);
+    tester.test("Leaf self is total",inner.self_time==inner.total_time);
+    RunTime::stop_trace();
+    {
+        ProfileScope after("After",TensorTypes::EigenMatrix);
+    }
+    const auto& events=trace_data().events;
+    tester.test("Events recorded",events.size()==2);
+    //Scopes are recorded as they close, so the inner one comes first
+    const TraceEvent& ievent=events.front();
+    const TraceEvent& oevent=events.back();
+    tester.test("Event names",std::string(ievent.operation)=="Inner" &&
+                              std::string(oevent.operation)=="Outer");
+    tester.test("Events nest",oevent.begin<=ievent.begin &&
+                              ievent.end<=oevent.end && ievent.bytes==100);
+    tester.test("Same thread",ievent.thread==oevent.thread);
+    std::stringstream trace;
+    RunTime::write_trace(trace);
+    tester.test("Chrome trace",
+                trace.str().find("\"traceEvents\"")!=std::string::npos &&
+                trace.str().find("\"name\":\"Inner\",\"cat\":\"EigenMatrix\","
+                                 "\"ph\":\"X\"")!=std::string::npos &&
+                trace.str().find("After")==std::string::npos);
+    RunTime::reset_profile();
+    tester.test("Reset",RunTime::profile().empty());
+
+    //Each thread keeps its own totals, which outlive the thread
+    {
+        ProfileScope scope("Threaded",TensorTypes::EigenMatrix);
+    }
+    std::vector<std::thread> threads;
+    for(size_t t=0;t<4;++t)
+        threads.emplace_back([](){
+            for(size_t n=0;n<10;++n)
+            {
+                ProfileScope scope("Threaded",TensorTypes::EigenMatrix);
+                scope.add_bytes(1);
+            }
+        });
+    for(auto& thread : threads)thread.join();
+    const auto threaded=find("Threaded","EigenMatrix");
+    tester.test("Threads merged",threaded.calls==41 && threaded.bytes==40);
+    RunTime::reset_profile();
+    tester.test("Reset threads",RunTime::profile().empty());
+
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    const std::array<size_t,2> dims{dim,dim};
+    EigenMatrix<double> A(dims,1.0),B(dims,2.0);
+    EigenMatrix<double> C=A(i,k)*B(k,j);
+    C=A+B;
+    EigenTensor<2,double> D(C);
+    auto mem=C.get_memory();
+    C.set_memory(mem);
+
+    if(!RunTime::profiling_enabled())
+    {
+        tester.test("Hooks compiled out",RunTime::profile().empty());
+        return tester.results();
+    }
+
+    const auto alloc=find("allocate","EigenMatrix");
+    tester.test("allocate",alloc.calls==2 && alloc.bytes==2*bytes);
+    const auto contract=find("Contraction","EigenMatrix");
+    tester.test("Contraction",contract.calls==1 && contract.bytes==3*bytes &&
+                              contract.flops==2.0*dim*dim*dim);
+    const auto add=find("Add","EigenMatrix");
+    tester.test("Add",add.calls==1 && add.bytes==3*bytes);
+    const auto evaluate=find("Evaluate","EigenMatrix");
+    tester.test("Evaluate",evaluate.calls==2 &&
+                           evaluate.self_time<=evaluate.total_time &&
+                           evaluate.flops==contract.flops+add.flops);
+    tester.test("Operations nest in Evaluate",
+                evaluate.total_time>=contract.total_time+add.total_time);
+    const auto convert=find("Convert","EigenMatrix->EigenTensor");
+    tester.test("Convert",convert.calls==1 && convert.bytes==2*bytes);
+    //Setting A and B to their values also gets their memory
+    const auto get=find("get_memory","EigenMatrix");
+    tester.test("get_memory",get.calls==3 && get.bytes==3*bytes);
+    const auto set=find("set_memory","EigenMatrix");
+    tester.test("set_memory",set.calls==1 && set.bytes==bytes);
+
+    std::stringstream ss;
+    RunTime::print_profile(ss);
+    tester.test("Report lists operations",
+                ss.str().find("Contraction")!=std::string::npos);
+    return tester.results();
+}
@@ -0,0 +1,46 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <vector>
+using namespace TWrapper;
+
+int main(int argc, char** argv)
+{
+    Tester tester("Testing the RunTime's execution configuration");
+
+    ExecutionConfig config;
+    config.threads_per_rank=2;
+    config.affinity=Affinity::Compact;
+    RunTime rt(argc,argv,config);
+
+    tester.test("Threads per rank",RunTime::num_threads()==2);
+    tester.test("OpenMP follows RunTime",omp_get_max_threads()==2);
+    tester.test("Eigen device follows RunTime",
+                detail_::eigen_device().numThreads()==2);
+    tester.test("Thread pool follows RunTime",detail_::thread_pool().size()==2);
+    tester.test("Tensors use RunTime's communicator",
+                RunTime::comm()==MPI_COMM_WORLD);
+
+#ifdef __linux__
+    std::vector<int> ncpus(2,0);
+    #pragma omp parallel num_threads(2)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        pthread_getaffinity_np(pthread_self(),sizeof(set),&set);
+        ncpus[omp_get_thread_num()]=CPU_COUNT(&set);
+    }
+    tester.test("Threads are pinned",ncpus[0]==1 && ncpus[1]==1);
+#endif
+
+    //Tensors still work with the new configuration
+    RunTime::set_allocation_policy(AllocationPolicy::Partitioned);
+    EigenTensor<2,double> A(std::array<size_t,2>{50,60},2.0);
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+    EigenTensor<2,double> B=A(i,k)*A(j,k);
+    tester.test("Contraction",std::fabs(B(3,4)-240.0)<1E-10);
+    RunTime::set_allocation_policy(AllocationPolicy::Local);
+
+    return tester.results();
+}
@@ -69,5 +69,31 @@ int main()
     tester.test("CM Tensor begin",D3cmbegin==D3cm.begin());
     tester.test("CM Tensor end",D3cmend==D3cm.end());
 
+    //Stride testing
+    tester.test("Packed strides",D3.strides()==index_t<3>({9,3,1}));
+    tester.test("CM packed strides",D3cm.strides()==index_t<3>({1,3,9}));
+    tester.test("Is contiguous",D3.is_contiguous());
+    tester.test("Extent",D3.extent()==27);
+
+    //A 10 by 5 matrix whose rows are padded to 8 elements
+    Shape<2> padded(mat,true,index_t<2>{},index_t<2>{8,1});
+    tester.test("Padded is not contiguous",!padded.is_contiguous());
+    tester.test("Padded size",padded.size()==50);
+    tester.test("Padded extent",padded.extent()==77);
+    tester.test("Padded flat index",padded.flat_index(index_t<2>{3,4})==28);
+    tester.test("Padded unflatten",
+                padded.unflatten_index(28)==index_t<2>({3,4}));
+    tester.test("Padded != packed",padded!=D2);
+
+    Shape<2> cm_padded(mat,false,index_t<2>{},index_t<2>{1,16});
+    tester.test("CM padded flat index",
+                cm_padded.flat_index(index_t<2>{3,4})==67);
+    tester.test("CM padded unflatten",
+                cm_padded.unflatten_index(67)==index_t<2>({3,4}));
+
+    Shape<2> offset_block(index_t<2>{12,7},true,index_t<2>{2,2},
+                          index_t<2>{8,1});
+    tester.test("Offset",offset_block.offset(index_t<2>{3,4})==10);
+
     return tester.results();
 }
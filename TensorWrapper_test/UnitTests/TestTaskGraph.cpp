@@ -0,0 +1,98 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <stdexcept>
+using namespace TWrapper;
+using namespace TWrapper::detail_;
+
+using matrix_t=EigenMatrix<double>;
+
+bool same(const matrix_t& lhs, const matrix_t& rhs)
+{
+    return lhs.data().isApprox(rhs.data());
+}
+
+int main()
+{
+    Tester tester("Testing the task graph scheduler");
+    auto i=make_index("i");
+    auto j=make_index("j");
+    auto k=make_index("k");
+
+    matrix_t A({10,10}),B({10,10}),C({10,10});
+    fill_random(A);
+    fill_random(B);
+    fill_random(C);
+
+    //Finding operands
+    Operands::set_t reads;
+    Operands::find(A(i,k)*B(k,j)+C(j,i)*2.0,reads);
+    tester.test("Finds every operand",reads.size()==3 &&
+                reads.count(Operands::of(A)) && reads.count(Operands::of(B))
+                && reads.count(Operands::of(C)));
+    reads.clear();
+    Operands::find(A(i,j)+A(j,i),reads);
+    tester.test("Operands are found once",reads.size()==1);
+
+    //The same statements, evaluated one at a time
+    matrix_t X=A(i,k)*B(k,j);
+    matrix_t Y=B(i,k)*C(k,j);
+    matrix_t Z=X(i,j)+Y(j,i);
+    matrix_t W=Z(i,k)*A(k,j);
+    matrix_t newA=B(i,j)*2.0;
+
+    //Z depends on both X and Y, W on Z, and overwriting A waits for W
+    TaskGraph graph;
+    matrix_t gZ({10,10}),gW({10,10});
+    auto& gX=graph.intermediate<matrix_t>({10,10});
+    auto& gY=graph.intermediate<matrix_t>({10,10});
+    graph.add(gX,A(i,k)*B(k,j))
+         .add(gY,B(i,k)*C(k,j))
+         .add(gZ,gX(i,j)+gY(j,i))
+         .add(gW,gZ(i,k)*A(k,j))
+         .add(A,B(i,j)*2.0);
+    tester.test("Statements are recorded",graph.size()==5);
+    graph.run();
+    tester.test("Nothing left to run",graph.size()==0);
+    tester.test("Read after write",same(gZ,Z));
+    tester.test("Chained reads",same(gW,W));
+    tester.test("Write after read",same(A,newA));
+
+    //Many independent statements
+    std::vector<matrix_t> results(8,matrix_t({10,10}));
+    for(auto& x : results)graph.add(x,B(i,k)*C(k,j));
+    graph.run();
+    bool all_good=true;
+    for(auto& x : results)all_good=all_good && same(x,Y);
+    tester.test("Independent statements",all_good);
+
+    //Writes to the same tensor happen in order
+    matrix_t acc(B);
+    for(size_t n=0;n<4;++n)graph.add(acc,acc(i,j)+B(i,j));
+    graph.run();
+    matrix_t corr=B(i,j)*5.0;
+    tester.test("Write after write",same(acc,corr));
+
+    //Errors from statements reach the caller (D is empty when evaluated)
+    matrix_t D(B),bad;
+    graph.add(bad,D(i,j)+A(i,j));
+    D=matrix_t();
+    bool caught=false;
+    try{graph.run();}
+    catch(const std::exception&){caught=true;}
+    tester.test("Exceptions are forwarded",caught);
+
+    //Statements skipped after an error still let go of their intermediates
+    matrix_t E(B),skipped;
+    auto& gI=graph.intermediate<matrix_t>({10,10});
+    graph.add(gI,E(i,j)+A(i,j))
+         .add(skipped,gI(i,j)*2.0);
+    E=matrix_t();
+    try{graph.run();}
+    catch(const std::exception&){}
+    bool released=false;
+    try{released=!gI.shape().size();}
+    catch(const std::exception&){released=true;}
+    tester.test("Skipped statements release intermediates",released);
+
+    return tester.results();
+}
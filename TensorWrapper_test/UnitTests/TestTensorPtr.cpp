@@ -41,5 +41,42 @@ int main()
     const auto& moved_value3=moved.cast<type>();
     tester.test("Move assignment",&moved_value3==&other_move);
 
+    Eigen::MatrixXd random=Eigen::MatrixXd::Random(100,100);
+    tensor_ptr cold(type,random);
+    cold.compress<type>();
+    tester.test("Is compressed",cold.is_compressed());
+    tester.test("Still holds a tensor",cold);
+    const size_t lossless_size=cold.compressed_size();
+    tester.test("Compressed size",lossless_size>0);
+    tensor_ptr cold_copy(cold);
+    tester.test("Copy is compressed",cold_copy.is_compressed());
+    tester.test("Lossless decompression",cold.cast<type>()==random);
+    tester.test("Decompressed",!cold.is_compressed());
+    tester.test("Copy decompresses",cold_copy.cast<type>()==random);
+
+    tensor_ptr zeros(type,value);
+    zeros.compress<type>();
+    tester.test("Zeros compress well",zeros.compressed_size()<100*100);
+    tester.test("Zeros decompress",zeros.cast<type>()==value);
+
+    tensor_ptr truncated(type,random);
+    truncated.compress<type>(Compression::Truncated,1.0E-6);
+    tester.test("Truncation compresses more",
+                truncated.compressed_size()<lossless_size);
+    const Eigen::MatrixXd diff=truncated.cast<type>()-random;
+    tester.test("Truncation error is bounded",
+                (diff.array().abs()<=1.0E-6*random.array().abs()).all());
+
+    //Higher ranks convert without ever considering EigenMatrix
+    constexpr auto tensor=detail_::TensorTypes::EigenTensor;
+    Eigen::Tensor<double,3> value3(2,3,4);
+    value3.setRandom();
+    detail_::TensorPtr<3,double> rank3(tensor,value3);
+    auto sparse=rank3.convert<detail_::TensorTypes::EigenSparse>();
+    auto back=sparse.convert<tensor>();
+    const Eigen::Tensor<double,0> error=
+        (back.cast<tensor>()-value3).abs().maximum();
+    tester.test("Rank 3 conversion",error(0)==0.0);
+
     return tester.results();
 }
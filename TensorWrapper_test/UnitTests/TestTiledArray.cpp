@@ -50,14 +50,25 @@ int main(int argc, char** argv)
                 std::equal(corr_mem.begin(),corr_mem.end(),mem2.block(i)));
     }
 
-    //TATensor F,G;
-    //F("i,j")=B("i,j").block({0,0},{5,5});
-    //std::cout<<F<<std::endl;
-    //G=impl.slice(B,{4,4},{6,6});
-    //mem=impl.get_memory(G);
-    //std::array<double,4> corr_slice({3.0,3.0,4.0,3.0});
-    //tester.test("Slice",std::equal(corr_slice.begin(),corr_slice.end(),
-    //                               mem.block(0));
+    //The slice straddles all four tiles of B
+    TATensor G=impl.slice(B,{4,4},{6,6});
+    mem=impl.get_memory(G);
+    std::array<double,4> corr_slice({3.0,3.0,4.0,3.0});
+    tester.test("Slice",std::equal(corr_slice.begin(),corr_slice.end(),
+                                   mem.block(0)));
+
+    //Tiling policy
+    tester.test("Default is one tile",
+                impl.allocate(dims).trange().tiles_range().volume()==1);
+    RunTime::set_tiling_policy(TilingPolicy::fixed_size(4));
+    TATensor H=impl.allocate(dims);
+    tester.test("Fixed tile size",H.trange().tiles_range().volume()==9);
+    H=impl.slice(B,{1,1},{9,9});
+    tester.test("Slice follows policy",H.trange().tiles_range().volume()==4);
+    H=impl.permute(B,{1,0});
+    tester.test("Permute follows policy",
+                H.trange().tiles_range().volume()==9);
+    RunTime::set_tiling_policy(TilingPolicy::single());
 
 
     tester.test("Are equal",impl.are_equal(A,A));
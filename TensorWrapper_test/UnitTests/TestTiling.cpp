@@ -0,0 +1,55 @@
+#include <TensorWrapper/TensorWrapper.hpp>
+#include "TestHelpers.hpp"
+#include <vector>
+using namespace TWrapper;
+using bounds_t=std::vector<size_t>;
+
+int main()
+{
+    Tester tester("Testing the tiling policies");
+
+    const TilingPolicy single=TilingPolicy::single();
+    tester.test("Single tile",single.tile_boundaries(0,10,2,4)==
+                              bounds_t({0,10}));
+    tester.test("Default policy",RunTime::tiling_policy().kind()==
+                                 TilingPolicy::Kind::Single);
+
+    const TilingPolicy fixed=TilingPolicy::fixed_size(4);
+    tester.test("Fixed size",fixed.tile_boundaries(1,10,2,4)==
+                             bounds_t({0,4,8,10}));
+    tester.test("Fixed size, exact",fixed.tile_boundaries(0,8,2,4)==
+                                    bounds_t({0,4,8}));
+    tester.test("Fixed size, small",fixed.tile_boundaries(0,3,2,4)==
+                                    bounds_t({0,3}));
+
+    //2 tiles for each of 8 ranks is 4 tiles along each mode of a matrix
+    const TilingPolicy per_rank=TilingPolicy::tiles_per_rank(2);
+    tester.test("Tiles per rank",per_rank.tile_boundaries(0,10,2,8)==
+                                 bounds_t({0,3,6,8,10}));
+    tester.test("Tiles per rank, rank 3",per_rank.tile_boundaries(0,9,3,4)==
+                                         bounds_t({0,5,9}));
+    tester.test("At most a tile per index",
+                per_rank.tile_boundaries(0,2,1,8)==bounds_t({0,1,2}));
+
+    const TilingPolicy user=TilingPolicy::boundaries({{0,2,7},{0,5}});
+    tester.test("User boundaries",user.tile_boundaries(0,10,3,1)==
+                                  bounds_t({0,2,7,10}));
+    tester.test("Last user boundaries are reused",
+                user.tile_boundaries(2,10,3,1)==bounds_t({0,5,10}));
+    tester.test("User boundaries past extent",
+                user.tile_boundaries(0,7,3,1)==bounds_t({0,2,7}));
+
+    bool caught=false;
+    try{TilingPolicy::boundaries({{0,3,3}});}
+    catch(const std::invalid_argument&){caught=true;}
+    tester.test("Boundaries must increase",caught);
+    caught=false;
+    try{TilingPolicy::fixed_size(0);}
+    catch(const std::invalid_argument&){caught=true;}
+    tester.test("Tile size must be positive",caught);
+
+    RunTime::set_tiling_policy(fixed);
+    tester.test("Set policy",RunTime::tiling_policy().kind()==
+                             TilingPolicy::Kind::FixedSize);
+    return tester.results();
+}